@@ -0,0 +1,355 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:  Muyuan Shen <muyuan_shen@hust.edu.cn>
+ */
+
+#include "bench.h"
+
+#include <ns3/ai-module.h>
+#include <ns3/core-module.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Gym environment of the benchmark: the observation is a box of uint32
+ * values, which Python echoes the last one of as the action
+ */
+class BenchGymEnv : public OpenGymEnv
+{
+  public:
+    BenchGymEnv(uint32_t numValues);
+    ~BenchGymEnv() override;
+    static TypeId GetTypeId();
+
+    /**
+     * Sends the observation (all values set to value) and waits for the
+     * action. Returns the value Python sent back.
+     */
+    uint32_t Step(uint32_t value);
+
+    // OpenGym interfaces:
+    Ptr<OpenGymSpace> GetActionSpace() override;
+    Ptr<OpenGymSpace> GetObservationSpace() override;
+    bool GetGameOver() override;
+    Ptr<OpenGymDataContainer> GetObservation() override;
+    float GetReward() override;
+    std::string GetExtraInfo() override;
+    bool ExecuteActions(Ptr<OpenGymDataContainer> action) override;
+
+  private:
+    uint32_t m_numValues;
+    uint32_t m_value;
+    uint32_t m_check;
+};
+
+BenchGymEnv::BenchGymEnv(uint32_t numValues)
+    : m_numValues(numValues),
+      m_value(0),
+      m_check(0)
+{
+    SetOpenGymInterface(OpenGymInterface::Get());
+}
+
+BenchGymEnv::~BenchGymEnv()
+{
+}
+
+TypeId
+BenchGymEnv::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::BenchGymEnv").SetParent<OpenGymEnv>().SetGroupName("OpenGym");
+    return tid;
+}
+
+uint32_t
+BenchGymEnv::Step(uint32_t value)
+{
+    m_value = value;
+    Notify();
+    return m_check;
+}
+
+Ptr<OpenGymSpace>
+BenchGymEnv::GetActionSpace()
+{
+    std::vector<uint32_t> shape = {1};
+    std::string dtype = TypeNameGet<uint32_t>();
+    return CreateObject<OpenGymBoxSpace>(0, 255, shape, dtype);
+}
+
+Ptr<OpenGymSpace>
+BenchGymEnv::GetObservationSpace()
+{
+    std::vector<uint32_t> shape = {m_numValues};
+    std::string dtype = TypeNameGet<uint32_t>();
+    return CreateObject<OpenGymBoxSpace>(0, 255, shape, dtype);
+}
+
+bool
+BenchGymEnv::GetGameOver()
+{
+    return false;
+}
+
+Ptr<OpenGymDataContainer>
+BenchGymEnv::GetObservation()
+{
+    std::vector<uint32_t> shape = {m_numValues};
+    Ptr<OpenGymBoxContainer<uint32_t>> box = CreateObject<OpenGymBoxContainer<uint32_t>>(shape);
+    box->SetData(std::vector<uint32_t>(m_numValues, m_value));
+    return box;
+}
+
+float
+BenchGymEnv::GetReward()
+{
+    return 0.0;
+}
+
+std::string
+BenchGymEnv::GetExtraInfo()
+{
+    return "";
+}
+
+bool
+BenchGymEnv::ExecuteActions(Ptr<OpenGymDataContainer> action)
+{
+    m_check = DynamicCast<OpenGymBoxContainer<uint32_t>>(action)->GetValue(0);
+    return true;
+}
+
+} // namespace ns3
+
+using namespace ns3;
+
+/**
+ * Runs warmup + rounds round trips of a function which sends a payload
+ * whose bytes are all (round % 256), and returns what Python read as
+ * the last byte. Returns the round-trip times of the measured rounds,
+ * in microseconds.
+ */
+template <typename RoundTrip>
+std::vector<double>
+Measure(uint32_t warmup, uint32_t rounds, RoundTrip roundTrip)
+{
+    std::vector<double> rtt;
+    rtt.reserve(rounds);
+    for (uint32_t i = 0; i < warmup + rounds; ++i)
+    {
+        uint8_t value = i % 256;
+        auto start = std::chrono::steady_clock::now();
+        uint32_t check = roundTrip(value);
+        auto end = std::chrono::steady_clock::now();
+
+        NS_ABORT_MSG_IF(check != value, "Wrong reply from Python");
+        if (i >= warmup)
+        {
+            rtt.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+        }
+    }
+    return rtt;
+}
+
+/**
+ * Measures the struct-based interface, with the smallest BenchStruct of
+ * the capacities which holds the payload
+ */
+template <uint32_t Capacity, uint32_t... Larger>
+std::vector<double>
+MeasureStruct(uint32_t warmup,
+              uint32_t rounds,
+              uint32_t payload,
+              Ns3AiSemaphore::WaitMode& waitMode,
+              std::integer_sequence<uint32_t, Capacity, Larger...>)
+{
+    if constexpr (sizeof...(Larger) > 0)
+    {
+        if (payload > Capacity)
+        {
+            return MeasureStruct(warmup,
+                                 rounds,
+                                 payload,
+                                 waitMode,
+                                 std::integer_sequence<uint32_t, Larger...>());
+        }
+    }
+    NS_ABORT_MSG_IF(payload > Capacity, "Struct payload is at most " << Capacity << " bytes");
+    auto msgInterface = Ns3AiMsgInterface::Get()->GetInterface<BenchStruct<Capacity>, BenchReply>();
+    waitMode = msgInterface->GetWaitMode();
+    return Measure(warmup, rounds, [msgInterface, payload](uint8_t value) {
+        msgInterface->CppSendBegin();
+        msgInterface->GetCpp2PyStruct()->size = payload;
+        std::memset(msgInterface->GetCpp2PyStruct()->data, value, payload);
+        msgInterface->CppSendEnd();
+
+        msgInterface->CppRecvBegin();
+        uint32_t check = msgInterface->GetPy2CppStruct()->check;
+        msgInterface->CppRecvEnd();
+        return check;
+    });
+}
+
+/**
+ * Appends one row of results to a CSV file (with a header if the file
+ * is new), or prints it if no file is given
+ */
+void
+Report(const std::string& output,
+       const std::string& mode,
+       const std::string& transport,
+       const std::string& placement,
+       Ns3AiSemaphore::WaitMode waitMode,
+       uint32_t payload,
+       std::vector<double> rtt)
+{
+    std::sort(rtt.begin(), rtt.end());
+    double mean = 0;
+    for (double t : rtt)
+    {
+        mean += t;
+    }
+    mean /= rtt.size();
+
+    std::ofstream file;
+    if (!output.empty())
+    {
+        bool isNew = !std::ifstream(output).good();
+        file.open(output, std::ios::app);
+        NS_ABORT_MSG_IF(!file, "Cannot open " << output);
+        if (isNew)
+        {
+            file << "mode,transport,placement,wait_mode,payload_bytes,rounds,mean_us,p50_us,p90_us,p99_us,"
+                    "p999_us,max_us,msgs_per_s,mbytes_per_s\n";
+        }
+    }
+    std::ostream& os = output.empty() ? std::cout : file;
+    os << mode << "," << transport << "," << placement << ","
+       << (waitMode == Ns3AiSemaphore::SPIN ? "spin" : "spin_then_sleep") << "," << payload << ","
+       << rtt.size() << "," << mean << "," << rtt[rtt.size() / 2] << ","
+       << rtt[rtt.size() * 9 / 10] << "," << rtt[rtt.size() * 99 / 100] << ","
+       << rtt[rtt.size() * 999 / 1000] << "," << rtt.back() << "," << 1e6 / mean << ","
+       << payload / mean << std::endl;
+}
+
+/**
+ * Measures the round trip of the message interface (struct-based,
+ * vector-based, or through the Gym interface) for one payload size:
+ * C++ writes the payload, Python reads all of it and replies with its
+ * last byte. Run it with bench.py, which sweeps the sizes and modes.
+ */
+int
+main(int argc, char* argv[])
+{
+    std::string mode = "struct";
+    uint32_t payload = 8;
+    uint32_t rounds = 10000;
+    uint32_t warmup = 1000;
+    std::string segmentName = "My Seg";
+    bool hugePages = false;
+    int cpu = -1;
+    std::string placement = "none";
+    std::string output;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("mode", "Transport: struct, vector or gym", mode);
+    cmd.AddValue("payload", "Payload size in bytes", payload);
+    cmd.AddValue("rounds", "Number of measured round trips", rounds);
+    cmd.AddValue("warmup", "Number of round trips before measuring", warmup);
+    cmd.AddValue("segment",
+                 "Segment name (a path on hugetlbfs for huge pages), or socket address",
+                 segmentName);
+    cmd.AddValue("hugePages", "Back the segment with transparent huge pages", hugePages);
+    cmd.AddValue("cpu", "CPU to pin this process to (-1: no pinning)", cpu);
+    cmd.AddValue("placement", "CPU placement, only reported in the results", placement);
+    cmd.AddValue("output", "CSV file to append the results to (default: stdout)", output);
+    cmd.Parse(argc, argv);
+
+    NS_ABORT_MSG_IF(payload == 0 || rounds == 0, "Payload and rounds must be positive");
+    auto interface = Ns3AiMsgInterface::Get();
+    if (cpu >= 0 && !interface->SetCpuAffinity(cpu))
+    {
+        std::cerr << "Cannot pin to CPU " << cpu << std::endl;
+    }
+    std::string transport = "shm";
+    if (Ns3AiSocket::IsAddress(segmentName))
+    {
+        transport = segmentName.substr(0, segmentName.find(':'));
+    }
+    interface->SetNames(segmentName,
+                        "My Cpp to Python Msg",
+                        "My Python to Cpp Msg",
+                        "My Lockable");
+
+    if (mode == "gym")
+    {
+        // one uint32 per 4 bytes of payload
+        Ptr<BenchGymEnv> env = CreateObject<BenchGymEnv>((payload + 3) / 4);
+        std::vector<double> rtt =
+            Measure(warmup, rounds, [&env](uint8_t value) { return env->Step(value); });
+        Ns3AiSemaphore::WaitMode waitMode =
+            interface->GetInterface<Ns3AiGymMsg, Ns3AiGymMsg>()->GetWaitMode();
+        env->NotifySimulationEnd();
+        Report(output, mode, transport, placement, waitMode, payload, rtt);
+        return 0;
+    }
+
+    interface->SetIsMemoryCreator(false);
+    interface->SetHandleFinish(true);
+    interface->SetHugePages(hugePages);
+    std::vector<double> rtt;
+    Ns3AiSemaphore::WaitMode waitMode = Ns3AiSemaphore::SPIN;
+    if (mode == "struct")
+    {
+        interface->SetUseVector(false);
+        rtt = MeasureStruct(warmup, rounds, payload, waitMode, BenchStructCapacities());
+    }
+    else if (mode == "vector")
+    {
+        interface->SetUseVector(true);
+        auto msgInterface = interface->GetInterface<uint8_t, BenchReply>();
+        // Python waits for the first message, so the vectors can be sized here
+        msgInterface->ResizeCpp2PyVector(payload);
+        msgInterface->ResizePy2CppVector(1);
+        rtt = Measure(warmup, rounds, [msgInterface, payload](uint8_t value) {
+            msgInterface->CppSendBegin();
+            std::memset(&msgInterface->GetCpp2PyVector()->at(0), value, payload);
+            msgInterface->CppSendEnd();
+
+            msgInterface->CppRecvBegin();
+            uint32_t check = msgInterface->GetPy2CppVector()->at(0).check;
+            msgInterface->CppRecvEnd();
+            return check;
+        });
+        waitMode = msgInterface->GetWaitMode();
+    }
+    else
+    {
+        NS_FATAL_ERROR("Unknown mode " << mode);
+    }
+    Report(output, mode, transport, placement, waitMode, payload, rtt);
+    return 0;
+}
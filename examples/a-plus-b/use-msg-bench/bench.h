@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:  Muyuan Shen <muyuan_shen@hust.edu.cn>
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <cstdint>
+#include <utility>
+
+/**
+ * Message of the struct-based benchmark, holding up to Capacity bytes:
+ * only the first size bytes of data are written and read
+ */
+template <uint32_t Capacity>
+struct BenchStruct
+{
+    uint32_t size;
+    uint8_t data[Capacity];
+};
+
+/**
+ * Capacities of the struct-based benchmark. A payload uses the smallest
+ * one which holds it, so that small payloads do not map and touch a
+ * struct sized for the largest one.
+ */
+typedef std::integer_sequence<uint32_t, 64, 512, 4096, 32768, 262144, 1048576, 4194304>
+    BenchStructCapacities;
+
+/**
+ * Reply of both benchmarks: the last byte of the payload, read by Python
+ */
+struct BenchReply
+{
+    uint32_t check;
+};
+
+#endif // BENCH_H
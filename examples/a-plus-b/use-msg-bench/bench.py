@@ -0,0 +1,234 @@
+# Copyright (c) 2023 Huazhong University of Science and Technology
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License version 2 as
+# published by the Free Software Foundation;
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+#
+# Author: Muyuan Shen <muyuan_shen@hust.edu.cn>
+
+# Microbenchmark of the message interface: round-trip latency percentiles and
+# throughput of the struct-based and vector-based interfaces and of the Gym
+# interface (protobuf), across payload sizes and CPU placements. Each
+# configuration runs in its own process, and the C++ side appends one CSV row
+# per configuration to the output file. For example:
+#   python bench.py
+#   python bench.py --modes vector --sizes 8 1048576 --placements fixed random
+#   python bench.py --modes struct vector --huge-pages --json bench.json
+#   python bench.py --modes vector --sizes 1048576 --hugetlbfs /dev/hugepages
+#   python bench.py --modes struct vector --transports shm tcp unix
+
+import argparse
+import csv
+import json
+import os
+import random
+import subprocess
+import sys
+import traceback
+
+import numpy as np
+
+NS3_PATH = "../../../../../"
+TARGET = "ns3ai_apb_bench"
+MODES = ['struct', 'vector', 'gym']
+# none: let the scheduler place the processes, fixed: sibling CPUs,
+# random: two random CPUs (different at each run)
+PLACEMENTS = ['none', 'fixed', 'random']
+# shm: shared memory, tcp and unix: sockets over loopback
+TRANSPORTS = {'shm': None,
+              'tcp': 'tcp://127.0.0.1:47300',
+              'unix': 'unix:///tmp/ns3ai_apb_bench.sock'}
+DEFAULT_SIZES = [8, 64, 512, 4096, 32768, 262144, 1048576, 4194304]
+# largest of BenchStructCapacities in bench.h
+STRUCT_MAX_PAYLOAD = 4 * 1024 * 1024
+
+
+def get_cpu_affinity(placement):
+    if placement == 'fixed':
+        return 'siblings'
+    if placement == 'random':
+        cpus = sorted(os.sched_getaffinity(0))
+        if len(cpus) < 2:
+            return cpus[0], cpus[0]
+        return tuple(random.sample(cpus, 2))
+    return None
+
+
+def get_segment_name(args, setting):
+    segName = "My Seg"
+    if TRANSPORTS[args.transport] is not None:
+        segName = TRANSPORTS[args.transport]
+        setting['segment'] = segName
+    elif args.hugetlbfs is not None:
+        segName = os.path.join(args.hugetlbfs, 'ns3ai_apb_bench')
+        setting['segment'] = segName
+    return segName
+
+
+def run_msg(args, setting, cpuAffinity):
+    sys.path.append(os.path.dirname(os.path.abspath(__file__)))
+    import ns3ai_apb_py_bench as py_binding
+    from ns3ai_utils import Experiment
+
+    segName = get_segment_name(args, setting)
+    setting['hugePages'] = 'true' if args.huge_pages else 'false'
+    useVector = args.mode == 'vector'
+    msgModule = py_binding
+    if not useVector:
+        # the smallest struct which holds the payload, as the C++ side
+        capacity = min(c for c in py_binding.STRUCT_CAPACITIES if c >= args.size)
+        msgModule = getattr(py_binding, 'stru_{}'.format(capacity))
+    # the C++ side sizes the vectors before the first message
+    exp = Experiment(TARGET, NS3_PATH, msgModule,
+                     handleFinish=True, useVector=useVector, vectorSize=1 if useVector else None,
+                     segName=segName, hugePages=args.huge_pages, cpuAffinity=cpuAffinity,
+                     waitMode=args.wait_mode)
+    msgInterface = exp.run(setting=setting, show_output=True)
+
+    try:
+        envArray = None
+        actArray = None
+        if not useVector:
+            env = msgInterface.GetCpp2PyStruct()
+            act = msgInterface.GetPy2CppStruct()
+        while True:
+            msgInterface.PyRecvBegin()
+            if msgInterface.PyGetFinished():
+                break
+            # read all the payload, as a consumer would
+            if useVector:
+                if envArray is None:
+                    envArray = msgInterface.GetCpp2PyVector().as_numpy()
+                    actArray = msgInterface.GetPy2CppVector().as_numpy()
+                data = envArray.copy()
+            else:
+                data = np.frombuffer(env.get_data(), dtype=np.uint8).copy()
+            msgInterface.PyRecvEnd()
+
+            msgInterface.PySendBegin()
+            if useVector:
+                actArray[0]['check'] = data[-1]
+            else:
+                act.check = int(data[-1])
+            msgInterface.PySendEnd()
+    finally:
+        del envArray, actArray, msgInterface
+        del exp
+
+
+def run_gym(args, setting, cpuAffinity):
+    import gymnasium as gym
+    import ns3ai_gym_env
+
+    segName = get_segment_name(args, setting)
+    env = gym.make("ns3ai_gym_env/Ns3-v0", targetName=TARGET, ns3Path=NS3_PATH,
+                   ns3Settings=setting, waitMode=args.wait_mode, cpuAffinity=cpuAffinity,
+                   segName=segName)
+    try:
+        obs, info = env.reset()
+        while True:
+            obs, reward, done, _, info = env.step([int(obs[-1])])
+            if done:
+                break
+    finally:
+        env.close()
+
+
+# runs one configuration, in its own process
+def run_worker(args):
+    setting = {'mode': args.mode, 'payload': args.size, 'rounds': args.rounds,
+               'warmup': args.warmup, 'placement': args.placement,
+               'output': os.path.abspath(args.output)}
+    cpuAffinity = get_cpu_affinity(args.placement)
+    try:
+        if args.mode == 'gym':
+            run_gym(args, setting, cpuAffinity)
+        else:
+            run_msg(args, setting, cpuAffinity)
+    except Exception as e:
+        exc_type, exc_value, exc_traceback = sys.exc_info()
+        print("Exception occurred: {}".format(e))
+        print("Traceback:")
+        traceback.print_tb(exc_traceback)
+        exit(1)
+
+
+def fits(mode, size):
+    if mode == 'struct':
+        return size <= STRUCT_MAX_PAYLOAD
+    return True
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--modes', nargs='+', choices=MODES, default=MODES)
+    parser.add_argument('--sizes', nargs='+', type=int, default=DEFAULT_SIZES,
+                        help='payload sizes in bytes')
+    parser.add_argument('--placements', nargs='+', choices=PLACEMENTS, default=['none', 'fixed'])
+    parser.add_argument('--transports', nargs='+', choices=list(TRANSPORTS), default=['shm'])
+    parser.add_argument('--rounds', type=int, default=10000)
+    parser.add_argument('--warmup', type=int, default=1000)
+    parser.add_argument('--wait-mode', type=str, default='spin')
+    parser.add_argument('--huge-pages', action='store_true',
+                        help='back the segment with transparent huge pages')
+    parser.add_argument('--hugetlbfs', type=str, default=None,
+                        help='hugetlbfs mount to put the segment in, e.g. /dev/hugepages')
+    parser.add_argument('--output', type=str, default='bench.csv',
+                        help='CSV file to append the results to')
+    parser.add_argument('--json', type=str, default=None,
+                        help='also write all the results in the CSV file to this JSON file')
+    # used by the runner to start one configuration
+    parser.add_argument('--worker', action='store_true', help=argparse.SUPPRESS)
+    parser.add_argument('--mode', type=str, help=argparse.SUPPRESS)
+    parser.add_argument('--size', type=int, help=argparse.SUPPRESS)
+    parser.add_argument('--placement', type=str, help=argparse.SUPPRESS)
+    parser.add_argument('--transport', type=str, default='shm', help=argparse.SUPPRESS)
+    args = parser.parse_args()
+
+    if args.worker:
+        run_worker(args)
+        return
+
+    common = ['--rounds', str(args.rounds), '--warmup', str(args.warmup),
+              '--wait-mode', args.wait_mode, '--output', os.path.abspath(args.output)]
+    if args.huge_pages:
+        common.append('--huge-pages')
+    if args.hugetlbfs is not None:
+        common += ['--hugetlbfs', args.hugetlbfs]
+    for mode in args.modes:
+        for transport in args.transports:
+            for placement in args.placements:
+                for size in args.sizes:
+                    if not fits(mode, size):
+                        print('Skipping {} bytes, too large for mode {}'.format(size, mode))
+                        continue
+                    print('Running mode {}, transport {}, placement {}, payload {} bytes'.format(
+                        mode, transport, placement, size))
+                    subprocess.run([sys.executable, os.path.abspath(__file__), '--worker',
+                                    '--mode', mode, '--transport', transport, '--size', str(size),
+                                    '--placement', placement] + common)
+
+    print('Results appended to {}'.format(args.output))
+    if args.json is not None:
+        with open(args.output, newline='') as f:
+            rows = list(csv.DictReader(f))
+        for row in rows:
+            for key, value in row.items():
+                if key not in ('mode', 'transport', 'placement', 'wait_mode'):
+                    row[key] = float(value)
+        with open(args.json, 'w') as f:
+            json.dump(rows, f, indent=2)
+        print('Results written to {}'.format(args.json))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:  Muyuan Shen <muyuan_shen@hust.edu.cn>
+ */
+
+#include "bench.h"
+
+#include <ns3/ai-module.h>
+#include <ns3-ai-msg-numpy.h>
+
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include <string>
+#include <vector>
+
+namespace py = pybind11;
+
+typedef ns3::Ns3AiMsgInterfaceImpl<uint8_t, BenchReply> BenchVectorInterface;
+
+PYBIND11_MAKE_OPAQUE(BenchVectorInterface::Cpp2PyMsgVector);
+PYBIND11_MAKE_OPAQUE(BenchVectorInterface::Py2CppMsgVector);
+
+/**
+ * Binds the methods shared by the struct-based and vector-based interfaces
+ */
+template <typename Interface>
+py::class_<Interface>
+BindInterface(py::module_& m)
+{
+    return py::class_<Interface>(m, "Ns3AiMsgInterfaceImpl")
+        .def(py::init<bool,
+                      bool,
+                      bool,
+                      uint32_t,
+                      const char*,
+                      const char*,
+                      const char*,
+                      const char*>())
+        .def("PyRecvBegin", &Interface::PyRecvBegin, py::call_guard<py::gil_scoped_release>())
+        .def("PyRecvEnd", &Interface::PyRecvEnd, py::call_guard<py::gil_scoped_release>())
+        .def("PySendBegin", &Interface::PySendBegin, py::call_guard<py::gil_scoped_release>())
+        .def("PySendEnd", &Interface::PySendEnd, py::call_guard<py::gil_scoped_release>())
+        .def("PyGetFinished", &Interface::PyGetFinished)
+        .def("SetWaitMode",
+             [](Interface& self, uint8_t mode, uint32_t spinBudgetUs) {
+                 self.SetWaitMode(static_cast<ns3::Ns3AiSemaphore::WaitMode>(mode), spinBudgetUs);
+             })
+        .def("SetHugePages", &Interface::SetHugePages)
+        .def("GetMemorySize", &Interface::GetMemorySize)
+        .def("GetFreeMemory", &Interface::GetFreeMemory)
+        .def("EnableStats", &Interface::EnableStats)
+        .def("GetStats", [](Interface& self) -> py::object {
+            const ns3::Ns3AiMsgStats* stats = self.GetStats();
+            return stats ? py::cast(stats->ToMap()) : py::none();
+        });
+}
+
+/**
+ * Binds the struct-based interface of each capacity, in a submodule
+ * stru_<capacity> since their classes have the same names
+ */
+template <uint32_t... Capacities>
+void
+BindStructInterfaces(py::module_& m, std::integer_sequence<uint32_t, Capacities...>)
+{
+    (
+        [&m]() {
+            typedef BenchStruct<Capacities> Struct;
+            typedef ns3::Ns3AiMsgInterfaceImpl<Struct, BenchReply> StructInterface;
+            py::module_ stru = m.def_submodule(("stru_" + std::to_string(Capacities)).c_str(),
+                                               "Struct-based interface of the benchmark");
+            py::class_<Struct>(stru, "PyBenchStruct")
+                .def_readonly("size", &Struct::size)
+                .def("get_data", [](Struct& msg) {
+                    return py::memoryview::from_memory(msg.data, msg.size, true);
+                });
+            BindInterface<StructInterface>(stru)
+                .def("GetCpp2PyStruct",
+                     &StructInterface::GetCpp2PyStruct,
+                     py::return_value_policy::reference)
+                .def("GetPy2CppStruct",
+                     &StructInterface::GetPy2CppStruct,
+                     py::return_value_policy::reference);
+        }(),
+        ...);
+    m.attr("STRUCT_CAPACITIES") = std::vector<uint32_t>{Capacities...};
+}
+
+PYBIND11_MODULE(ns3ai_apb_py_bench, m)
+{
+    py::class_<BenchReply>(m, "PyBenchReply").def_readwrite("check", &BenchReply::check);
+    PYBIND11_NUMPY_DTYPE(BenchReply, check);
+
+    // vector-based interface, the payload is a vector of bytes
+    ns3::Ns3AiBindMsgVector<BenchVectorInterface::Cpp2PyMsgVector>(m, "PyBenchVector");
+    ns3::Ns3AiBindMsgVector<BenchVectorInterface::Py2CppMsgVector>(m, "PyBenchReplyVector");
+    BindInterface<BenchVectorInterface>(m)
+        .def("ResizeCpp2PyVector", &BenchVectorInterface::ResizeCpp2PyVector)
+        .def("ResizePy2CppVector", &BenchVectorInterface::ResizePy2CppVector)
+        .def("GetCpp2PyVector",
+             &BenchVectorInterface::GetCpp2PyVector,
+             py::return_value_policy::reference)
+        .def("GetPy2CppVector",
+             &BenchVectorInterface::GetPy2CppVector,
+             py::return_value_policy::reference);
+
+    // struct-based interfaces, one per capacity (see BenchStructCapacities)
+    BindStructInterfaces(m, BenchStructCapacities());
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Muyuan Shen <muyuan_shen@hust.edu.cn>
+ */
+
+#include "apb.h"
+
+#include <ns3/ai-module.h>
+
+#include <chrono>
+#include <iostream>
+#include <random>
+
+#define NUM_ENV 10000
+
+using namespace ns3;
+
+int
+main()
+{
+    auto interface = Ns3AiMsgInterface::Get();
+    interface->SetIsMemoryCreator(false);
+    interface->SetHandleFinish(true);
+    Ns3AiMsgRingImpl<EnvStruct>* ring = interface->GetRingInterface<EnvStruct>();
+
+    unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> distrib(1, 10);
+
+    // C++ never waits for Python unless the ring is full
+    uint64_t total = 0;
+    for (int i = 0; i < NUM_ENV; ++i)
+    {
+        EnvStruct* env = ring->CppSendBegin();
+        env->env_a = distrib(gen);
+        env->env_b = distrib(gen);
+        total += env->env_a + env->env_b;
+        ring->CppSendEnd();
+    }
+    std::cout << "set: " << NUM_ENV << " pairs, total sum " << total << "\n";
+}
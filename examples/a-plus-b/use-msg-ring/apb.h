@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2020-2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Pengyu Liu <eic_lpy@hust.edu.cn>
+ *          Hao Yin <haoyin@uw.edu>
+ *          Muyuan Shen <muyuan_shen@hust.edu.cn>
+ */
+
+#ifndef APB_H
+#define APB_H
+
+#include <cstdint>
+
+struct EnvStruct
+{
+    uint32_t env_a;
+    uint32_t env_b;
+};
+
+struct ActStruct
+{
+    uint32_t act_c;
+};
+
+#endif // APB_H
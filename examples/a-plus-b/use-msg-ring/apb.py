@@ -0,0 +1,58 @@
+# Copyright (c) 2023 Huazhong University of Science and Technology
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License version 2 as
+# published by the Free Software Foundation;
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+#
+# Author: Muyuan Shen <muyuan_shen@hust.edu.cn>
+
+
+import ns3ai_apb_py_ring as py_binding
+from ns3ai_utils import Experiment
+import sys
+import traceback
+
+RING_DEPTH = 256
+MAX_BATCH = 128
+
+exp = Experiment("ns3ai_apb_msg_ring", "../../../../../", py_binding,
+                 handleFinish=True, ringDepth=RING_DEPTH)
+ring = exp.run(show_output=True)
+
+try:
+    total = 0
+    count = 0
+    batches = 0
+    while True:
+        # receive all the pairs available (at most MAX_BATCH) at once
+        batch = ring.PyRecvBatch(MAX_BATCH)
+        if not batch and ring.PyGetFinished():
+            break
+        for env in batch:
+            total += env.a + env.b
+        count += len(batch)
+        batches += 1
+    print("get: {} pairs in {} batches, total sum {}".format(count, batches, total))
+
+except Exception as e:
+    exc_type, exc_value, exc_traceback = sys.exc_info()
+    print("Exception occurred: {}".format(e))
+    print("Traceback:")
+    traceback.print_tb(exc_traceback)
+    exit(1)
+
+else:
+    pass
+
+finally:
+    print("Finally exiting...")
+    del exp
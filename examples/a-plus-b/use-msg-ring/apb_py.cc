@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:  Muyuan Shen <muyuan_shen@hust.edu.cn>
+ */
+
+#include "apb.h"
+
+#include <ns3/ai-module.h>
+
+#include <iostream>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+namespace py = pybind11;
+
+PYBIND11_MODULE(ns3ai_apb_py_ring, m)
+{
+    py::class_<EnvStruct>(m, "PyEnvStruct")
+        .def(py::init<>())
+        .def_readwrite("a", &EnvStruct::env_a)
+        .def_readwrite("b", &EnvStruct::env_b);
+
+    py::class_<ns3::Ns3AiMsgRingImpl<EnvStruct>>(m, "Ns3AiMsgRingImpl")
+        .def(py::init<bool, bool, uint32_t, uint32_t, const char*, const char*, const char*>())
+        .def("PyRecvBatchBegin",
+             &ns3::Ns3AiMsgRingImpl<EnvStruct>::PyRecvBatchBegin,
+             py::call_guard<py::gil_scoped_release>())
+        .def("PyRecvBatchEnd",
+             &ns3::Ns3AiMsgRingImpl<EnvStruct>::PyRecvBatchEnd,
+             py::call_guard<py::gil_scoped_release>())
+        .def("PyGetSlot",
+             &ns3::Ns3AiMsgRingImpl<EnvStruct>::PyGetSlot,
+             py::return_value_policy::reference)
+        .def("PyRecvBatch",
+             [](ns3::Ns3AiMsgRingImpl<EnvStruct>& self, uint32_t maxCount) {
+                 // drain up to maxCount messages with a single call
+                 uint32_t n = self.PyRecvBatchBegin(maxCount);
+                 std::vector<EnvStruct> batch;
+                 batch.reserve(n);
+                 for (uint32_t i = 0; i < n; ++i)
+                 {
+                     batch.push_back(*self.PyGetSlot(i));
+                 }
+                 self.PyRecvBatchEnd();
+                 return batch;
+             },
+             py::call_guard<py::gil_scoped_release>())
+        .def("SetHugePages", &ns3::Ns3AiMsgRingImpl<EnvStruct>::SetHugePages)
+        .def("PyGetFinished", &ns3::Ns3AiMsgRingImpl<EnvStruct>::PyGetFinished)
+        .def("GetCapacity", &ns3::Ns3AiMsgRingImpl<EnvStruct>::GetCapacity)
+        .def("SetWaitMode",
+             [](ns3::Ns3AiMsgRingImpl<EnvStruct>& self, uint8_t mode, uint32_t spinBudgetUs) {
+                 self.SetWaitMode(static_cast<Ns3AiSemaphore::WaitMode>(mode), spinBudgetUs);
+             })
+        .def("GetSendWaitStats",
+             [](ns3::Ns3AiMsgRingImpl<EnvStruct>& self) {
+                 return self.GetSendWaitStats().ToMap();
+             })
+        .def("GetRecvWaitStats", [](ns3::Ns3AiMsgRingImpl<EnvStruct>& self) {
+            return self.GetRecvWaitStats().ToMap();
+        });
+}
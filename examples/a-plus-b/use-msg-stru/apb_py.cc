@@ -20,9 +20,14 @@
 #include "apb.h"
 
 #include <ns3/ai-module.h>
+#include <ns3-ai-msg-async-py.h>
+#include <ns3-ai-launch-py.h>
+#include <ns3-ai-msg-replay-py.h>
+#include <ns3-ai-snapshot-py.h>
 
 #include <iostream>
 #include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
 
 namespace py = pybind11;
 
@@ -44,10 +49,41 @@ PYBIND11_MODULE(ns3ai_apb_py_stru, m)
                       const char*,
                       const char*,
                       const char*>())
-        .def("PyRecvBegin", &ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::PyRecvBegin)
-        .def("PyRecvEnd", &ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::PyRecvEnd)
-        .def("PySendBegin", &ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::PySendBegin)
-        .def("PySendEnd", &ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::PySendEnd)
+        .def("PyRecvBegin",
+             &ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::PyRecvBegin,
+             py::call_guard<py::gil_scoped_release>())
+        .def("PyRecvEnd",
+             &ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::PyRecvEnd,
+             py::call_guard<py::gil_scoped_release>())
+        .def("PySendBegin",
+             &ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::PySendBegin,
+             py::call_guard<py::gil_scoped_release>())
+        .def("PySendEnd",
+             &ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::PySendEnd,
+             py::call_guard<py::gil_scoped_release>())
+        .def("SetWaitMode",
+             [](ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>& self,
+                uint8_t mode,
+                uint32_t spinBudgetUs) {
+                 self.SetWaitMode(static_cast<Ns3AiSemaphore::WaitMode>(mode), spinBudgetUs);
+             })
+        .def("GetSendWaitStats",
+             [](ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>& self) {
+                 return self.GetSendWaitStats().ToMap();
+             })
+        .def("GetRecvWaitStats",
+             [](ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>& self) {
+                 return self.GetRecvWaitStats().ToMap();
+             })
+        .def("SetHugePages", &ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::SetHugePages)
+        .def("GetMemorySize", &ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::GetMemorySize)
+        .def("GetFreeMemory", &ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::GetFreeMemory)
+        .def("EnableStats", &ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::EnableStats)
+        .def("GetStats",
+             [](ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>& self) -> py::object {
+                 const ns3::Ns3AiMsgStats* stats = self.GetStats();
+                 return stats ? py::cast(stats->ToMap()) : py::none();
+             })
         .def("PyGetFinished", &ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::PyGetFinished)
         .def("GetCpp2PyStruct",
              &ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::GetCpp2PyStruct,
@@ -55,4 +91,9 @@ PYBIND11_MODULE(ns3ai_apb_py_stru, m)
         .def("GetPy2CppStruct",
              &ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::GetPy2CppStruct,
              py::return_value_policy::reference);
+
+    ns3::Ns3AiBindMsgReplayer<EnvStruct, ActStruct>(m);
+    ns3::Ns3AiBindMsgAsync<EnvStruct, ActStruct>(m);
+    ns3::Ns3AiBindSnapshot(m);
+    ns3::Ns3AiBindLaunch(m);
 }
@@ -26,6 +26,9 @@ APB_SIZE = 3
 exp = Experiment("ns3ai_apb_msg_vec", "../../../../../", py_binding,
                  handleFinish=True, useVector=True, vectorSize=APB_SIZE)
 msgInterface = exp.run(show_output=True)
+# NumPy views of the shared memory, the whole batch is computed at once
+envArray = msgInterface.GetCpp2PyVector().as_numpy()
+actArray = msgInterface.GetPy2CppVector().as_numpy()
 
 try:
     while True:
@@ -36,9 +39,8 @@ try:
 
         # send to C++ side
         msgInterface.PySendBegin()
-        for i in range(len(msgInterface.GetCpp2PyVector())):
-            # calculate the sums
-            msgInterface.GetPy2CppVector()[i].c = msgInterface.GetCpp2PyVector()[i].a + msgInterface.GetCpp2PyVector()[i].b
+        # calculate the sums
+        actArray['c'] = envArray['a'] + envArray['b']
         msgInterface.PyRecvEnd()
         msgInterface.PySendEnd()
 
@@ -20,9 +20,16 @@
 #include "apb.h"
 
 #include <ns3/ai-module.h>
+#include <ns3-ai-msg-numpy.h>
+#include <ns3-ai-msg-async-py.h>
+#include <ns3-ai-launch-py.h>
+#include <ns3-ai-msg-replay-py.h>
+#include <ns3-ai-snapshot-py.h>
 
 #include <iostream>
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
 
 namespace py = pybind11;
 
@@ -38,47 +45,15 @@ PYBIND11_MODULE(ns3ai_apb_py_vec, m)
 
     py::class_<ActStruct>(m, "PyActStruct").def(py::init<>()).def_readwrite("c", &ActStruct::act_c);
 
-    py::class_<ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::Cpp2PyMsgVector>(m, "PyEnvVector")
-        .def(
-            "resize",
-            static_cast<void (ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::Cpp2PyMsgVector::*)(
-                ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::Cpp2PyMsgVector::size_type)>(
-                &ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::Cpp2PyMsgVector::resize))
-        .def("__len__", &ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::Cpp2PyMsgVector::size)
-        .def(
-            "__getitem__",
-            [](ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::Cpp2PyMsgVector& vec,
-               uint32_t i) -> EnvStruct& {
-                if (i >= vec.size())
-                {
-                    std::cerr << "Invalid index " << i << " for vector, whose size is "
-                              << vec.size() << std::endl;
-                    exit(1);
-                }
-                return vec.at(i);
-            },
-            py::return_value_policy::reference);
+    PYBIND11_NUMPY_DTYPE_EX(EnvStruct, env_a, "a", env_b, "b");
+    PYBIND11_NUMPY_DTYPE_EX(ActStruct, act_c, "c");
 
-    py::class_<ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::Py2CppMsgVector>(m, "PyActVector")
-        .def(
-            "resize",
-            static_cast<void (ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::Py2CppMsgVector::*)(
-                ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::Py2CppMsgVector::size_type)>(
-                &ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::Py2CppMsgVector::resize))
-        .def("__len__", &ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::Py2CppMsgVector::size)
-        .def(
-            "__getitem__",
-            [](ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::Py2CppMsgVector& vec,
-               uint32_t i) -> ActStruct& {
-                if (i >= vec.size())
-                {
-                    std::cerr << "Invalid index " << i << " for vector, whose size is "
-                              << vec.size() << std::endl;
-                    exit(1);
-                }
-                return vec.at(i);
-            },
-            py::return_value_policy::reference);
+    ns3::Ns3AiBindMsgVector<ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::Cpp2PyMsgVector>(
+        m,
+        "PyEnvVector");
+    ns3::Ns3AiBindMsgVector<ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::Py2CppMsgVector>(
+        m,
+        "PyActVector");
 
     py::class_<ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>>(m, "Ns3AiMsgInterfaceImpl")
         .def(py::init<bool,
@@ -89,10 +64,45 @@ PYBIND11_MODULE(ns3ai_apb_py_vec, m)
                       const char*,
                       const char*,
                       const char*>())
-        .def("PyRecvBegin", &ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::PyRecvBegin)
-        .def("PyRecvEnd", &ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::PyRecvEnd)
-        .def("PySendBegin", &ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::PySendBegin)
-        .def("PySendEnd", &ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::PySendEnd)
+        .def("PyRecvBegin",
+             &ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::PyRecvBegin,
+             py::call_guard<py::gil_scoped_release>())
+        .def("PyRecvEnd",
+             &ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::PyRecvEnd,
+             py::call_guard<py::gil_scoped_release>())
+        .def("PySendBegin",
+             &ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::PySendBegin,
+             py::call_guard<py::gil_scoped_release>())
+        .def("PySendEnd",
+             &ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::PySendEnd,
+             py::call_guard<py::gil_scoped_release>())
+        .def("SetWaitMode",
+             [](ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>& self,
+                uint8_t mode,
+                uint32_t spinBudgetUs) {
+                 self.SetWaitMode(static_cast<Ns3AiSemaphore::WaitMode>(mode), spinBudgetUs);
+             })
+        .def("GetSendWaitStats",
+             [](ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>& self) {
+                 return self.GetSendWaitStats().ToMap();
+             })
+        .def("GetRecvWaitStats",
+             [](ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>& self) {
+                 return self.GetRecvWaitStats().ToMap();
+             })
+        .def("SetHugePages", &ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::SetHugePages)
+        .def("GetMemorySize", &ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::GetMemorySize)
+        .def("GetFreeMemory", &ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::GetFreeMemory)
+        .def("EnableStats", &ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::EnableStats)
+        .def("GetStats",
+             [](ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>& self) -> py::object {
+                 const ns3::Ns3AiMsgStats* stats = self.GetStats();
+                 return stats ? py::cast(stats->ToMap()) : py::none();
+             })
+        .def("ResizeCpp2PyVector",
+             &ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::ResizeCpp2PyVector)
+        .def("ResizePy2CppVector",
+             &ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::ResizePy2CppVector)
         .def("PyGetFinished", &ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::PyGetFinished)
         .def("GetCpp2PyVector",
              &ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::GetCpp2PyVector,
@@ -100,4 +110,9 @@ PYBIND11_MODULE(ns3ai_apb_py_vec, m)
         .def("GetPy2CppVector",
              &ns3::Ns3AiMsgInterfaceImpl<EnvStruct, ActStruct>::GetPy2CppVector,
              py::return_value_policy::reference);
+
+    ns3::Ns3AiBindMsgReplayer<EnvStruct, ActStruct>(m);
+    ns3::Ns3AiBindMsgAsync<EnvStruct, ActStruct>(m);
+    ns3::Ns3AiBindSnapshot(m);
+    ns3::Ns3AiBindLaunch(m);
 }
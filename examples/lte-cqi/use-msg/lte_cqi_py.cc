@@ -47,13 +47,17 @@ PYBIND11_MODULE(ns3ai_ltecqi_py, m)
                       const char*,
                       const char*>())
         .def("PyRecvBegin",
-             &ns3::Ns3AiMsgInterfaceImpl<ns3::CqiFeature, ns3::CqiPredicted>::PyRecvBegin)
+             &ns3::Ns3AiMsgInterfaceImpl<ns3::CqiFeature, ns3::CqiPredicted>::PyRecvBegin,
+             py::call_guard<py::gil_scoped_release>())
         .def("PyRecvEnd",
-             &ns3::Ns3AiMsgInterfaceImpl<ns3::CqiFeature, ns3::CqiPredicted>::PyRecvEnd)
+             &ns3::Ns3AiMsgInterfaceImpl<ns3::CqiFeature, ns3::CqiPredicted>::PyRecvEnd,
+             py::call_guard<py::gil_scoped_release>())
         .def("PySendBegin",
-             &ns3::Ns3AiMsgInterfaceImpl<ns3::CqiFeature, ns3::CqiPredicted>::PySendBegin)
+             &ns3::Ns3AiMsgInterfaceImpl<ns3::CqiFeature, ns3::CqiPredicted>::PySendBegin,
+             py::call_guard<py::gil_scoped_release>())
         .def("PySendEnd",
-             &ns3::Ns3AiMsgInterfaceImpl<ns3::CqiFeature, ns3::CqiPredicted>::PySendEnd)
+             &ns3::Ns3AiMsgInterfaceImpl<ns3::CqiFeature, ns3::CqiPredicted>::PySendEnd,
+             py::call_guard<py::gil_scoped_release>())
         .def("PyGetFinished",
              &ns3::Ns3AiMsgInterfaceImpl<ns3::CqiFeature, ns3::CqiPredicted>::PyGetFinished)
         .def("GetCpp2PyStruct",
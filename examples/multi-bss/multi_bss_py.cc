@@ -20,9 +20,16 @@
 #include "multi-bss.h"
 
 #include <ns3/ai-module.h>
+#include <ns3-ai-msg-numpy.h>
+#include <ns3-ai-msg-async-py.h>
+#include <ns3-ai-launch-py.h>
+#include <ns3-ai-msg-replay-py.h>
+#include <ns3-ai-snapshot-py.h>
 
 #include <iostream>
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
 #include <pybind11/stl_bind.h>
 
 namespace py = pybind11;
@@ -58,43 +65,13 @@ PYBIND11_MODULE(ns3ai_multibss_py, m)
         .def(py::init<>())
         .def_readwrite("newCcaSensitivity", &Act::newCcaSensitivity);
 
-    py::class_<ns3::Ns3AiMsgInterfaceImpl<Env, Act>::Cpp2PyMsgVector>(m, "PyEnvVector")
-        .def("resize",
-             static_cast<void (ns3::Ns3AiMsgInterfaceImpl<Env, Act>::Cpp2PyMsgVector::*)(
-                 ns3::Ns3AiMsgInterfaceImpl<Env, Act>::Cpp2PyMsgVector::size_type)>(
-                 &ns3::Ns3AiMsgInterfaceImpl<Env, Act>::Cpp2PyMsgVector::resize))
-        .def("__len__", &ns3::Ns3AiMsgInterfaceImpl<Env, Act>::Cpp2PyMsgVector::size)
-        .def(
-            "__getitem__",
-            [](ns3::Ns3AiMsgInterfaceImpl<Env, Act>::Cpp2PyMsgVector& vec, uint32_t i) -> Env& {
-                if (i >= vec.size())
-                {
-                    std::cerr << "Invalid index " << i << " for vector, whose size is "
-                              << vec.size() << std::endl;
-                    exit(1);
-                }
-                return vec.at(i);
-            },
-            py::return_value_policy::reference);
+    PYBIND11_NUMPY_DTYPE(Env, txNode, rxPower, mcs, holDelay, throughput);
+    PYBIND11_NUMPY_DTYPE(Act, newCcaSensitivity);
 
-    py::class_<ns3::Ns3AiMsgInterfaceImpl<Env, Act>::Py2CppMsgVector>(m, "PyActVector")
-        .def("resize",
-             static_cast<void (ns3::Ns3AiMsgInterfaceImpl<Env, Act>::Py2CppMsgVector::*)(
-                 ns3::Ns3AiMsgInterfaceImpl<Env, Act>::Py2CppMsgVector::size_type)>(
-                 &ns3::Ns3AiMsgInterfaceImpl<Env, Act>::Py2CppMsgVector::resize))
-        .def("__len__", &ns3::Ns3AiMsgInterfaceImpl<Env, Act>::Py2CppMsgVector::size)
-        .def(
-            "__getitem__",
-            [](ns3::Ns3AiMsgInterfaceImpl<Env, Act>::Py2CppMsgVector& vec, uint32_t i) -> Act& {
-                if (i >= vec.size())
-                {
-                    std::cerr << "Invalid index " << i << " for vector, whose size is "
-                              << vec.size() << std::endl;
-                    exit(1);
-                }
-                return vec.at(i);
-            },
-            py::return_value_policy::reference);
+    ns3::Ns3AiBindMsgVector<ns3::Ns3AiMsgInterfaceImpl<Env, Act>::Cpp2PyMsgVector>(m,
+                                                                                   "PyEnvVector");
+    ns3::Ns3AiBindMsgVector<ns3::Ns3AiMsgInterfaceImpl<Env, Act>::Py2CppMsgVector>(m,
+                                                                                   "PyActVector");
 
     py::class_<ns3::Ns3AiMsgInterfaceImpl<Env, Act>>(m, "Ns3AiMsgInterfaceImpl")
         .def(py::init<bool,
@@ -105,10 +82,29 @@ PYBIND11_MODULE(ns3ai_multibss_py, m)
                       const char*,
                       const char*,
                       const char*>())
-        .def("PyRecvBegin", &ns3::Ns3AiMsgInterfaceImpl<Env, Act>::PyRecvBegin)
-        .def("PyRecvEnd", &ns3::Ns3AiMsgInterfaceImpl<Env, Act>::PyRecvEnd)
-        .def("PySendBegin", &ns3::Ns3AiMsgInterfaceImpl<Env, Act>::PySendBegin)
-        .def("PySendEnd", &ns3::Ns3AiMsgInterfaceImpl<Env, Act>::PySendEnd)
+        .def("PyRecvBegin",
+             &ns3::Ns3AiMsgInterfaceImpl<Env, Act>::PyRecvBegin,
+             py::call_guard<py::gil_scoped_release>())
+        .def("PyRecvEnd",
+             &ns3::Ns3AiMsgInterfaceImpl<Env, Act>::PyRecvEnd,
+             py::call_guard<py::gil_scoped_release>())
+        .def("PySendBegin",
+             &ns3::Ns3AiMsgInterfaceImpl<Env, Act>::PySendBegin,
+             py::call_guard<py::gil_scoped_release>())
+        .def("PySendEnd",
+             &ns3::Ns3AiMsgInterfaceImpl<Env, Act>::PySendEnd,
+             py::call_guard<py::gil_scoped_release>())
+        .def("SetHugePages", &ns3::Ns3AiMsgInterfaceImpl<Env, Act>::SetHugePages)
+        .def("GetMemorySize", &ns3::Ns3AiMsgInterfaceImpl<Env, Act>::GetMemorySize)
+        .def("GetFreeMemory", &ns3::Ns3AiMsgInterfaceImpl<Env, Act>::GetFreeMemory)
+        .def("EnableStats", &ns3::Ns3AiMsgInterfaceImpl<Env, Act>::EnableStats)
+        .def("GetStats",
+             [](ns3::Ns3AiMsgInterfaceImpl<Env, Act>& self) -> py::object {
+                 const ns3::Ns3AiMsgStats* stats = self.GetStats();
+                 return stats ? py::cast(stats->ToMap()) : py::none();
+             })
+        .def("ResizeCpp2PyVector", &ns3::Ns3AiMsgInterfaceImpl<Env, Act>::ResizeCpp2PyVector)
+        .def("ResizePy2CppVector", &ns3::Ns3AiMsgInterfaceImpl<Env, Act>::ResizePy2CppVector)
         .def("PyGetFinished", &ns3::Ns3AiMsgInterfaceImpl<Env, Act>::PyGetFinished)
         .def("GetCpp2PyVector",
              &ns3::Ns3AiMsgInterfaceImpl<Env, Act>::GetCpp2PyVector,
@@ -116,4 +112,9 @@ PYBIND11_MODULE(ns3ai_multibss_py, m)
         .def("GetPy2CppVector",
              &ns3::Ns3AiMsgInterfaceImpl<Env, Act>::GetPy2CppVector,
              py::return_value_policy::reference);
+
+    ns3::Ns3AiBindMsgReplayer<Env, Act>(m);
+    ns3::Ns3AiBindMsgAsync<Env, Act>(m);
+    ns3::Ns3AiBindSnapshot(m);
+    ns3::Ns3AiBindLaunch(m);
 }
@@ -208,6 +208,9 @@ eta = 1
 exp = Experiment("ns3ai_multibss", "../../../../", py_binding,
                  handleFinish=True, useVector=True, vectorSize=n_total)
 msgInterface = exp.run(setting=ns3Settings, show_output=True)
+# NumPy views of the shared memory, no per-element access from Python
+envArray = msgInterface.GetCpp2PyVector().as_numpy()
+actArray = msgInterface.GetPy2CppVector().as_numpy()
 
 try:
     while True:
@@ -216,20 +219,16 @@ try:
         if msgInterface.PyGetFinished():
             print("Finished")
             break
-        throughput = 0
-        for i in range(n_total):
-            txNode = msgInterface.GetCpp2PyVector()[i].txNode
-            # print("processing i {} txNode {}".format(i, txNode))
-            for j in range(n_sta+1):
-                state[j, txNode] = msgInterface.GetCpp2PyVector()[i].rxPower[j]
-            # state[:, txNode] = msgInterface.GetCpp2PyVector()[i].rxPower
-            if txNode % n_ap == 0:  # record mcs in BSS-0
-                state[int(txNode/n_ap)][-1] = msgInterface.GetCpp2PyVector()[i].mcs
-            if txNode == n_ap:     # record delay and tpt of the VR node
-                vrDelay = msgInterface.GetCpp2PyVector()[i].holDelay
-                vrThroughput = msgInterface.GetCpp2PyVector()[i].throughput
-            # Sum all nodes' throughput
-            throughput += msgInterface.GetCpp2PyVector()[i].throughput
+        txNode = envArray['txNode']
+        state[:, txNode] = envArray['rxPower'][:, :n_sta+1].T
+        bss0 = txNode % n_ap == 0  # record mcs in BSS-0
+        state[txNode[bss0] // n_ap, -1] = envArray['mcs'][bss0]
+        vr = np.flatnonzero(txNode == n_ap)  # record delay and tpt of the VR node
+        if vr.size > 0:
+            vrDelay = envArray['holDelay'][vr[-1]]
+            vrThroughput = envArray['throughput'][vr[-1]]
+        # Sum all nodes' throughput
+        throughput = envArray['throughput'].sum()
         msgInterface.PyRecvEnd()
 
         print("step = {}, VR avg delay = {} ms, VR UL tpt = {} Mbps, total UL tpt = {} Mbps".format(
@@ -257,9 +256,9 @@ try:
 
         # put the action back to C++
         msgInterface.PySendBegin()
-        msgInterface.GetPy2CppVector()[0].newCcaSensitivity = -82 + action
+        actArray[0]['newCcaSensitivity'] = -82 + action.item()
         msgInterface.PySendEnd()
-        print("new CCA: {}".format(msgInterface.GetPy2CppVector()[0].newCcaSensitivity))
+        print("new CCA: {}".format(actArray[0]['newCcaSensitivity']))
         times += 1
 
 except Exception as e:
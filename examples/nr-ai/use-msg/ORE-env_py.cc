@@ -56,16 +56,20 @@ PYBIND11_MODULE(ns3ai_ore_py_stru, m)
                       const char*>())
         .def("PyRecvBegin",
              &ns3::Ns3AiMsgInterfaceImpl<ns3::OREEnvStruct,
-                                         ns3::OREActStruct>::PyRecvBegin)
+                                         ns3::OREActStruct>::PyRecvBegin,
+             py::call_guard<py::gil_scoped_release>())
         .def("PyRecvEnd",
              &ns3::Ns3AiMsgInterfaceImpl<ns3::OREEnvStruct,
-                                         ns3::OREActStruct>::PyRecvEnd)
+                                         ns3::OREActStruct>::PyRecvEnd,
+             py::call_guard<py::gil_scoped_release>())
         .def("PySendBegin",
              &ns3::Ns3AiMsgInterfaceImpl<ns3::OREEnvStruct,
-                                         ns3::OREActStruct>::PySendBegin)
+                                         ns3::OREActStruct>::PySendBegin,
+             py::call_guard<py::gil_scoped_release>())
         .def("PySendEnd",
              &ns3::Ns3AiMsgInterfaceImpl<ns3::OREEnvStruct,
-                                         ns3::OREActStruct>::PySendEnd)
+                                         ns3::OREActStruct>::PySendEnd,
+             py::call_guard<py::gil_scoped_release>())
         .def("PyGetFinished",
              &ns3::Ns3AiMsgInterfaceImpl<ns3::OREEnvStruct,
                                          ns3::OREActStruct>::PyGetFinished)
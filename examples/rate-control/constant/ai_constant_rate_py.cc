@@ -52,16 +52,20 @@ PYBIND11_MODULE(ns3ai_ratecontrol_constant_py, m)
                       const char*>())
         .def("PyRecvBegin",
              &ns3::Ns3AiMsgInterfaceImpl<ns3::AiConstantRateEnvStruct,
-                                         ns3::AiConstantRateActStruct>::PyRecvBegin)
+             ns3::AiConstantRateActStruct>::PyRecvBegin,
+             py::call_guard<py::gil_scoped_release>())
         .def("PyRecvEnd",
              &ns3::Ns3AiMsgInterfaceImpl<ns3::AiConstantRateEnvStruct,
-                                         ns3::AiConstantRateActStruct>::PyRecvEnd)
+             ns3::AiConstantRateActStruct>::PyRecvEnd,
+             py::call_guard<py::gil_scoped_release>())
         .def("PySendBegin",
              &ns3::Ns3AiMsgInterfaceImpl<ns3::AiConstantRateEnvStruct,
-                                         ns3::AiConstantRateActStruct>::PySendBegin)
+             ns3::AiConstantRateActStruct>::PySendBegin,
+             py::call_guard<py::gil_scoped_release>())
         .def("PySendEnd",
              &ns3::Ns3AiMsgInterfaceImpl<ns3::AiConstantRateEnvStruct,
-                                         ns3::AiConstantRateActStruct>::PySendEnd)
+             ns3::AiConstantRateActStruct>::PySendEnd,
+             py::call_guard<py::gil_scoped_release>())
         .def("PyGetFinished",
              &ns3::Ns3AiMsgInterfaceImpl<ns3::AiConstantRateEnvStruct,
                                          ns3::AiConstantRateActStruct>::PyGetFinished)
@@ -99,16 +99,20 @@ PYBIND11_MODULE(ns3ai_ratecontrol_ts_py, m)
                       const char*>())
         .def("PyRecvBegin",
              &ns3::Ns3AiMsgInterfaceImpl<ns3::AiThompsonSamplingEnvStruct,
-                                         ns3::AiThompsonSamplingActStruct>::PyRecvBegin)
+             ns3::AiThompsonSamplingActStruct>::PyRecvBegin,
+             py::call_guard<py::gil_scoped_release>())
         .def("PyRecvEnd",
              &ns3::Ns3AiMsgInterfaceImpl<ns3::AiThompsonSamplingEnvStruct,
-                                         ns3::AiThompsonSamplingActStruct>::PyRecvEnd)
+             ns3::AiThompsonSamplingActStruct>::PyRecvEnd,
+             py::call_guard<py::gil_scoped_release>())
         .def("PySendBegin",
              &ns3::Ns3AiMsgInterfaceImpl<ns3::AiThompsonSamplingEnvStruct,
-                                         ns3::AiThompsonSamplingActStruct>::PySendBegin)
+             ns3::AiThompsonSamplingActStruct>::PySendBegin,
+             py::call_guard<py::gil_scoped_release>())
         .def("PySendEnd",
              &ns3::Ns3AiMsgInterfaceImpl<ns3::AiThompsonSamplingEnvStruct,
-                                         ns3::AiThompsonSamplingActStruct>::PySendEnd)
+             ns3::AiThompsonSamplingActStruct>::PySendEnd,
+             py::call_guard<py::gil_scoped_release>())
         .def("PyGetFinished",
              &ns3::Ns3AiMsgInterfaceImpl<ns3::AiThompsonSamplingEnvStruct,
                                          ns3::AiThompsonSamplingActStruct>::PyGetFinished)
@@ -152,7 +152,7 @@ class TcpDeepQAgent:
         self.s = self.s_
         self.s_ = [ssThresh, cWnd, segmentsAcked, segmentSize, bytesInFlight]
         if self.s is not None:  # not first time
-            self.r = segmentsAcked - bytesInFlight - cWnd
+            self.r = int(segmentsAcked) - int(bytesInFlight) - int(cWnd)
             self.dqn.store_transition(self.s, self.a, self.r, self.s_)
             if self.dqn.memory_counter > self.dqn.memory_capacity:
                 self.dqn.learn()
@@ -219,7 +219,7 @@ class TcpQAgent:
         if self.s:  # not first time
             # update Q-table
             self.learning_rate = 0.3 * (0.995 ** (self.update_times // 10))
-            self.r = segmentsAcked - bytesInFlight - cWnd
+            self.r = int(segmentsAcked) - int(bytesInFlight) - int(cWnd)
             self.q_table[tuple(self.s)][tuple(self.a)] = (
                     (1 - self.learning_rate) * self.q_table[tuple(self.s)][tuple(self.a)] +
                     self.learning_rate * (self.r + self.discount_rate * np.max(self.q_table[tuple(self.s_)]))
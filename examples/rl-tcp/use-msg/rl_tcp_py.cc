@@ -53,10 +53,18 @@ PYBIND11_MODULE(ns3ai_rltcp_msg_py, m)
                       const char*,
                       const char*,
                       const char*>())
-        .def("PyRecvBegin", &ns3::Ns3AiMsgInterfaceImpl<ns3::TcpRlEnv, ns3::TcpRlAct>::PyRecvBegin)
-        .def("PyRecvEnd", &ns3::Ns3AiMsgInterfaceImpl<ns3::TcpRlEnv, ns3::TcpRlAct>::PyRecvEnd)
-        .def("PySendBegin", &ns3::Ns3AiMsgInterfaceImpl<ns3::TcpRlEnv, ns3::TcpRlAct>::PySendBegin)
-        .def("PySendEnd", &ns3::Ns3AiMsgInterfaceImpl<ns3::TcpRlEnv, ns3::TcpRlAct>::PySendEnd)
+        .def("PyRecvBegin",
+             &ns3::Ns3AiMsgInterfaceImpl<ns3::TcpRlEnv, ns3::TcpRlAct>::PyRecvBegin,
+             py::call_guard<py::gil_scoped_release>())
+        .def("PyRecvEnd",
+             &ns3::Ns3AiMsgInterfaceImpl<ns3::TcpRlEnv, ns3::TcpRlAct>::PyRecvEnd,
+             py::call_guard<py::gil_scoped_release>())
+        .def("PySendBegin",
+             &ns3::Ns3AiMsgInterfaceImpl<ns3::TcpRlEnv, ns3::TcpRlAct>::PySendBegin,
+             py::call_guard<py::gil_scoped_release>())
+        .def("PySendEnd",
+             &ns3::Ns3AiMsgInterfaceImpl<ns3::TcpRlEnv, ns3::TcpRlAct>::PySendEnd,
+             py::call_guard<py::gil_scoped_release>())
         .def("PyGetFinished",
              &ns3::Ns3AiMsgInterfaceImpl<ns3::TcpRlEnv, ns3::TcpRlAct>::PyGetFinished)
         .def("GetCpp2PyStruct",
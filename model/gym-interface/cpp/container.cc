@@ -79,49 +79,47 @@ OpenGymDataContainer::CreateFromDataContainerPbMsg(ns3_ai_gym::DataContainer& da
         ns3_ai_gym::BoxDataContainer boxContainerPbMsg;
         dataContainerPbMsg.data().UnpackTo(&boxContainerPbMsg);
 
-        if (boxContainerPbMsg.dtype() == ns3_ai_gym::INT)
-        {
-            Ptr<OpenGymBoxContainer<int32_t>> box = CreateObject<OpenGymBoxContainer<int32_t>>();
-            std::vector<int32_t> myData;
-            myData.assign(boxContainerPbMsg.intdata().begin(), boxContainerPbMsg.intdata().end());
-            box->SetData(myData);
-            actDataContainer = box;
-        }
-        else if (boxContainerPbMsg.dtype() == ns3_ai_gym::UINT)
-        {
-            Ptr<OpenGymBoxContainer<uint32_t>> box = CreateObject<OpenGymBoxContainer<uint32_t>>();
-            std::vector<uint32_t> myData;
-            myData.assign(boxContainerPbMsg.uintdata().begin(), boxContainerPbMsg.uintdata().end());
-            box->SetData(myData);
-            actDataContainer = box;
-        }
-        else if (boxContainerPbMsg.dtype() == ns3_ai_gym::FLOAT)
-        {
-            Ptr<OpenGymBoxContainer<float>> box = CreateObject<OpenGymBoxContainer<float>>();
-            std::vector<float> myData;
-            myData.assign(boxContainerPbMsg.floatdata().begin(),
-                          boxContainerPbMsg.floatdata().end());
-            box->SetData(myData);
-            actDataContainer = box;
-        }
-        else if (boxContainerPbMsg.dtype() == ns3_ai_gym::DOUBLE)
-        {
-            Ptr<OpenGymBoxContainer<double>> box = CreateObject<OpenGymBoxContainer<double>>();
-            std::vector<double> myData;
-            myData.assign(boxContainerPbMsg.doubledata().begin(),
-                          boxContainerPbMsg.doubledata().end());
-            box->SetData(myData);
-            actDataContainer = box;
-        }
-        else
-        {
-            Ptr<OpenGymBoxContainer<float>> box = CreateObject<OpenGymBoxContainer<float>>();
-            std::vector<float> myData;
-            myData.assign(boxContainerPbMsg.floatdata().begin(),
-                          boxContainerPbMsg.floatdata().end());
+        // the same container types as OpenGymSpace::CreateFromFlat
+        auto create = [&](auto* type) -> Ptr<OpenGymDataContainer> {
+            using W = std::remove_pointer_t<decltype(type)>;
+            using T = OpenGymElementType<W>;
+            Ptr<OpenGymBoxContainer<T>> box = CreateObject<OpenGymBoxContainer<T>>();
+            std::vector<T> myData;
+            if constexpr (std::is_same<W, int32_t>::value)
+            {
+                myData.assign(boxContainerPbMsg.intdata().begin(),
+                              boxContainerPbMsg.intdata().end());
+            }
+            else if constexpr (std::is_same<W, uint32_t>::value)
+            {
+                myData.assign(boxContainerPbMsg.uintdata().begin(),
+                              boxContainerPbMsg.uintdata().end());
+            }
+            else if constexpr (std::is_same<W, float>::value)
+            {
+                myData.assign(boxContainerPbMsg.floatdata().begin(),
+                              boxContainerPbMsg.floatdata().end());
+            }
+            else if constexpr (std::is_same<W, double>::value)
+            {
+                myData.assign(boxContainerPbMsg.doubledata().begin(),
+                              boxContainerPbMsg.doubledata().end());
+            }
+            else
+            {
+                const std::string& raw = boxContainerPbMsg.rawdata();
+                myData.resize(raw.size() / sizeof(W));
+                for (uint32_t i = 0; i < myData.size(); ++i)
+                {
+                    W value;
+                    std::memcpy(&value, raw.data() + i * sizeof(W), sizeof(W));
+                    myData[i] = static_cast<T>(value);
+                }
+            }
             box->SetData(myData);
-            actDataContainer = box;
-        }
+            return box;
+        };
+        actDataContainer = OpenGymDtypeVisit(boxContainerPbMsg.dtype(), create);
     }
     else if (dataContainerPbMsg.type() == ns3_ai_gym::Tuple)
     {
@@ -166,6 +164,13 @@ OpenGymDataContainer::CreateFromDataContainerPbMsg(ns3_ai_gym::DataContainer& da
     return actDataContainer;
 }
 
+bool
+OpenGymDataContainer::Differs(Ptr<OpenGymDataContainer> /* earlier */,
+                              const std::vector<double>& /* thresholds */) const
+{
+    return true;
+}
+
 TypeId
 OpenGymDiscreteContainer::GetTypeId()
 {
@@ -217,6 +222,43 @@ OpenGymDiscreteContainer::GetDataContainerPbMsg()
     return dataContainerPbMsg;
 }
 
+bool
+OpenGymDiscreteContainer::WriteFlat(uint8_t* buffer,
+                                    const OpenGymFlatLeaf*& leaf,
+                                    const OpenGymFlatLeaf* end) const
+{
+    if (leaf == end || leaf->type != ns3_ai_gym::Discrete)
+    {
+        return false;
+    }
+    // as the int32 field of DiscreteDataContainer
+    int32_t value = m_value;
+    std::memcpy(buffer + (leaf++)->offset, &value, sizeof(value));
+    return true;
+}
+
+bool
+OpenGymDiscreteContainer::ReadFlat(const uint8_t* buffer,
+                                   const OpenGymFlatLeaf*& leaf,
+                                   const OpenGymFlatLeaf* end)
+{
+    if (leaf == end || leaf->type != ns3_ai_gym::Discrete)
+    {
+        return false;
+    }
+    int32_t value;
+    std::memcpy(&value, buffer + (leaf++)->offset, sizeof(value));
+    m_value = value;
+    return true;
+}
+
+Ptr<OpenGymDataContainer>
+OpenGymDiscreteContainer::Pool(Ptr<OpenGymDataContainer> later, bool /* sum */) const
+{
+    // a category cannot be pooled, keep the later one
+    return DynamicCast<OpenGymDiscreteContainer>(later);
+}
+
 bool
 OpenGymDiscreteContainer::SetValue(uint32_t value)
 {
@@ -289,6 +331,57 @@ OpenGymTupleContainer::GetDataContainerPbMsg()
     return dataContainerPbMsg;
 }
 
+bool
+OpenGymTupleContainer::WriteFlat(uint8_t* buffer,
+                                 const OpenGymFlatLeaf*& leaf,
+                                 const OpenGymFlatLeaf* end) const
+{
+    for (const auto& element : m_tuple)
+    {
+        if (!element->WriteFlat(buffer, leaf, end))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool
+OpenGymTupleContainer::ReadFlat(const uint8_t* buffer,
+                                const OpenGymFlatLeaf*& leaf,
+                                const OpenGymFlatLeaf* end)
+{
+    for (const auto& element : m_tuple)
+    {
+        if (!element->ReadFlat(buffer, leaf, end))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+Ptr<OpenGymDataContainer>
+OpenGymTupleContainer::Pool(Ptr<OpenGymDataContainer> later, bool sum) const
+{
+    Ptr<OpenGymTupleContainer> tuple = DynamicCast<OpenGymTupleContainer>(later);
+    if (!tuple || tuple->m_tuple.size() != m_tuple.size())
+    {
+        return nullptr;
+    }
+    Ptr<OpenGymTupleContainer> pooled = CreateObject<OpenGymTupleContainer>();
+    for (uint32_t i = 0; i < m_tuple.size(); ++i)
+    {
+        Ptr<OpenGymDataContainer> element = m_tuple[i]->Pool(tuple->m_tuple[i], sum);
+        if (!element)
+        {
+            return nullptr;
+        }
+        pooled->Add(element);
+    }
+    return pooled;
+}
+
 bool
 OpenGymTupleContainer::Add(Ptr<OpenGymDataContainer> space)
 {
@@ -388,6 +481,63 @@ OpenGymDictContainer::GetDataContainerPbMsg()
     return dataContainerPbMsg;
 }
 
+bool
+OpenGymDictContainer::WriteFlat(uint8_t* buffer,
+                                const OpenGymFlatLeaf*& leaf,
+                                const OpenGymFlatLeaf* end) const
+{
+    // in key order, as the leaves of OpenGymDictSpace
+    for (const auto& item : m_dict)
+    {
+        if (!item.second->WriteFlat(buffer, leaf, end))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool
+OpenGymDictContainer::ReadFlat(const uint8_t* buffer,
+                               const OpenGymFlatLeaf*& leaf,
+                               const OpenGymFlatLeaf* end)
+{
+    // in key order, as the leaves of OpenGymDictSpace
+    for (const auto& item : m_dict)
+    {
+        if (!item.second->ReadFlat(buffer, leaf, end))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+Ptr<OpenGymDataContainer>
+OpenGymDictContainer::Pool(Ptr<OpenGymDataContainer> later, bool sum) const
+{
+    Ptr<OpenGymDictContainer> dict = DynamicCast<OpenGymDictContainer>(later);
+    if (!dict || dict->m_dict.size() != m_dict.size())
+    {
+        return nullptr;
+    }
+    Ptr<OpenGymDictContainer> pooled = CreateObject<OpenGymDictContainer>();
+    for (auto it = m_dict.cbegin(), it2 = dict->m_dict.cbegin(); it != m_dict.cend(); ++it, ++it2)
+    {
+        if (it->first != it2->first)
+        {
+            return nullptr;
+        }
+        Ptr<OpenGymDataContainer> value = it->second->Pool(it2->second, sum);
+        if (!value)
+        {
+            return nullptr;
+        }
+        pooled->Add(it->first, value);
+    }
+    return pooled;
+}
+
 bool
 OpenGymDictContainer::Add(std::string key, Ptr<OpenGymDataContainer> data)
 {
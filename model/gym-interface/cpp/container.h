@@ -23,10 +23,17 @@
 #define OPENGYM_CONTAINER_H
 
 #include "messages.pb.h"
+#include "spaces.h"
 
+#include <ns3/abort.h>
 #include <ns3/object.h>
 #include <ns3/type-name.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+
 namespace ns3
 {
 
@@ -42,6 +49,44 @@ class OpenGymDataContainer : public Object
     static Ptr<OpenGymDataContainer> CreateFromDataContainerPbMsg(
         ns3_ai_gym::DataContainer& dataContainer);
 
+    /**
+     * Writes the data in the flat binary format of the space, compiled by
+     * OpenGymSpace::GetFlatLayout: each leaf from leaf on (advanced past
+     * the leaves written) at its offset in buffer, converted to its dtype.
+     * Returns false if the data does not match the layout (another kind of
+     * container, or another number of elements), the caller then falls
+     * back to protobuf. Dict keys are not checked, only their number.
+     */
+    virtual bool WriteFlat(uint8_t* buffer,
+                           const OpenGymFlatLeaf*& leaf,
+                           const OpenGymFlatLeaf* end) const = 0;
+    /**
+     * Reads the data in place from the flat binary format of the space,
+     * the inverse of WriteFlat, so that a container can be reused for the
+     * next action instead of being created again. Returns false if the
+     * container does not match the layout, it must then be created again
+     * with OpenGymSpace::CreateFromFlat.
+     */
+    virtual bool ReadFlat(const uint8_t* buffer,
+                          const OpenGymFlatLeaf*& leaf,
+                          const OpenGymFlatLeaf* end) = 0;
+    /**
+     * Pools this observation with a later one of the same space, for action
+     * repeat (see OpenGymInterface::SetObservationPooling): returns a new
+     * container with the maximum (or the sum) of each Box element, and the
+     * later value of each Discrete. Returns nullptr if the containers do not
+     * match (another kind of container, type or number of elements).
+     */
+    virtual Ptr<OpenGymDataContainer> Pool(Ptr<OpenGymDataContainer> later, bool sum) const = 0;
+    /**
+     * Whether this observation differs from an earlier one by more than the
+     * thresholds (see OpenGymEnv::SetNotifyThresholds): one per element, or
+     * one for all the elements. Only Box containers compare their elements,
+     * the other ones always differ.
+     */
+    virtual bool Differs(Ptr<OpenGymDataContainer> earlier,
+                         const std::vector<double>& thresholds) const;
+
     virtual void Print(std::ostream& where) const = 0;
 
     friend std::ostream& operator<<(std::ostream& os, const Ptr<OpenGymDataContainer> container)
@@ -66,6 +111,13 @@ class OpenGymDiscreteContainer : public OpenGymDataContainer
     static TypeId GetTypeId();
 
     ns3_ai_gym::DataContainer GetDataContainerPbMsg() override;
+    bool WriteFlat(uint8_t* buffer,
+                   const OpenGymFlatLeaf*& leaf,
+                   const OpenGymFlatLeaf* end) const override;
+    bool ReadFlat(const uint8_t* buffer,
+                  const OpenGymFlatLeaf*& leaf,
+                  const OpenGymFlatLeaf* end) override;
+    Ptr<OpenGymDataContainer> Pool(Ptr<OpenGymDataContainer> later, bool sum) const override;
 
     void Print(std::ostream& where) const override;
 
@@ -97,7 +149,21 @@ class OpenGymBoxContainer : public OpenGymDataContainer
 
     static TypeId GetTypeId();
 
+    /**
+     * Wire type of the elements, known at compile time (see OpenGymDtypeGet)
+     */
+    static constexpr ns3_ai_gym::Dtype DTYPE = OpenGymDtypeGet<T>();
+
     ns3_ai_gym::DataContainer GetDataContainerPbMsg() override;
+    bool WriteFlat(uint8_t* buffer,
+                   const OpenGymFlatLeaf*& leaf,
+                   const OpenGymFlatLeaf* end) const override;
+    bool ReadFlat(const uint8_t* buffer,
+                  const OpenGymFlatLeaf*& leaf,
+                  const OpenGymFlatLeaf* end) override;
+    Ptr<OpenGymDataContainer> Pool(Ptr<OpenGymDataContainer> later, bool sum) const override;
+    bool Differs(Ptr<OpenGymDataContainer> earlier,
+                 const std::vector<double>& thresholds) const override;
 
     void Print(std::ostream& where) const override;
 
@@ -121,9 +187,10 @@ class OpenGymBoxContainer : public OpenGymDataContainer
     void DoDispose() override;
 
   private:
-    void SetDtype();
+    template <typename W>
+    void WriteFlatAs(uint8_t* buffer) const;
+
     std::vector<uint32_t> m_shape;
-    ns3_ai_gym::Dtype m_dtype;
     std::vector<T> m_data;
 };
 
@@ -142,14 +209,12 @@ OpenGymBoxContainer<T>::GetTypeId()
 template <typename T>
 OpenGymBoxContainer<T>::OpenGymBoxContainer()
 {
-    SetDtype();
 }
 
 template <typename T>
 OpenGymBoxContainer<T>::OpenGymBoxContainer(std::vector<uint32_t> shape)
     : m_shape(shape)
 {
-    SetDtype();
 }
 
 template <typename T>
@@ -157,33 +222,6 @@ OpenGymBoxContainer<T>::~OpenGymBoxContainer()
 {
 }
 
-template <typename T>
-void
-OpenGymBoxContainer<T>::SetDtype()
-{
-    std::string name = TypeNameGet<T>();
-    if (name == "int8_t" || name == "int16_t" || name == "int32_t" || name == "int64_t")
-    {
-        m_dtype = ns3_ai_gym::INT;
-    }
-    else if (name == "uint8_t" || name == "uint16_t" || name == "uint32_t" || name == "uint64_t")
-    {
-        m_dtype = ns3_ai_gym::UINT;
-    }
-    else if (name == "float")
-    {
-        m_dtype = ns3_ai_gym::FLOAT;
-    }
-    else if (name == "double")
-    {
-        m_dtype = ns3_ai_gym::DOUBLE;
-    }
-    else
-    {
-        m_dtype = ns3_ai_gym::FLOAT;
-    }
-}
-
 template <typename T>
 void
 OpenGymBoxContainer<T>::DoDispose()
@@ -206,28 +244,29 @@ OpenGymBoxContainer<T>::GetDataContainerPbMsg()
     std::vector<uint32_t> shape = GetShape();
     *boxContainerPbMsg.mutable_shape() = {shape.begin(), shape.end()};
 
-    boxContainerPbMsg.set_dtype(m_dtype);
-    std::vector<T> data = GetData();
+    boxContainerPbMsg.set_dtype(DTYPE);
+    const std::vector<T>& data = m_data;
 
-    if (m_dtype == ns3_ai_gym::INT)
+    if constexpr (DTYPE == ns3_ai_gym::INT)
     {
         *boxContainerPbMsg.mutable_intdata() = {data.begin(), data.end()};
     }
-    else if (m_dtype == ns3_ai_gym::UINT)
+    else if constexpr (DTYPE == ns3_ai_gym::UINT)
     {
         *boxContainerPbMsg.mutable_uintdata() = {data.begin(), data.end()};
     }
-    else if (m_dtype == ns3_ai_gym::FLOAT)
+    else if constexpr (DTYPE == ns3_ai_gym::FLOAT)
     {
         *boxContainerPbMsg.mutable_floatdata() = {data.begin(), data.end()};
     }
-    else if (m_dtype == ns3_ai_gym::DOUBLE)
+    else if constexpr (DTYPE == ns3_ai_gym::DOUBLE)
     {
         *boxContainerPbMsg.mutable_doubledata() = {data.begin(), data.end()};
     }
     else
     {
-        *boxContainerPbMsg.mutable_floatdata() = {data.begin(), data.end()};
+        // the elements as they are, no widening
+        boxContainerPbMsg.set_rawdata(data.data(), data.size() * sizeof(T));
     }
 
     dataContainerPbMsg.set_type(ns3_ai_gym::Box);
@@ -235,6 +274,128 @@ OpenGymBoxContainer<T>::GetDataContainerPbMsg()
     return dataContainerPbMsg;
 }
 
+template <typename T>
+bool
+OpenGymBoxContainer<T>::WriteFlat(uint8_t* buffer,
+                                  const OpenGymFlatLeaf*& leaf,
+                                  const OpenGymFlatLeaf* end) const
+{
+    if (leaf == end || leaf->type != ns3_ai_gym::Box || leaf->count != m_data.size())
+    {
+        return false;
+    }
+    buffer += leaf->offset;
+    ns3_ai_gym::Dtype dtype = (leaf++)->dtype;
+    // converted to the dtype of the space, copied as is if it is that of T
+    OpenGymDtypeVisit(dtype, [&](auto* type) {
+        WriteFlatAs<std::remove_pointer_t<decltype(type)>>(buffer);
+    });
+    return true;
+}
+
+template <typename T>
+Ptr<OpenGymDataContainer>
+OpenGymBoxContainer<T>::Pool(Ptr<OpenGymDataContainer> later, bool sum) const
+{
+    Ptr<OpenGymBoxContainer<T>> box = DynamicCast<OpenGymBoxContainer<T>>(later);
+    if (!box || box->m_data.size() != m_data.size())
+    {
+        return nullptr;
+    }
+    std::vector<T> data(m_data);
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        data[i] = sum ? data[i] + box->m_data[i] : std::max(data[i], box->m_data[i]);
+    }
+    Ptr<OpenGymBoxContainer<T>> pooled = CreateObject<OpenGymBoxContainer<T>>(box->m_shape);
+    pooled->SetData(std::move(data));
+    return pooled;
+}
+
+template <typename T>
+bool
+OpenGymBoxContainer<T>::Differs(Ptr<OpenGymDataContainer> earlier,
+                                const std::vector<double>& thresholds) const
+{
+    Ptr<OpenGymBoxContainer<T>> box = DynamicCast<OpenGymBoxContainer<T>>(earlier);
+    if (!box || box->m_data.size() != m_data.size())
+    {
+        return true;
+    }
+    NS_ABORT_MSG_IF(thresholds.size() != 1 && thresholds.size() != m_data.size(),
+                    "Expected 1 or " << m_data.size() << " thresholds, got "
+                                     << thresholds.size());
+    bool perElement = thresholds.size() > 1;
+    for (size_t i = 0; i < m_data.size(); ++i)
+    {
+        // in double, so that unsigned differences do not wrap
+        double delta = std::abs(double(m_data[i]) - double(box->m_data[i]));
+        if (delta > thresholds[perElement ? i : 0])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename T>
+bool
+OpenGymBoxContainer<T>::ReadFlat(const uint8_t* buffer,
+                                 const OpenGymFlatLeaf*& leaf,
+                                 const OpenGymFlatLeaf* end)
+{
+    // actions are written in the dtype of the space, which created this
+    // container with the same element type (float for half precision)
+    if (leaf == end || leaf->type != ns3_ai_gym::Box || leaf->count != m_data.size())
+    {
+        return false;
+    }
+    buffer += leaf->offset;
+    if (leaf->dtype == DTYPE)
+    {
+        if (!m_data.empty())
+        {
+            std::memcpy(m_data.data(), buffer, m_data.size() * sizeof(T));
+        }
+    }
+    else if (leaf->dtype == ns3_ai_gym::FLOAT16 && std::is_same<T, float>::value)
+    {
+        for (T& value : m_data)
+        {
+            OpenGymFloat16 half;
+            std::memcpy(&half, buffer, sizeof(half));
+            value = static_cast<T>(static_cast<float>(half));
+            buffer += sizeof(half);
+        }
+    }
+    else
+    {
+        return false;
+    }
+    ++leaf;
+    return true;
+}
+
+template <typename T>
+template <typename W>
+void
+OpenGymBoxContainer<T>::WriteFlatAs(uint8_t* buffer) const
+{
+    if constexpr (std::is_same<T, W>::value)
+    {
+        std::memcpy(buffer, m_data.data(), m_data.size() * sizeof(W));
+    }
+    else
+    {
+        for (const T& value : m_data)
+        {
+            W converted = static_cast<W>(value);
+            std::memcpy(buffer, &converted, sizeof(W));
+            buffer += sizeof(W);
+        }
+    }
+}
+
 template <typename T>
 bool
 OpenGymBoxContainer<T>::AddValue(T value)
@@ -304,6 +465,13 @@ class OpenGymTupleContainer : public OpenGymDataContainer
     static TypeId GetTypeId();
 
     ns3_ai_gym::DataContainer GetDataContainerPbMsg() override;
+    bool WriteFlat(uint8_t* buffer,
+                   const OpenGymFlatLeaf*& leaf,
+                   const OpenGymFlatLeaf* end) const override;
+    bool ReadFlat(const uint8_t* buffer,
+                  const OpenGymFlatLeaf*& leaf,
+                  const OpenGymFlatLeaf* end) override;
+    Ptr<OpenGymDataContainer> Pool(Ptr<OpenGymDataContainer> later, bool sum) const override;
 
     void Print(std::ostream& where) const override;
 
@@ -333,6 +501,13 @@ class OpenGymDictContainer : public OpenGymDataContainer
     static TypeId GetTypeId();
 
     ns3_ai_gym::DataContainer GetDataContainerPbMsg() override;
+    bool WriteFlat(uint8_t* buffer,
+                   const OpenGymFlatLeaf*& leaf,
+                   const OpenGymFlatLeaf* end) const override;
+    bool ReadFlat(const uint8_t* buffer,
+                  const OpenGymFlatLeaf*& leaf,
+                  const OpenGymFlatLeaf* end) override;
+    Ptr<OpenGymDataContainer> Pool(Ptr<OpenGymDataContainer> later, bool sum) const override;
 
     void Print(std::ostream& where) const override;
 
@@ -21,10 +21,12 @@
 
 #include "ns3-ai-gym-env.h"
 
+#include "container.h"
 #include "ns3-ai-gym-interface.h"
 
 #include <ns3/log.h>
 #include <ns3/object.h>
+#include <ns3/simulator.h>
 
 namespace ns3
 {
@@ -57,8 +59,9 @@ OpenGymEnv::SetOpenGymInterface(Ptr<OpenGymInterface> openGymInterface)
     openGymInterface->SetGetActionSpaceCb(MakeCallback(&OpenGymEnv::GetActionSpace, this));
     openGymInterface->SetGetObservationSpaceCb(
         MakeCallback(&OpenGymEnv::GetObservationSpace, this));
-    openGymInterface->SetGetGameOverCb(MakeCallback(&OpenGymEnv::GetGameOver, this));
-    openGymInterface->SetGetObservationCb(MakeCallback(&OpenGymEnv::GetObservation, this));
+    openGymInterface->SetGetGameOverCb(MakeCallback(&OpenGymEnv::GetNotifiedGameOver, this));
+    openGymInterface->SetGetObservationCb(
+        MakeCallback(&OpenGymEnv::GetNotifiedObservation, this));
     openGymInterface->SetGetRewardCb(MakeCallback(&OpenGymEnv::GetReward, this));
     openGymInterface->SetGetExtraInfoCb(MakeCallback(&OpenGymEnv::GetExtraInfo, this));
     openGymInterface->SetExecuteActionsCb(MakeCallback(&OpenGymEnv::ExecuteActions, this));
@@ -68,10 +71,62 @@ void
 OpenGymEnv::Notify()
 {
     NS_LOG_FUNCTION(this);
-    if (m_openGymInterface)
+    if (!m_openGymInterface)
+    {
+        return;
+    }
+    if (!m_notifyThresholds.empty())
     {
-        m_openGymInterface->Notify(this);
+        Ptr<OpenGymDataContainer> obs = GetObservation();
+        bool gameOver = GetGameOver();
+        if (!ShouldNotify(obs, gameOver))
+        {
+            NS_LOG_DEBUG("Observation has not changed, notification suppressed");
+            return;
+        }
+        m_lastObs = obs;
+        m_lastNotifyTime = Simulator::Now();
+        m_notifiedObs = obs;
+        m_notifiedGameOver = gameOver;
+        m_hasNotifiedGameOver = true;
     }
+    m_openGymInterface->Notify(this);
+    m_notifiedObs = nullptr;
+    m_hasNotifiedGameOver = false;
+}
+
+bool
+OpenGymEnv::ShouldNotify(Ptr<OpenGymDataContainer> obs, bool gameOver)
+{
+    if (!m_lastObs || !obs || gameOver)
+    {
+        return true;
+    }
+    if (!m_maxStaleness.IsZero() && Simulator::Now() - m_lastNotifyTime >= m_maxStaleness)
+    {
+        return true;
+    }
+    return obs->Differs(m_lastObs, m_notifyThresholds);
+}
+
+void
+OpenGymEnv::SetNotifyThresholds(std::vector<double> thresholds, Time maxStaleness)
+{
+    NS_LOG_FUNCTION(this);
+    m_notifyThresholds = thresholds;
+    m_maxStaleness = maxStaleness;
+}
+
+Ptr<OpenGymDataContainer>
+OpenGymEnv::GetNotifiedObservation()
+{
+    return m_notifiedObs ? m_notifiedObs : GetObservation();
+}
+
+bool
+OpenGymEnv::GetNotifiedGameOver()
+{
+    return m_hasNotifiedGameOver ? m_notifiedGameOver : GetGameOver();
 }
 
 void
@@ -94,6 +149,7 @@ void
 OpenGymEnv::DoDispose()
 {
     NS_LOG_FUNCTION(this);
+    m_lastObs = nullptr;
 }
 
 } // namespace ns3
@@ -22,8 +22,11 @@
 #ifndef OPENGYM_ENV_H
 #define OPENGYM_ENV_H
 
+#include <ns3/nstime.h>
 #include <ns3/object.h>
 
+#include <vector>
+
 namespace ns3
 {
 
@@ -94,6 +97,33 @@ class OpenGymEnv : public Object
      */
     void NotifySimulationEnd();
 
+    /**
+     * Notifies only on change: Notify() crosses to Python only when an
+     * element of the Box observation has moved by more than its threshold
+     * since the last observation sent, when maxStaleness (simulated time)
+     * has passed since then (0 never forces it), or at game over. Give one
+     * threshold per element, or one for all of them. Other kinds of
+     * observations always cross. A suppressed notification only calls
+     * GetObservation and GetGameOver, so no reward is collected and no
+     * action is executed. An empty vector notifies at each call (default).
+     * GetObservation must return a new container at each call, since the
+     * last one sent is kept for the comparison.
+     */
+    void SetNotifyThresholds(std::vector<double> thresholds, Time maxStaleness = Seconds(0));
+
+    /**
+     * Gets the observation for the current notification: the one compared
+     * with the thresholds if any, to avoid calling GetObservation twice.
+     * This is the callback given to OpenGymInterface.
+     */
+    Ptr<OpenGymDataContainer> GetNotifiedObservation();
+
+    /**
+     * Gets the game over state for the current notification, like
+     * GetNotifiedObservation. This is the callback given to OpenGymInterface.
+     */
+    bool GetNotifiedGameOver();
+
   protected:
     // Inherited
     void DoInitialize() override;
@@ -102,6 +132,18 @@ class OpenGymEnv : public Object
     Ptr<OpenGymInterface> m_openGymInterface;
 
   private:
+    /**
+     * Whether the observation has changed enough to notify, see SetNotifyThresholds
+     */
+    bool ShouldNotify(Ptr<OpenGymDataContainer> obs, bool gameOver);
+
+    std::vector<double> m_notifyThresholds;  //!< change needed to notify, per element
+    Time m_maxStaleness;                     //!< longest time without notifying
+    Time m_lastNotifyTime;                   //!< time of the last notification sent
+    Ptr<OpenGymDataContainer> m_lastObs;     //!< observation of the last notification sent
+    Ptr<OpenGymDataContainer> m_notifiedObs; //!< observation of the current notification
+    bool m_notifiedGameOver{false};          //!< game over of the current notification
+    bool m_hasNotifiedGameOver{false};       //!< whether m_notifiedGameOver is set
 };
 
 } // end of namespace ns3
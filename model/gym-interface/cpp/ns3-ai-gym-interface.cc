@@ -31,16 +31,193 @@
 #include "ns3-ai-gym-env.h"
 #include "spaces.h"
 
+#include <ns3/abort.h>
 #include <ns3/config.h>
 #include <ns3/log.h>
 #include <ns3/simulator.h>
 
+#include <cstring>
+#include <iostream>
+
 namespace ns3
 {
 
 NS_LOG_COMPONENT_DEFINE("OpenGymInterface");
 NS_OBJECT_ENSURE_REGISTERED(OpenGymInterface);
 
+namespace
+{
+
+typedef Ns3AiMsgInterfaceImpl<Ns3AiGymMsg, Ns3AiGymMsg> GymMsgInterface;
+
+/**
+ * Bytes of a message besides its data container (reward, flags and tags).
+ * The extra info string is not counted, the vector grows to fit it.
+ */
+constexpr uint32_t MSG_OVERHEAD = 64;
+
+/**
+ * Serializes the message in place into the C++ to Python vector, which is
+ * resized (and grows if needed). Call it between CppSendBegin and CppSendEnd.
+ */
+void
+WriteGymMsg(GymMsgInterface* msgInterface, const google::protobuf::MessageLite& msg)
+{
+    uint32_t size = msg.ByteSizeLong();
+    msgInterface->ResizeCpp2PyVector(size);
+    if (size > 0)
+    {
+        msg.SerializeWithCachedSizesToArray(&msgInterface->GetCpp2PyVector()->front().byte);
+    }
+}
+
+/**
+ * Parses the message from the Python to C++ vector. Call it between
+ * CppRecvBegin and CppRecvEnd.
+ */
+void
+ReadGymMsg(GymMsgInterface* msgInterface, google::protobuf::MessageLite& msg)
+{
+    GymMsgInterface::Py2CppMsgVector* vec = msgInterface->GetPy2CppVector();
+    const uint8_t* data = vec->empty() ? nullptr : &vec->front().byte;
+    msg.ParseFromArray(data, static_cast<int>(vec->size()));
+}
+
+void
+RecvGymMsg(GymMsgInterface* msgInterface, google::protobuf::MessageLite& msg)
+{
+    msgInterface->CppRecvBegin();
+    ReadGymMsg(msgInterface, msg);
+    msgInterface->CppRecvEnd();
+}
+
+/**
+ * Rounds up to a multiple of 8 bytes, where the records of a batch start
+ */
+constexpr uint32_t
+AlignRecord(uint32_t offset)
+{
+    return (offset + 7) / 8 * 8;
+}
+
+/**
+ * Writes a state in the flat binary format (see Ns3AiGymStateHeader) at
+ * offset in the C++ to Python vector, which grows if needed. The
+ * observation falls back to protobuf if it does not match the layout of
+ * the space. Returns the end of the state.
+ */
+uint32_t
+WriteFlatState(GymMsgInterface* msgInterface,
+               uint32_t offset,
+               Ptr<OpenGymDataContainer> obs,
+               const std::vector<OpenGymFlatLeaf>& layout,
+               float reward,
+               bool isGameOver,
+               ns3_ai_gym::EnvStateMsg::Reason reason,
+               const std::string& info)
+{
+    Ns3AiGymStateHeader header{};
+    header.reward = reward;
+    header.isGameOver = isGameOver;
+    header.reason = reason;
+    header.obsFormat = NS3AI_GYM_FLAT;
+    header.obsBytes = obs ? OpenGymSpace::GetFlatSize(layout) : 0;
+    header.infoBytes = info.size();
+
+    uint32_t end = offset + sizeof(header) + header.obsBytes + header.infoBytes;
+    if (msgInterface->GetCpp2PyVector()->size() < end)
+    {
+        msgInterface->ResizeCpp2PyVector(end);
+    }
+    uint8_t* buffer = &msgInterface->GetCpp2PyVector()->front().byte + offset;
+    if (obs)
+    {
+        const OpenGymFlatLeaf* leaf = layout.data();
+        const OpenGymFlatLeaf* last = leaf + layout.size();
+        if (!obs->WriteFlat(buffer + sizeof(header), leaf, last) || leaf != last)
+        {
+            NS_LOG_DEBUG("Observation does not match its space, sent with protobuf");
+            ns3_ai_gym::DataContainer obsPbMsg = obs->GetDataContainerPbMsg();
+            header.obsFormat = NS3AI_GYM_PROTOBUF;
+            header.obsBytes = obsPbMsg.ByteSizeLong();
+            end = offset + sizeof(header) + header.obsBytes + header.infoBytes;
+            if (msgInterface->GetCpp2PyVector()->size() < end)
+            {
+                msgInterface->ResizeCpp2PyVector(end);
+            }
+            buffer = &msgInterface->GetCpp2PyVector()->front().byte + offset;
+            obsPbMsg.SerializeWithCachedSizesToArray(buffer + sizeof(header));
+        }
+    }
+    std::memcpy(buffer, &header, sizeof(header));
+    std::memcpy(buffer + sizeof(header) + header.obsBytes, info.data(), header.infoBytes);
+    return end;
+}
+
+/**
+ * Reads an action in the flat binary format (see Ns3AiGymActionHeader),
+ * of size bytes, into action. The previous action is refilled in place if
+ * nothing else references it (e.g., kept by ExecuteActions), so that steps
+ * do not allocate.
+ */
+void
+ReadFlatAction(const uint8_t* buffer,
+               uint32_t size,
+               Ptr<OpenGymSpace> actionSpace,
+               const std::vector<OpenGymFlatLeaf>& layout,
+               Ptr<OpenGymDataContainer>& action,
+               bool& stopSim)
+{
+    Ns3AiGymActionHeader header;
+    NS_ABORT_MSG_IF(size < sizeof(header), "Invalid flat action message");
+    std::memcpy(&header, buffer, sizeof(header));
+    NS_ABORT_MSG_IF(size < sizeof(header) + header.actBytes, "Invalid flat action message");
+    buffer += sizeof(header);
+    stopSim = header.stopSimReq;
+    if (!stopSim && header.actFormat == NS3AI_GYM_PROTOBUF)
+    {
+        ns3_ai_gym::DataContainer actPbMsg;
+        actPbMsg.ParseFromArray(buffer, static_cast<int>(header.actBytes));
+        action = OpenGymDataContainer::CreateFromDataContainerPbMsg(actPbMsg);
+    }
+    else if (!stopSim && actionSpace && header.actBytes > 0)
+    {
+        NS_ABORT_MSG_IF(header.actBytes < OpenGymSpace::GetFlatSize(layout),
+                        "Invalid flat action message");
+        const OpenGymFlatLeaf* leaf = layout.data();
+        const OpenGymFlatLeaf* end = leaf + layout.size();
+        if (!action || action->GetReferenceCount() > 1 || !action->ReadFlat(buffer, leaf, end) ||
+            leaf != end)
+        {
+            leaf = layout.data();
+            action = actionSpace->CreateFromFlat(buffer, leaf);
+        }
+    }
+    else
+    {
+        action = nullptr;
+    }
+}
+
+/**
+ * Reads an action in the flat binary format from the Python to C++ vector,
+ * into action (see ReadFlatAction). Call it between CppRecvBegin and
+ * CppRecvEnd.
+ */
+void
+ReadFlatAction(GymMsgInterface* msgInterface,
+               Ptr<OpenGymSpace> actionSpace,
+               const std::vector<OpenGymFlatLeaf>& layout,
+               Ptr<OpenGymDataContainer>& action,
+               bool& stopSim)
+{
+    GymMsgInterface::Py2CppMsgVector* vec = msgInterface->GetPy2CppVector();
+    const uint8_t* buffer = vec->empty() ? nullptr : &vec->front().byte;
+    ReadFlatAction(buffer, vec->size(), actionSpace, layout, action, stopSim);
+}
+
+} // namespace
+
 Ptr<OpenGymInterface>
 OpenGymInterface::Get()
 {
@@ -51,11 +228,20 @@ OpenGymInterface::Get()
 OpenGymInterface::OpenGymInterface()
     : m_simEnd(false),
       m_stopEnvRequested(false),
-      m_initSimMsgSent(false)
+      m_initSimMsgSent(false),
+      m_flatSteps(false),
+      m_actionRepeat(1),
+      m_decisionInterval(Seconds(0)),
+      m_pooling(POOL_LAST),
+      m_decided(false),
+      m_skipped(0),
+      m_skippedReward(0),
+      m_batchWindow(Seconds(0)),
+      m_profiling(false)
 {
     auto interface = Ns3AiMsgInterface::Get();
     interface->SetIsMemoryCreator(false);
-    interface->SetUseVector(false);
+    interface->SetUseVector(true);
     interface->SetHandleFinish(false);
 }
 
@@ -99,28 +285,42 @@ OpenGymInterface::Init()
         spaceDesc = actionSpace->GetSpaceDescription();
         simInitMsg.mutable_actspace()->CopyFrom(spaceDesc);
     }
+    // steps can skip protobuf if Python agrees
+    simInitMsg.set_flatsteps(true);
+    simInitMsg.set_multiagent(!m_agents.empty());
 
     // get the interface
-    Ns3AiMsgInterfaceImpl<Ns3AiGymMsg, Ns3AiGymMsg>* msgInterface =
+    GymMsgInterface* msgInterface =
         Ns3AiMsgInterface::Get()->GetInterface<Ns3AiGymMsg, Ns3AiGymMsg>();
 
-    // send init msg to python
+    // send init msg to python, after sizing both vectors for the largest
+    // messages the spaces allow, so that they do not grow at each step.
+    // Python waits for this message, so it does not use them meanwhile.
+    uint32_t actSize = actionSpace ? actionSpace->GetMaxDataSize() : 0;
+    uint32_t obsSize = obsSpace ? obsSpace->GetMaxDataSize() : 0;
     msgInterface->CppSendBegin();
-    msgInterface->GetCpp2PyStruct()->size = simInitMsg.ByteSizeLong();
-    assert(msgInterface->GetCpp2PyStruct()->size <= MSG_BUFFER_SIZE);
-    simInitMsg.SerializeToArray(msgInterface->GetCpp2PyStruct()->buffer,
-                                msgInterface->GetCpp2PyStruct()->size);
+    msgInterface->ResizePy2CppVector(MSG_OVERHEAD + actSize);
+    msgInterface->ResizeCpp2PyVector(MSG_OVERHEAD + obsSize);
+    WriteGymMsg(msgInterface, simInitMsg);
     msgInterface->CppSendEnd();
 
     // receive init ack msg from python
     ns3_ai_gym::SimInitAck simInitAck;
-    msgInterface->CppRecvBegin();
-    simInitAck.ParseFromArray(msgInterface->GetPy2CppStruct()->buffer,
-                              msgInterface->GetPy2CppStruct()->size);
-    msgInterface->CppRecvEnd();
+    RecvGymMsg(msgInterface, simInitAck);
 
     bool done = simInitAck.done();
     NS_LOG_DEBUG("Sim Init Ack: " << done);
+    m_flatSteps = simInitMsg.flatsteps() && simInitAck.flatsteps();
+    m_actionSpace = actionSpace;
+    if (m_flatSteps)
+    {
+        // the same layouts as Python compiles from the space descriptions
+        m_obsLayout = obsSpace ? obsSpace->GetFlatLayout() : std::vector<OpenGymFlatLeaf>();
+        m_actLayout = actionSpace ? actionSpace->GetFlatLayout() : std::vector<OpenGymFlatLeaf>();
+    }
+    NS_LOG_DEBUG("Flat binary steps: " << m_flatSteps);
+    NS_ABORT_MSG_IF(!m_agents.empty() && !(m_flatSteps && simInitAck.multiagent()),
+                    "Agents are registered, the Python side must use Ns3MultiAgentEnv");
     bool stopSim = simInitAck.stopsimreq();
     if (stopSim)
     {
@@ -143,66 +343,114 @@ OpenGymInterface::NotifyCurrentState()
     {
         return;
     }
-    // collect current env state
-    Ptr<OpenGymDataContainer> obsDataContainer = GetObservation();
-    float reward = GetReward();
+    StartStep();
+    // collect current env state, with the rewards of the notifications
+    // skipped by action repeat since the last decision
+    float reward = GetReward() + m_skippedReward;
     bool isGameOver = IsGameOver();
-    std::string extraInfo = GetExtraInfo();
-    ns3_ai_gym::EnvStateMsg envStateMsg;
-    // observation
-    ns3_ai_gym::DataContainer obsDataContainerPbMsg;
-    if (obsDataContainer)
-    {
-        obsDataContainerPbMsg = obsDataContainer->GetDataContainerPbMsg();
-        envStateMsg.mutable_obsdata()->CopyFrom(obsDataContainerPbMsg);
-    }
-    // reward
-    envStateMsg.set_reward(reward);
-    // game over
-    envStateMsg.set_isgameover(false);
-    if (isGameOver)
-    {
-        envStateMsg.set_isgameover(true);
-        if (m_simEnd)
-        {
-            envStateMsg.set_reason(ns3_ai_gym::EnvStateMsg::SimulationEnd);
-        }
-        else
+    ++m_skipped;
+    if (m_decided && !isGameOver &&
+        (m_skipped < m_actionRepeat || Simulator::Now() - m_lastDecision < m_decisionInterval))
+    {
+        m_skippedReward = reward;
+        if (m_pooling != POOL_LAST)
         {
-            envStateMsg.set_reason(ns3_ai_gym::EnvStateMsg::GameOver);
+            m_skippedObs = PoolObservation(GetObservation());
         }
+        EndPhase(OpenGymStepProfile::COLLECT);
+        ExecuteActions(m_lastAction);
+        EndPhase(OpenGymStepProfile::EXECUTE);
+        EndStep();
+        return;
+    }
+    Ptr<OpenGymDataContainer> obsDataContainer = PoolObservation(GetObservation());
+    m_skipped = 0;
+    m_skippedReward = 0;
+    m_skippedObs = nullptr;
+    std::string extraInfo = GetExtraInfo();
+    ns3_ai_gym::EnvStateMsg::Reason reason = ns3_ai_gym::EnvStateMsg::SimulationEnd;
+    if (isGameOver && !m_simEnd)
+    {
+        reason = ns3_ai_gym::EnvStateMsg::GameOver;
     }
-    // extra info
-    envStateMsg.set_info(extraInfo);
+    EndPhase(OpenGymStepProfile::COLLECT);
 
     // get the interface
-    Ns3AiMsgInterfaceImpl<Ns3AiGymMsg, Ns3AiGymMsg>* msgInterface =
+    GymMsgInterface* msgInterface =
         Ns3AiMsgInterface::Get()->GetInterface<Ns3AiGymMsg, Ns3AiGymMsg>();
 
-    // send env state msg to python
-    msgInterface->CppSendBegin();
-    msgInterface->GetCpp2PyStruct()->size = envStateMsg.ByteSizeLong();
-    assert(msgInterface->GetCpp2PyStruct()->size <= MSG_BUFFER_SIZE);
-    envStateMsg.SerializeToArray(msgInterface->GetCpp2PyStruct()->buffer,
-                                 msgInterface->GetCpp2PyStruct()->size);
-
-    msgInterface->CppSendEnd();
-
-    // receive act msg from python
-    ns3_ai_gym::EnvActMsg envActMsg;
-    msgInterface->CppRecvBegin();
-
-    envActMsg.ParseFromArray(msgInterface->GetPy2CppStruct()->buffer,
-                             msgInterface->GetPy2CppStruct()->size);
-    msgInterface->CppRecvEnd();
+    bool stopSim = false;
+    Ptr<OpenGymDataContainer> actDataContainer;
+    if (m_flatSteps)
+    {
+        // send env state to python and receive act, without protobuf
+        msgInterface->CppSendBegin();
+        EndPhase(OpenGymStepProfile::SEND_WAIT);
+        uint32_t end = WriteFlatState(msgInterface,
+                                      0,
+                                      obsDataContainer,
+                                      m_obsLayout,
+                                      reward,
+                                      isGameOver,
+                                      reason,
+                                      extraInfo);
+        msgInterface->ResizeCpp2PyVector(end);
+        EndPhase(OpenGymStepProfile::SERIALIZE);
+        msgInterface->CppSendEnd();
+
+        msgInterface->CppRecvBegin();
+        EndPhase(OpenGymStepProfile::PYTHON);
+        ReadFlatAction(msgInterface, m_actionSpace, m_actLayout, m_lastAction, stopSim);
+        msgInterface->CppRecvEnd();
+        EndPhase(OpenGymStepProfile::PARSE);
+        actDataContainer = m_lastAction;
+    }
+    else
+    {
+        // the messages are reused, Clear keeps their memory
+        ns3_ai_gym::EnvStateMsg& envStateMsg = m_envStateMsg;
+        envStateMsg.Clear();
+        // observation
+        if (obsDataContainer)
+        {
+            *envStateMsg.mutable_obsdata() = obsDataContainer->GetDataContainerPbMsg();
+        }
+        // reward
+        envStateMsg.set_reward(reward);
+        // game over
+        envStateMsg.set_isgameover(isGameOver);
+        envStateMsg.set_reason(reason);
+        // extra info
+        envStateMsg.set_info(extraInfo);
+
+        EndPhase(OpenGymStepProfile::SERIALIZE);
+
+        // send env state msg to python
+        msgInterface->CppSendBegin();
+        EndPhase(OpenGymStepProfile::SEND_WAIT);
+        WriteGymMsg(msgInterface, envStateMsg);
+        EndPhase(OpenGymStepProfile::SERIALIZE);
+        msgInterface->CppSendEnd();
+
+        // receive act msg from python
+        ns3_ai_gym::EnvActMsg& envActMsg = m_envActMsg;
+        msgInterface->CppRecvBegin();
+        EndPhase(OpenGymStepProfile::PYTHON);
+        ReadGymMsg(msgInterface, envActMsg);
+        msgInterface->CppRecvEnd();
+        stopSim = envActMsg.stopsimreq();
+        actDataContainer =
+            OpenGymDataContainer::CreateFromDataContainerPbMsg(*envActMsg.mutable_actdata());
+        EndPhase(OpenGymStepProfile::PARSE);
+    }
 
     if (m_simEnd)
     {
         // if sim end only rx msg and quit
+        EndStep();
         return;
     }
 
-    bool stopSim = envActMsg.stopsimreq();
     if (stopSim)
     {
         NS_LOG_DEBUG("---Stop requested: " << stopSim);
@@ -212,11 +460,14 @@ OpenGymInterface::NotifyCurrentState()
         std::exit(0);
     }
 
+    m_decided = true;
+    m_lastDecision = Simulator::Now();
+    m_lastAction = actDataContainer;
+
     // first step after reset is called without actions, just to get current state
-    ns3_ai_gym::DataContainer actDataContainerPbMsg = envActMsg.actdata();
-    Ptr<OpenGymDataContainer> actDataContainer =
-        OpenGymDataContainer::CreateFromDataContainerPbMsg(actDataContainerPbMsg);
     ExecuteActions(actDataContainer);
+    EndPhase(OpenGymStepProfile::EXECUTE);
+    EndStep();
 }
 
 void
@@ -231,11 +482,227 @@ void
 OpenGymInterface::NotifySimulationEnd()
 {
     NS_LOG_FUNCTION(this);
+    if (m_simEnd)
+    {
+        // e.g., another agent already notified it
+        return;
+    }
     m_simEnd = true;
-    if (m_initSimMsgSent)
+    if (m_initSimMsgSent && !m_agents.empty())
+    {
+        // the final states of all the agents, in one batch
+        m_batchEvent.Cancel();
+        for (const auto& agent : m_agents)
+        {
+            CollectAgentState(agent.first, agent.second);
+        }
+        SendBatch();
+    }
+    else if (m_initSimMsgSent)
     {
         WaitForStop();
     }
+    if (m_profiling)
+    {
+        std::cout << "ns3-ai gym step profile:\n";
+        m_profile.Print(std::cout);
+    }
+}
+
+void
+OpenGymInterface::RegisterAgent(uint32_t agentId, Ptr<OpenGymEnv> agent)
+{
+    NS_LOG_FUNCTION(this << agentId);
+    NS_ABORT_MSG_IF(m_initSimMsgSent, "Agents must be registered before the first notification");
+    NS_ABORT_MSG_IF(m_agents.count(agentId), "Agent " << agentId << " is already registered");
+    // the spaces declared at Init are those of the last agent registered
+    agent->SetOpenGymInterface(this);
+    m_agents[agentId] = agent;
+    m_agentIds[PeekPointer(agent)] = agentId;
+}
+
+void
+OpenGymInterface::SetBatchWindow(Time window)
+{
+    m_batchWindow = window;
+}
+
+void
+OpenGymInterface::SetProfiling(bool profiling)
+{
+    m_profiling = profiling;
+}
+
+const OpenGymStepProfile&
+OpenGymInterface::GetProfile() const
+{
+    return m_profile;
+}
+
+void
+OpenGymInterface::NotifyAgent(Ptr<OpenGymEnv> agent)
+{
+    if (!m_initSimMsgSent)
+    {
+        Init();
+    }
+    if (m_stopEnvRequested)
+    {
+        return;
+    }
+    auto id = m_agentIds.find(PeekPointer(agent));
+    NS_ABORT_MSG_IF(id == m_agentIds.end(), "Only registered agents can notify");
+    CollectAgentState(id->second, agent);
+    if (m_batchEvent.IsExpired())
+    {
+        m_batchEvent = Simulator::Schedule(m_batchWindow, &OpenGymInterface::SendBatch, this);
+    }
+}
+
+void
+OpenGymInterface::CollectAgentState(uint32_t agentId, Ptr<OpenGymEnv> agent)
+{
+    // an agent notifying again within the window replaces its state,
+    // but its rewards add up
+    AgentState& state = m_batch[agentId];
+    state.pending = true;
+    state.obs = agent->GetNotifiedObservation();
+    state.reward += agent->GetReward();
+    state.isGameOver = agent->GetNotifiedGameOver() || m_simEnd;
+    state.info = agent->GetExtraInfo();
+}
+
+void
+OpenGymInterface::SendBatch()
+{
+    NS_LOG_FUNCTION(this);
+    // the states stay in m_batch (only marked as sent), so that batches do
+    // not allocate once every agent has notified
+    m_batchIds.clear();
+    for (const auto& item : m_batch)
+    {
+        if (item.second.pending)
+        {
+            m_batchIds.push_back(item.first);
+        }
+    }
+    if (m_stopEnvRequested || m_batchIds.empty())
+    {
+        return;
+    }
+
+    GymMsgInterface* msgInterface =
+        Ns3AiMsgInterface::Get()->GetInterface<Ns3AiGymMsg, Ns3AiGymMsg>();
+
+    // send the states, sized once for the usual case (no protobuf fallback)
+    Ns3AiGymBatchHeader header{};
+    header.numAgents = m_batchIds.size();
+    uint32_t end = sizeof(header);
+    for (uint32_t agentId : m_batchIds)
+    {
+        end = AlignRecord(end) + sizeof(Ns3AiGymAgentHeader) + sizeof(Ns3AiGymStateHeader) +
+              OpenGymSpace::GetFlatSize(m_obsLayout) + m_batch[agentId].info.size();
+    }
+    StartStep();
+    msgInterface->CppSendBegin();
+    EndPhase(OpenGymStepProfile::SEND_WAIT);
+    msgInterface->ResizeCpp2PyVector(end);
+    std::memcpy(&msgInterface->GetCpp2PyVector()->front().byte, &header, sizeof(header));
+    end = sizeof(header);
+    for (uint32_t agentId : m_batchIds)
+    {
+        AgentState& state = m_batch[agentId];
+        uint32_t offset = AlignRecord(end);
+        ns3_ai_gym::EnvStateMsg::Reason reason = state.isGameOver && !m_simEnd
+                                                     ? ns3_ai_gym::EnvStateMsg::GameOver
+                                                     : ns3_ai_gym::EnvStateMsg::SimulationEnd;
+        end = WriteFlatState(msgInterface,
+                             offset + sizeof(Ns3AiGymAgentHeader),
+                             state.obs,
+                             m_obsLayout,
+                             state.reward,
+                             state.isGameOver,
+                             reason,
+                             state.info);
+        Ns3AiGymAgentHeader agentHeader{agentId,
+                                        end - offset - uint32_t(sizeof(Ns3AiGymAgentHeader))};
+        std::memcpy(&msgInterface->GetCpp2PyVector()->front().byte + offset,
+                    &agentHeader,
+                    sizeof(agentHeader));
+        state.pending = false;
+        state.obs = nullptr;
+        state.reward = 0;
+    }
+    msgInterface->ResizeCpp2PyVector(end);
+    EndPhase(OpenGymStepProfile::SERIALIZE);
+    msgInterface->CppSendEnd();
+
+    // receive the actions of the agents, into their previous ones
+    msgInterface->CppRecvBegin();
+    EndPhase(OpenGymStepProfile::PYTHON);
+    GymMsgInterface::Py2CppMsgVector* vec = msgInterface->GetPy2CppVector();
+    NS_ABORT_MSG_IF(vec->size() < sizeof(header), "Invalid batched action message");
+    const uint8_t* buffer = &vec->front().byte;
+    std::memcpy(&header, buffer, sizeof(header));
+    bool stopSim = header.stopSimReq;
+    m_batchIds.clear();
+    uint32_t offset = sizeof(header);
+    for (uint32_t i = 0; !stopSim && i < header.numAgents; ++i)
+    {
+        Ns3AiGymAgentHeader agentHeader;
+        offset = AlignRecord(offset);
+        NS_ABORT_MSG_IF(vec->size() < offset + sizeof(agentHeader),
+                        "Invalid batched action message");
+        std::memcpy(&agentHeader, buffer + offset, sizeof(agentHeader));
+        offset += sizeof(agentHeader);
+        NS_ABORT_MSG_IF(vec->size() < offset + agentHeader.bytes,
+                        "Invalid batched action message");
+        NS_ABORT_MSG_IF(!m_agents.count(agentHeader.agentId),
+                        "Action for unknown agent " << agentHeader.agentId);
+        bool agentStop = false;
+        ReadFlatAction(buffer + offset,
+                       agentHeader.bytes,
+                       m_actionSpace,
+                       m_actLayout,
+                       m_batch[agentHeader.agentId].action,
+                       agentStop);
+        m_batchIds.push_back(agentHeader.agentId);
+        offset += agentHeader.bytes;
+    }
+    msgInterface->CppRecvEnd();
+    EndPhase(OpenGymStepProfile::PARSE);
+
+    if (m_simEnd)
+    {
+        // if sim end only rx msg and quit
+        EndStep();
+        return;
+    }
+
+    if (stopSim)
+    {
+        NS_LOG_DEBUG("---Stop requested: " << stopSim);
+        m_stopEnvRequested = true;
+        Simulator::Stop();
+        Simulator::Destroy();
+        std::exit(0);
+    }
+
+    for (uint32_t agentId : m_batchIds)
+    {
+        m_agents[agentId]->ExecuteActions(m_batch[agentId].action);
+    }
+    EndPhase(OpenGymStepProfile::EXECUTE);
+    EndStep();
+}
+
+uint32_t
+OpenGymInterface::MarkEpisodeStart()
+{
+    NS_LOG_FUNCTION(this);
+    NS_ABORT_MSG_IF(m_initSimMsgSent,
+                    "The episode start must be marked before the first notification");
+    return Ns3AiSnapshot::MarkEpisodeStart();
 }
 
 Ptr<OpenGymSpace>
@@ -322,6 +789,39 @@ OpenGymInterface::ExecuteActions(Ptr<OpenGymDataContainer> action)
     return reply;
 }
 
+Ptr<OpenGymDataContainer>
+OpenGymInterface::PoolObservation(Ptr<OpenGymDataContainer> obs)
+{
+    if (m_skippedObs && obs)
+    {
+        Ptr<OpenGymDataContainer> pooled = m_skippedObs->Pool(obs, m_pooling == POOL_SUM);
+        if (pooled)
+        {
+            return pooled;
+        }
+    }
+    return obs;
+}
+
+void
+OpenGymInterface::SetActionRepeat(uint32_t k)
+{
+    NS_ABORT_MSG_IF(k == 0, "The action repeat must be at least 1");
+    m_actionRepeat = k;
+}
+
+void
+OpenGymInterface::SetDecisionInterval(Time interval)
+{
+    m_decisionInterval = interval;
+}
+
+void
+OpenGymInterface::SetObservationPooling(ObservationPooling pooling)
+{
+    m_pooling = pooling;
+}
+
 void
 OpenGymInterface::SetGetActionSpaceCb(Callback<Ptr<OpenGymSpace>> cb)
 {
@@ -381,8 +881,14 @@ OpenGymInterface::Notify(Ptr<OpenGymEnv> entity)
 {
     NS_LOG_FUNCTION(this);
 
-    SetGetGameOverCb(MakeCallback(&OpenGymEnv::GetGameOver, entity));
-    SetGetObservationCb(MakeCallback(&OpenGymEnv::GetObservation, entity));
+    if (!m_agents.empty())
+    {
+        NotifyAgent(entity);
+        return;
+    }
+
+    SetGetGameOverCb(MakeCallback(&OpenGymEnv::GetNotifiedGameOver, entity));
+    SetGetObservationCb(MakeCallback(&OpenGymEnv::GetNotifiedObservation, entity));
     SetGetRewardCb(MakeCallback(&OpenGymEnv::GetReward, entity));
     SetGetExtraInfoCb(MakeCallback(&OpenGymEnv::GetExtraInfo, entity));
     SetExecuteActionsCb(MakeCallback(&OpenGymEnv::ExecuteActions, entity));
@@ -22,14 +22,24 @@
 #ifndef NS3_NS3_AI_GYM_INTERFACE_H
 #define NS3_NS3_AI_GYM_INTERFACE_H
 
+#include "spaces.h"
+
 #include "ns3/ns3-ai-gym-msg.h"
 
 #include <ns3/ai-module.h>
 #include <ns3/callback.h>
+#include <ns3/event-id.h>
+#include <ns3/nstime.h>
 #include <ns3/object.h>
 #include <ns3/ptr.h>
 #include <ns3/type-id.h>
 
+#include <map>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 namespace ns3
 {
 
@@ -37,6 +47,115 @@ class OpenGymSpace;
 class OpenGymDataContainer;
 class OpenGymEnv;
 
+/**
+ * \brief Time spent in each phase of the Gym steps (see
+ * OpenGymInterface::SetProfiling): the durations of each phase per step,
+ * cumulated and in histograms which do not allocate
+ */
+class OpenGymStepProfile
+{
+  public:
+    enum Phase
+    {
+        COLLECT,   //!< user callbacks: GetObservation, GetReward, GetGameOver, GetExtraInfo
+        SERIALIZE, //!< writing the state (flat, or protobuf build and serialization)
+        SEND_WAIT, //!< waiting in CppSendBegin
+        PYTHON,    //!< from CppSendEnd to CppRecvBegin returning: Python holds the step
+        PARSE,     //!< reading the action
+        EXECUTE,   //!< ExecuteActions
+        NUM_PHASES
+    };
+
+    /**
+     * Starts a step, and its first phase
+     */
+    void StartStep()
+    {
+        m_stepStart = Ns3AiMsgStats::Now();
+        m_phaseStart = m_stepStart;
+        for (uint32_t i = 0; i < NUM_PHASES; ++i)
+        {
+            m_current[i] = UINT64_MAX;
+        }
+    };
+
+    /**
+     * Ends the current phase, which is the given one, and starts the next
+     * one. A phase can occur several times per step, its durations add up.
+     */
+    void EndPhase(Phase phase)
+    {
+        uint64_t now = Ns3AiMsgStats::Now();
+        m_current[phase] = (m_current[phase] == UINT64_MAX ? 0 : m_current[phase]) +
+                           (now - m_phaseStart);
+        m_phaseStart = now;
+    };
+
+    /**
+     * Ends the step, recording the phases which occurred in it
+     */
+    void EndStep()
+    {
+        for (uint32_t i = 0; i < NUM_PHASES; ++i)
+        {
+            if (m_current[i] != UINT64_MAX)
+            {
+                m_phases[i].Record(m_current[i]);
+            }
+        }
+        m_steps.Record(Ns3AiMsgStats::Now() - m_stepStart);
+    };
+
+    const Ns3AiHistogram& GetPhase(Phase phase) const
+    {
+        return m_phases[phase];
+    };
+
+    /**
+     * Gets the histogram summaries of the phases and of the whole steps,
+     * keyed by name, with their total ("total_ns")
+     */
+    std::map<std::string, std::map<std::string, double>> ToMap() const
+    {
+        static const char* names[NUM_PHASES] =
+            {"collect", "serialize", "send_wait", "python", "parse", "execute"};
+        std::map<std::string, std::map<std::string, double>> ret;
+        for (uint32_t i = 0; i < NUM_PHASES; ++i)
+        {
+            ret[names[i]] = m_phases[i].ToMap();
+            ret[names[i]]["total_ns"] = m_phases[i].GetSum();
+        }
+        ret["step"] = m_steps.ToMap();
+        ret["step"]["total_ns"] = m_steps.GetSum();
+        return ret;
+    };
+
+    /**
+     * Prints a summary, in microseconds, with the share of each phase in
+     * the total time of the steps
+     */
+    void Print(std::ostream& os) const
+    {
+        double steps = m_steps.GetSum();
+        for (const auto& item : ToMap())
+        {
+            os << "  " << item.first << ": count " << uint64_t(item.second.at("count"))
+               << " total_ms " << item.second.at("total_ns") / 1e6 << " share "
+               << (steps > 0 ? item.second.at("total_ns") / steps : 0) << " mean_us "
+               << item.second.at("mean_ns") / 1000 << " p50_us " << item.second.at("p50_ns") / 1000
+               << " p99_us " << item.second.at("p99_ns") / 1000 << " max_us "
+               << item.second.at("max_ns") / 1000 << "\n";
+        }
+    };
+
+  private:
+    Ns3AiHistogram m_phases[NUM_PHASES];
+    Ns3AiHistogram m_steps;
+    uint64_t m_current[NUM_PHASES]{}; //!< durations of the current step, UINT64_MAX if none
+    uint64_t m_stepStart{0};          //!< start of the current step
+    uint64_t m_phaseStart{0};         //!< start of the current phase
+};
+
 class OpenGymInterface : public Object
 {
   public:
@@ -49,6 +168,79 @@ class OpenGymInterface : public Object
     void NotifyCurrentState();
     void WaitForStop();
     void NotifySimulationEnd();
+    /**
+     * Marks where episodes start when the Python side uses snapshots (see
+     * Ns3AiSnapshot::MarkEpisodeStart), before the first notification.
+     * Returns the episode number.
+     */
+    uint32_t MarkEpisodeStart();
+
+    /**
+     * How the observations of the notifications skipped by action repeat
+     * are combined into the observation sent at the next decision
+     */
+    enum ObservationPooling
+    {
+        POOL_LAST, //!< only the last observation (default)
+        POOL_MAX,  //!< the maximum of each Box element over the skipped notifications
+        POOL_SUM,  //!< the sum of each Box element over the skipped notifications
+    };
+
+    /**
+     * Repeats the last action instead of asking Python at each notification
+     * (frame skipping): Python decides again once k notifications have
+     * passed since its last decision (1, the default, decides at each one).
+     * The skipped notifications do not cross to Python: the last action is
+     * executed again, and their rewards are summed into the next decision.
+     * Their observations and extra info are not collected, unless pooled.
+     * Game over and simulation end are always sent.
+     */
+    void SetActionRepeat(uint32_t k);
+    /**
+     * Repeats the last action until the given simulated time has passed
+     * since the last decision (0, the default, disables it). With
+     * SetActionRepeat, Python decides when both are reached.
+     */
+    void SetDecisionInterval(Time interval);
+    /**
+     * Sets how the observations of the skipped notifications are combined.
+     * Pooling is element-wise over Box containers (also in tuples and
+     * dicts); if the observations do not match, the last one is sent.
+     */
+    void SetObservationPooling(ObservationPooling pooling);
+
+    /**
+     * Registers an environment as agent agentId of a multi-agent simulation,
+     * before the first notification (it also sets the interface of the
+     * environment). The agents must have the same spaces.
+     *
+     * Their notifications are then batched instead of crossing to Python one
+     * by one: the states of the agents which notify within the batch window
+     * are sent in one message, and Python answers with the actions of all of
+     * them, which are executed when the batch is sent (not within Notify).
+     * The Python side must use Ns3MultiAgentEnv. Action repeat does not apply
+     * to agents.
+     */
+    void RegisterAgent(uint32_t agentId, Ptr<OpenGymEnv> agent);
+    /**
+     * Sets how long after the first notification of a batch it is sent (0,
+     * the default, batches the notifications of the same simulation instant)
+     */
+    void SetBatchWindow(Time window);
+
+    /**
+     * Records the time spent in each phase of the steps (see
+     * OpenGymStepProfile), printed at NotifySimulationEnd. With a decision
+     * interval or action repeat, the skipped notifications only have the
+     * collect and execute phases. With agents, a step is a batch, whose
+     * states are collected as the agents notify, so it has no collect
+     * phase. Disabled by default.
+     */
+    void SetProfiling(bool profiling);
+    /**
+     * Gets the step profile, empty unless profiling
+     */
+    const OpenGymStepProfile& GetProfile() const;
 
     Ptr<OpenGymSpace> GetActionSpace();
     Ptr<OpenGymSpace> GetObservationSpace();
@@ -75,11 +267,97 @@ class OpenGymInterface : public Object
 
   private:
     static Ptr<OpenGymInterface>* DoGet();
+    /**
+     * Pools an observation with those of the skipped notifications, if any
+     */
+    Ptr<OpenGymDataContainer> PoolObservation(Ptr<OpenGymDataContainer> obs);
+    /**
+     * Adds the notification of a registered agent to the next batch
+     */
+    void NotifyAgent(Ptr<OpenGymEnv> agent);
+    /**
+     * Collects the current state of an agent into the next batch
+     */
+    void CollectAgentState(uint32_t agentId, Ptr<OpenGymEnv> agent);
+    /**
+     * Sends the batch of agent states, and executes the actions received
+     */
+    void SendBatch();
+    /**
+     * Starts a step of the step profile, if profiling
+     */
+    void StartStep()
+    {
+        if (m_profiling)
+        {
+            m_profile.StartStep();
+        }
+    };
+    /**
+     * Ends a phase of the step profile, if profiling
+     */
+    void EndPhase(OpenGymStepProfile::Phase phase)
+    {
+        if (m_profiling)
+        {
+            m_profile.EndPhase(phase);
+        }
+    };
+    /**
+     * Ends a step of the step profile, if profiling
+     */
+    void EndStep()
+    {
+        if (m_profiling)
+        {
+            m_profile.EndStep();
+        }
+    };
+
+    /**
+     * \brief State of an agent waiting for the next batch
+     */
+    struct AgentState
+    {
+        bool pending{false}; //!< whether the agent has notified since the last batch
+        Ptr<OpenGymDataContainer> obs;
+        float reward{0};
+        bool isGameOver{false};
+        std::string info;
+        Ptr<OpenGymDataContainer> action; //!< last action, refilled by the next batch
+    };
     //    static void Delete();
 
     bool m_simEnd;
     bool m_stopEnvRequested;
     bool m_initSimMsgSent;
+    bool m_flatSteps;                        //!< steps use the flat binary format
+    Ptr<OpenGymSpace> m_actionSpace;         //!< to create actions in the flat binary format
+    std::vector<OpenGymFlatLeaf> m_obsLayout; //!< flat layout of the observation space
+    std::vector<OpenGymFlatLeaf> m_actLayout; //!< flat layout of the action space
+
+    uint32_t m_actionRepeat;                //!< notifications per decision
+    Time m_decisionInterval;                //!< simulated time per decision
+    ObservationPooling m_pooling;           //!< combining of skipped observations
+    bool m_decided;                         //!< whether Python has decided an action
+    Time m_lastDecision;                    //!< time of the last decision
+    uint32_t m_skipped;                     //!< notifications since the last decision
+    float m_skippedReward;                  //!< reward of the skipped notifications
+    Ptr<OpenGymDataContainer> m_skippedObs; //!< pooled observation of the skipped ones
+    Ptr<OpenGymDataContainer> m_lastAction; //!< action repeated until the next decision
+
+    ns3_ai_gym::EnvStateMsg m_envStateMsg; //!< reused by the steps in protobuf
+    ns3_ai_gym::EnvActMsg m_envActMsg;     //!< reused by the steps in protobuf
+
+    std::map<uint32_t, Ptr<OpenGymEnv>> m_agents;               //!< registered agents by ID
+    std::unordered_map<const OpenGymEnv*, uint32_t> m_agentIds; //!< IDs of the agents
+    std::map<uint32_t, AgentState> m_batch;                     //!< states of the agents
+    std::vector<uint32_t> m_batchIds;                           //!< agents of the current batch
+    Time m_batchWindow;                                         //!< delay of the batches
+    EventId m_batchEvent;                                       //!< sends the next batch
+
+    bool m_profiling;             //!< whether the steps are profiled
+    OpenGymStepProfile m_profile; //!< time spent in each phase of the steps
 
     Callback<Ptr<OpenGymSpace>> m_actionSpaceCb;
     Callback<Ptr<OpenGymSpace>> m_observationSpaceCb;
@@ -21,9 +21,15 @@
 
 #include "spaces.h"
 
+#include "container.h"
+
+#include "ns3/abort.h"
 #include "ns3/log.h"
 #include "ns3/object.h"
 
+#include <cstring>
+#include <map>
+
 namespace ns3
 {
 
@@ -59,6 +65,39 @@ OpenGymSpace::DoInitialize()
     NS_LOG_FUNCTION(this);
 }
 
+std::vector<OpenGymFlatLeaf>
+OpenGymSpace::GetFlatLayout()
+{
+    std::vector<OpenGymFlatLeaf> layout;
+    AddFlatLeaves("", layout);
+    return layout;
+}
+
+uint32_t
+OpenGymSpace::GetFlatSize(const std::vector<OpenGymFlatLeaf>& layout)
+{
+    return layout.empty() ? 0 : layout.back().GetEnd();
+}
+
+void
+OpenGymSpace::AddFlatLeaf(std::vector<OpenGymFlatLeaf>& layout,
+                          const std::string& path,
+                          ns3_ai_gym::SpaceType type,
+                          ns3_ai_gym::Dtype dtype,
+                          uint32_t count)
+{
+    OpenGymFlatLeaf leaf{path, type, dtype, count, 0};
+    uint32_t elementSize = leaf.GetElementSize();
+    leaf.offset = (GetFlatSize(layout) + elementSize - 1) / elementSize * elementSize;
+    layout.push_back(leaf);
+}
+
+std::string
+OpenGymSpace::GetChildPath(const std::string& path, const std::string& name)
+{
+    return path.empty() ? name : path + "/" + name;
+}
+
 TypeId
 OpenGymDiscreteSpace::GetTypeId()
 {
@@ -116,6 +155,30 @@ OpenGymDiscreteSpace::GetSpaceDescription()
     return desc;
 }
 
+uint32_t
+OpenGymDiscreteSpace::GetMaxDataSize()
+{
+    // an int32 varint takes at most 10 bytes, plus its tag
+    return CONTAINER_OVERHEAD + 11;
+}
+
+void
+OpenGymDiscreteSpace::AddFlatLeaves(const std::string& path, std::vector<OpenGymFlatLeaf>& layout)
+{
+    AddFlatLeaf(layout, path, ns3_ai_gym::Discrete, ns3_ai_gym::NoDType, 1);
+}
+
+Ptr<OpenGymDataContainer>
+OpenGymDiscreteSpace::CreateFromFlat(const uint8_t* buffer, const OpenGymFlatLeaf*& leaf)
+{
+    int32_t value;
+    std::memcpy(&value, buffer + leaf->offset, sizeof(value));
+    ++leaf;
+    Ptr<OpenGymDiscreteContainer> discrete = CreateObject<OpenGymDiscreteContainer>();
+    discrete->SetValue(value);
+    return discrete;
+}
+
 void
 OpenGymDiscreteSpace::Print(std::ostream& where) const
 {
@@ -186,27 +249,22 @@ OpenGymBoxSpace::DoInitialize()
 void
 OpenGymBoxSpace::SetDtype()
 {
-    std::string name = m_dtypeName;
-    if (name == "int8_t" || name == "int16_t" || name == "int32_t" || name == "int64_t")
-    {
-        m_dtype = ns3_ai_gym::INT;
-    }
-    else if (name == "uint8_t" || name == "uint16_t" || name == "uint32_t" || name == "uint64_t")
-    {
-        m_dtype = ns3_ai_gym::UINT;
-    }
-    else if (name == "float")
-    {
-        m_dtype = ns3_ai_gym::FLOAT;
-    }
-    else if (name == "double")
-    {
-        m_dtype = ns3_ai_gym::DOUBLE;
-    }
-    else
-    {
-        m_dtype = ns3_ai_gym::FLOAT;
-    }
+    // names from TypeNameGet, or NumPy's
+    static const std::map<std::string, ns3_ai_gym::Dtype> dtypes = {
+        {"int8_t", ns3_ai_gym::INT8},     {"int8", ns3_ai_gym::INT8},
+        {"int16_t", ns3_ai_gym::INT16},   {"int16", ns3_ai_gym::INT16},
+        {"int32_t", ns3_ai_gym::INT},     {"int32", ns3_ai_gym::INT},
+        {"int64_t", ns3_ai_gym::INT64},   {"int64", ns3_ai_gym::INT64},
+        {"uint8_t", ns3_ai_gym::UINT8},   {"uint8", ns3_ai_gym::UINT8},
+        {"uint16_t", ns3_ai_gym::UINT16}, {"uint16", ns3_ai_gym::UINT16},
+        {"uint32_t", ns3_ai_gym::UINT},   {"uint32", ns3_ai_gym::UINT},
+        {"uint64_t", ns3_ai_gym::UINT64}, {"uint64", ns3_ai_gym::UINT64},
+        {"float16", ns3_ai_gym::FLOAT16}, {"float", ns3_ai_gym::FLOAT},
+        {"float32", ns3_ai_gym::FLOAT},   {"double", ns3_ai_gym::DOUBLE},
+        {"float64", ns3_ai_gym::DOUBLE},
+    };
+    auto it = dtypes.find(m_dtypeName);
+    m_dtype = it == dtypes.end() ? ns3_ai_gym::FLOAT : it->second;
 }
 
 float
@@ -252,6 +310,76 @@ OpenGymBoxSpace::GetSpaceDescription()
     return desc;
 }
 
+uint32_t
+OpenGymBoxSpace::GetMaxDataSize()
+{
+    uint64_t count = 1;
+    for (auto dim : m_shape)
+    {
+        count *= dim;
+    }
+    // packed repeated fields, varints take at most 10 (int32) or 5 (uint32)
+    // bytes, half precision is held as float and sent as packed floats, the
+    // other dtypes are raw bytes
+    uint32_t elementSize = OpenGymDtypeSize(m_dtype);
+    if (m_dtype == ns3_ai_gym::INT)
+    {
+        elementSize = 10;
+    }
+    else if (m_dtype == ns3_ai_gym::UINT)
+    {
+        elementSize = 5;
+    }
+    else if (m_dtype == ns3_ai_gym::FLOAT16)
+    {
+        elementSize = sizeof(float);
+    }
+    return static_cast<uint32_t>(CONTAINER_OVERHEAD + 16 + 5 * m_shape.size() +
+                                 count * elementSize);
+}
+
+void
+OpenGymBoxSpace::AddFlatLeaves(const std::string& path, std::vector<OpenGymFlatLeaf>& layout)
+{
+    uint64_t count = 1;
+    for (auto dim : m_shape)
+    {
+        count *= dim;
+    }
+    AddFlatLeaf(layout, path, ns3_ai_gym::Box, m_dtype, static_cast<uint32_t>(count));
+}
+
+Ptr<OpenGymDataContainer>
+OpenGymBoxSpace::CreateFromFlat(const uint8_t* buffer, const OpenGymFlatLeaf*& leaf)
+{
+    const OpenGymFlatLeaf& box = *leaf++;
+    // elements of wire type W, in a container of the same type (float for half precision)
+    return OpenGymDtypeVisit(m_dtype, [&](auto* type) -> Ptr<OpenGymDataContainer> {
+        using W = std::remove_pointer_t<decltype(type)>;
+        using T = OpenGymElementType<W>;
+        Ptr<OpenGymBoxContainer<T>> container = CreateObject<OpenGymBoxContainer<T>>(m_shape);
+        std::vector<T> data(box.count);
+        if constexpr (std::is_same<T, W>::value)
+        {
+            if (!data.empty())
+            {
+                std::memcpy(data.data(), buffer + box.offset, data.size() * sizeof(T));
+            }
+        }
+        else
+        {
+            for (uint32_t i = 0; i < box.count; ++i)
+            {
+                W value;
+                std::memcpy(&value, buffer + box.offset + i * sizeof(W), sizeof(W));
+                data[i] = static_cast<T>(value);
+            }
+        }
+        container->SetData(std::move(data));
+        return container;
+    });
+}
+
 void
 OpenGymBoxSpace::Print(std::ostream& where) const
 {
@@ -338,6 +466,38 @@ OpenGymTupleSpace::GetSpaceDescription()
     return desc;
 }
 
+uint32_t
+OpenGymTupleSpace::GetMaxDataSize()
+{
+    uint32_t size = CONTAINER_OVERHEAD;
+    for (const auto& space : m_tuple)
+    {
+        // tag and length of the element
+        size += space->GetMaxDataSize() + 6;
+    }
+    return size;
+}
+
+void
+OpenGymTupleSpace::AddFlatLeaves(const std::string& path, std::vector<OpenGymFlatLeaf>& layout)
+{
+    for (uint32_t i = 0; i < m_tuple.size(); ++i)
+    {
+        m_tuple[i]->AddFlatLeaves(GetChildPath(path, std::to_string(i)), layout);
+    }
+}
+
+Ptr<OpenGymDataContainer>
+OpenGymTupleSpace::CreateFromFlat(const uint8_t* buffer, const OpenGymFlatLeaf*& leaf)
+{
+    Ptr<OpenGymTupleContainer> tuple = CreateObject<OpenGymTupleContainer>();
+    for (const auto& space : m_tuple)
+    {
+        tuple->Add(space->CreateFromFlat(buffer, leaf));
+    }
+    return tuple;
+}
+
 void
 OpenGymTupleSpace::Print(std::ostream& where) const
 {
@@ -430,6 +590,38 @@ OpenGymDictSpace::GetSpaceDescription()
     return desc;
 }
 
+uint32_t
+OpenGymDictSpace::GetMaxDataSize()
+{
+    uint32_t size = CONTAINER_OVERHEAD;
+    for (const auto& item : m_dict)
+    {
+        // the element's name, tag and length
+        size += item.second->GetMaxDataSize() + item.first.size() + 12;
+    }
+    return size;
+}
+
+void
+OpenGymDictSpace::AddFlatLeaves(const std::string& path, std::vector<OpenGymFlatLeaf>& layout)
+{
+    for (const auto& item : m_dict)
+    {
+        item.second->AddFlatLeaves(GetChildPath(path, item.first), layout);
+    }
+}
+
+Ptr<OpenGymDataContainer>
+OpenGymDictSpace::CreateFromFlat(const uint8_t* buffer, const OpenGymFlatLeaf*& leaf)
+{
+    Ptr<OpenGymDictContainer> dict = CreateObject<OpenGymDictContainer>();
+    for (const auto& item : m_dict)
+    {
+        dict->Add(item.first, item.second->CreateFromFlat(buffer, leaf));
+    }
+    return dict;
+}
+
 void
 OpenGymDictSpace::Print(std::ostream& where) const
 {
@@ -26,9 +26,244 @@
 
 #include "ns3/object.h"
 
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
 namespace ns3
 {
 
+class OpenGymDataContainer;
+
+/**
+ * \brief An IEEE 754 half precision number, the elements of FLOAT16 Boxes
+ * on the wire. Containers hold them as float: they are only converted
+ * when written or read in the flat binary format.
+ */
+struct OpenGymFloat16
+{
+    uint16_t bits; //!< sign, 5 exponent bits and 10 mantissa bits
+
+    OpenGymFloat16() = default;
+
+    /**
+     * Converts a float, rounding to the nearest even
+     */
+    explicit OpenGymFloat16(float value)
+    {
+        uint32_t f;
+        std::memcpy(&f, &value, sizeof(f));
+        uint32_t sign = (f >> 16) & 0x8000;
+        int32_t exponent = int32_t((f >> 23) & 0xff) - 127 + 15;
+        uint32_t mantissa = f & 0x7fffff;
+        if (((f >> 23) & 0xff) == 0xff)
+        {
+            // infinity or NaN
+            bits = sign | 0x7c00 | (mantissa ? 0x200 : 0);
+            return;
+        }
+        if (exponent >= 31)
+        {
+            bits = sign | 0x7c00;
+            return;
+        }
+        uint32_t shift = 13;
+        if (exponent <= 0)
+        {
+            // subnormal, or too small
+            if (exponent < -10)
+            {
+                bits = sign;
+                return;
+            }
+            mantissa |= 0x800000;
+            shift = 14 - exponent;
+            exponent = 0;
+        }
+        uint32_t half = (uint32_t(exponent) << 10) | (mantissa >> shift);
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t middle = 1u << (shift - 1);
+        // a carry into the exponent is still correct (up to infinity)
+        if (rest > middle || (rest == middle && (half & 1)))
+        {
+            ++half;
+        }
+        bits = sign | half;
+    };
+
+    explicit operator float() const
+    {
+        uint32_t sign = uint32_t(bits & 0x8000) << 16;
+        uint32_t exponent = (bits >> 10) & 0x1f;
+        uint32_t mantissa = bits & 0x3ff;
+        uint32_t f;
+        if (exponent == 0x1f)
+        {
+            f = sign | 0x7f800000 | (mantissa << 13);
+        }
+        else if (exponent != 0)
+        {
+            f = sign | ((exponent + 112) << 23) | (mantissa << 13);
+        }
+        else if (mantissa == 0)
+        {
+            f = sign;
+        }
+        else
+        {
+            // subnormal, normalized in float
+            exponent = 113;
+            while (!(mantissa & 0x400))
+            {
+                mantissa <<= 1;
+                --exponent;
+            }
+            f = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+        }
+        float value;
+        std::memcpy(&value, &f, sizeof(value));
+        return value;
+    };
+};
+
+/**
+ * Gets the wire type of Box elements of C++ type T, at compile time: the
+ * integer of the same size and signedness, float or double (or half
+ * precision for OpenGymFloat16). Other types are sent as float.
+ */
+template <typename T>
+constexpr ns3_ai_gym::Dtype
+OpenGymDtypeGet()
+{
+    if constexpr (std::is_same<T, double>::value)
+    {
+        return ns3_ai_gym::DOUBLE;
+    }
+    else if constexpr (std::is_same<T, OpenGymFloat16>::value)
+    {
+        return ns3_ai_gym::FLOAT16;
+    }
+    else if constexpr (std::is_integral<T>::value && !std::is_same<T, bool>::value &&
+                       std::is_signed<T>::value)
+    {
+        return sizeof(T) == 1   ? ns3_ai_gym::INT8
+               : sizeof(T) == 2 ? ns3_ai_gym::INT16
+               : sizeof(T) == 4 ? ns3_ai_gym::INT
+                                : ns3_ai_gym::INT64;
+    }
+    else if constexpr (std::is_integral<T>::value && !std::is_same<T, bool>::value)
+    {
+        return sizeof(T) == 1   ? ns3_ai_gym::UINT8
+               : sizeof(T) == 2 ? ns3_ai_gym::UINT16
+               : sizeof(T) == 4 ? ns3_ai_gym::UINT
+                                : ns3_ai_gym::UINT64;
+    }
+    else
+    {
+        return ns3_ai_gym::FLOAT;
+    }
+}
+
+/**
+ * Gets the size of an element of the given wire type in bytes (4 for
+ * NoDType, the int32 value of Discrete spaces)
+ */
+constexpr uint32_t
+OpenGymDtypeSize(ns3_ai_gym::Dtype dtype)
+{
+    switch (dtype)
+    {
+    case ns3_ai_gym::INT8:
+    case ns3_ai_gym::UINT8:
+        return 1;
+    case ns3_ai_gym::INT16:
+    case ns3_ai_gym::UINT16:
+    case ns3_ai_gym::FLOAT16:
+        return 2;
+    case ns3_ai_gym::INT64:
+    case ns3_ai_gym::UINT64:
+    case ns3_ai_gym::DOUBLE:
+        return 8;
+    default:
+        return 4;
+    }
+}
+
+/**
+ * Calls f with a null pointer to the C++ type of the elements of the
+ * given wire type (float for unknown types), to instantiate code for
+ * each type, e.g.: OpenGymDtypeVisit(dtype, [&](auto* type) { ... });
+ */
+template <typename F>
+auto
+OpenGymDtypeVisit(ns3_ai_gym::Dtype dtype, F&& f)
+{
+    switch (dtype)
+    {
+    case ns3_ai_gym::INT8:
+        return f(static_cast<int8_t*>(nullptr));
+    case ns3_ai_gym::INT16:
+        return f(static_cast<int16_t*>(nullptr));
+    case ns3_ai_gym::INT:
+        return f(static_cast<int32_t*>(nullptr));
+    case ns3_ai_gym::INT64:
+        return f(static_cast<int64_t*>(nullptr));
+    case ns3_ai_gym::UINT8:
+        return f(static_cast<uint8_t*>(nullptr));
+    case ns3_ai_gym::UINT16:
+        return f(static_cast<uint16_t*>(nullptr));
+    case ns3_ai_gym::UINT:
+        return f(static_cast<uint32_t*>(nullptr));
+    case ns3_ai_gym::UINT64:
+        return f(static_cast<uint64_t*>(nullptr));
+    case ns3_ai_gym::FLOAT16:
+        return f(static_cast<OpenGymFloat16*>(nullptr));
+    case ns3_ai_gym::DOUBLE:
+        return f(static_cast<double*>(nullptr));
+    default:
+        return f(static_cast<float*>(nullptr));
+    }
+}
+
+/**
+ * The element type of the Box containers created for elements of wire
+ * type W: W itself, except float for half precision
+ */
+template <typename W>
+using OpenGymElementType =
+    typename std::conditional<std::is_same<W, OpenGymFloat16>::value, float, W>::type;
+
+/**
+ * \brief A leaf (Box or Discrete space) of a space tree compiled into the
+ * flat binary format: all the leaves of a sample are in one buffer, each
+ * at a fixed offset
+ */
+struct OpenGymFlatLeaf
+{
+    std::string path;          //!< e.g., "1/rates" for key "rates" of the 2nd tuple element
+    ns3_ai_gym::SpaceType type; //!< Box or Discrete
+    ns3_ai_gym::Dtype dtype;    //!< type of the Box elements, NoDType for Discrete
+    uint32_t count;             //!< number of elements (1 for Discrete)
+    uint32_t offset;            //!< in bytes, aligned to the element size
+
+    /**
+     * Gets the size of an element, that of its dtype (or of the int32
+     * Discrete value)
+     */
+    uint32_t GetElementSize() const
+    {
+        return OpenGymDtypeSize(dtype);
+    };
+
+    /**
+     * Gets the offset of the end of the leaf
+     */
+    uint32_t GetEnd() const
+    {
+        return offset + count * GetElementSize();
+    };
+};
+
 class OpenGymSpace : public Object
 {
   public:
@@ -38,9 +273,57 @@ class OpenGymSpace : public Object
     static TypeId GetTypeId();
 
     virtual ns3_ai_gym::SpaceDescription GetSpaceDescription() = 0;
+    /**
+     * Gets an upper bound of the serialized size of a data container
+     * holding a sample of this space, used to size the message buffers
+     */
+    virtual uint32_t GetMaxDataSize() = 0;
     virtual void Print(std::ostream& where) const = 0;
 
+    /**
+     * Compiles the space tree into the flat binary format, which replaces
+     * protobuf for the steps (see OpenGymInterface::Init). The leaves are
+     * in the order of GetSpaceDescription (tuple elements in order, dict
+     * keys sorted).
+     */
+    std::vector<OpenGymFlatLeaf> GetFlatLayout();
+    /**
+     * Gets the size of the samples of a layout in bytes
+     */
+    static uint32_t GetFlatSize(const std::vector<OpenGymFlatLeaf>& layout);
+    /**
+     * Appends the leaves of this space to the layout, at the given path
+     */
+    virtual void AddFlatLeaves(const std::string& path, std::vector<OpenGymFlatLeaf>& layout) = 0;
+    /**
+     * Creates a container of this space from a sample in the flat binary
+     * format, reading the leaves of this space from leaf on (advanced past
+     * them). Box data gives the same container types as
+     * OpenGymDataContainer::CreateFromDataContainerPbMsg.
+     */
+    virtual Ptr<OpenGymDataContainer> CreateFromFlat(const uint8_t* buffer,
+                                                     const OpenGymFlatLeaf*& leaf) = 0;
+
   protected:
+    /**
+     * Appends a leaf after the last one of the layout, aligned
+     */
+    static void AddFlatLeaf(std::vector<OpenGymFlatLeaf>& layout,
+                            const std::string& path,
+                            ns3_ai_gym::SpaceType type,
+                            ns3_ai_gym::Dtype dtype,
+                            uint32_t count);
+    /**
+     * Gets the path of a child of the space at path
+     */
+    static std::string GetChildPath(const std::string& path, const std::string& name);
+
+    /**
+     * Bytes of a data container besides its data: type, name and the
+     * type URL of the packed message
+     */
+    static constexpr uint32_t CONTAINER_OVERHEAD = 96;
+
     // Inherited
     void DoInitialize() override;
     void DoDispose() override;
@@ -56,6 +339,10 @@ class OpenGymDiscreteSpace : public OpenGymSpace
     static TypeId GetTypeId();
 
     ns3_ai_gym::SpaceDescription GetSpaceDescription() override;
+    uint32_t GetMaxDataSize() override;
+    void AddFlatLeaves(const std::string& path, std::vector<OpenGymFlatLeaf>& layout) override;
+    Ptr<OpenGymDataContainer> CreateFromFlat(const uint8_t* buffer,
+                                             const OpenGymFlatLeaf*& leaf) override;
 
     int GetN();
     void Print(std::ostream& where) const override;
@@ -89,6 +376,10 @@ class OpenGymBoxSpace : public OpenGymSpace
     static TypeId GetTypeId();
 
     ns3_ai_gym::SpaceDescription GetSpaceDescription() override;
+    uint32_t GetMaxDataSize() override;
+    void AddFlatLeaves(const std::string& path, std::vector<OpenGymFlatLeaf>& layout) override;
+    Ptr<OpenGymDataContainer> CreateFromFlat(const uint8_t* buffer,
+                                             const OpenGymFlatLeaf*& leaf) override;
 
     float GetLow();
     float GetHigh();
@@ -129,6 +420,10 @@ class OpenGymTupleSpace : public OpenGymSpace
     static TypeId GetTypeId();
 
     ns3_ai_gym::SpaceDescription GetSpaceDescription() override;
+    uint32_t GetMaxDataSize() override;
+    void AddFlatLeaves(const std::string& path, std::vector<OpenGymFlatLeaf>& layout) override;
+    Ptr<OpenGymDataContainer> CreateFromFlat(const uint8_t* buffer,
+                                             const OpenGymFlatLeaf*& leaf) override;
 
     bool Add(Ptr<OpenGymSpace> space);
     Ptr<OpenGymSpace> Get(uint32_t idx);
@@ -159,6 +454,10 @@ class OpenGymDictSpace : public OpenGymSpace
     static TypeId GetTypeId();
 
     ns3_ai_gym::SpaceDescription GetSpaceDescription() override;
+    uint32_t GetMaxDataSize() override;
+    void AddFlatLeaves(const std::string& path, std::vector<OpenGymFlatLeaf>& layout) override;
+    Ptr<OpenGymDataContainer> CreateFromFlat(const uint8_t* buffer,
+                                             const OpenGymFlatLeaf*& leaf) override;
 
     bool Add(std::string key, Ptr<OpenGymSpace> value);
     Ptr<OpenGymSpace> Get(std::string key);
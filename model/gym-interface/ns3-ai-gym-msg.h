@@ -22,12 +22,94 @@
 
 #include <stdint.h>
 
-#define MSG_BUFFER_SIZE 1024
-
+/**
+ * \brief One byte of a serialized Gym message.
+ *
+ * The Gym interface uses the vector-based message interface with this
+ * element type: each message is serialized in place into a vector in the
+ * segment. The vectors are sized at OpenGymInterface::Init from the
+ * declared spaces, and grow (with the segment) when a message is larger.
+ */
 struct Ns3AiGymMsg
 {
-    uint8_t buffer[MSG_BUFFER_SIZE];
-    uint32_t size;
+    uint8_t byte;
+};
+
+static_assert(sizeof(Ns3AiGymMsg) == 1, "Gym message vectors must be plain bytes");
+
+/**
+ * \brief Format of the data (observation or action) of a step message
+ */
+enum Ns3AiGymDataFormat : uint8_t
+{
+    /**
+     * The leaves of the space at the offsets compiled by
+     * OpenGymSpace::GetFlatLayout: Box elements in the native dtype of the
+     * space (8 to 64-bit integers, float16, float or double, see
+     * OpenGymDtypeSize) and int32 for Discrete values
+     */
+    NS3AI_GYM_FLAT = 0,
+    /**
+     * A serialized ns3_ai_gym::DataContainer, when the data does not match
+     * the declared space (e.g., a Box with another shape)
+     */
+    NS3AI_GYM_PROTOBUF = 1,
+};
+
+/**
+ * \brief Header of a step message from C++ in the flat binary format,
+ * which replaces protobuf after Init (see SimInitMsg.flatSteps).
+ *
+ * It is followed by obsBytes bytes of observation and infoBytes bytes of
+ * extra info.
+ */
+struct Ns3AiGymStateHeader
+{
+    float reward;
+    uint8_t isGameOver;
+    uint8_t reason;    //!< an ns3_ai_gym::EnvStateMsg::Reason
+    uint8_t obsFormat; //!< an Ns3AiGymDataFormat
+    uint8_t reserved;
+    uint32_t obsBytes;
+    uint32_t infoBytes;
 };
 
+/**
+ * \brief Header of a step message from Python in the flat binary format,
+ * followed by actBytes bytes of action (as in Ns3AiGymStateHeader)
+ */
+struct Ns3AiGymActionHeader
+{
+    uint8_t stopSimReq;
+    uint8_t actFormat; //!< an Ns3AiGymDataFormat
+    uint16_t reserved;
+    uint32_t actBytes;
+};
+
+/**
+ * \brief Header of a batched step message, in multi-agent mode (see
+ * OpenGymInterface::RegisterAgent). It is followed by numAgents records,
+ * each starting at a multiple of 8 bytes: an Ns3AiGymAgentHeader, then the
+ * step message of the agent (state or action, as in single-agent mode).
+ */
+struct Ns3AiGymBatchHeader
+{
+    uint32_t numAgents;
+    uint8_t stopSimReq; //!< from Python only, no records follow
+    uint8_t reserved[3];
+};
+
+/**
+ * \brief Header of the record of an agent in a batched step message
+ */
+struct Ns3AiGymAgentHeader
+{
+    uint32_t agentId;
+    uint32_t bytes; //!< size of the step message which follows
+};
+
+static_assert(sizeof(Ns3AiGymStateHeader) == 16 && sizeof(Ns3AiGymActionHeader) == 8 &&
+                  sizeof(Ns3AiGymBatchHeader) == 8 && sizeof(Ns3AiGymAgentHeader) == 8,
+              "the Python side parses the headers with fixed layouts");
+
 #endif // NS3_NS3_AI_GYM_MSG_H
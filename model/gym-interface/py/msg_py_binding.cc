@@ -18,26 +18,30 @@
  */
 
 #include <ns3/ai-module.h>
+#include <ns3-ai-msg-async-py.h>
+#include <ns3-ai-launch-py.h>
+#include <ns3-ai-msg-replay-py.h>
+#include <ns3-ai-snapshot-py.h>
 
 #include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
 
 namespace py = pybind11;
 
+typedef ns3::Ns3AiMsgInterfaceImpl<Ns3AiGymMsg, Ns3AiGymMsg> GymMsgInterface;
+
 PYBIND11_MODULE(ns3ai_gym_msg_py, m)
 {
-    m.attr("msg_buffer_size") = MSG_BUFFER_SIZE;
-
-    py::class_<Ns3AiGymMsg>(m, "Ns3AiGymMsg")
-        .def(py::init<>())
-        .def_readwrite("size", &Ns3AiGymMsg::size)
-        .def("get_buffer",
-             [](Ns3AiGymMsg& msg) {
-                 // Get memoryview of the buffer
-                 return py::memoryview::from_memory((void*)msg.buffer, msg.size);
-             })
-        .def("get_buffer_full", [](Ns3AiGymMsg& msg) {
-            // Get memoryview of the buffer
-            return py::memoryview::from_memory((void*)msg.buffer, MSG_BUFFER_SIZE);
+    // both directions use the same vector type
+    static_assert(std::is_same<GymMsgInterface::Cpp2PyMsgVector,
+                               GymMsgInterface::Py2CppMsgVector>::value,
+                  "Gym message vectors must have the same type");
+    py::class_<GymMsgInterface::Cpp2PyMsgVector>(m, "Ns3AiGymMsgVector")
+        .def("__len__", &GymMsgInterface::Cpp2PyMsgVector::size)
+        .def("get_buffer", [](GymMsgInterface::Cpp2PyMsgVector& vec) {
+            // memoryview of the message in shared memory, valid until the vector is resized
+            return py::memoryview::from_memory(vec.empty() ? nullptr : &vec.front().byte,
+                                               static_cast<py::ssize_t>(vec.size()));
         });
 
     py::class_<ns3::Ns3AiMsgInterfaceImpl<Ns3AiGymMsg, Ns3AiGymMsg>>(m, "Ns3AiMsgInterfaceImpl")
@@ -49,14 +53,54 @@ PYBIND11_MODULE(ns3ai_gym_msg_py, m)
                       const char*,
                       const char*,
                       const char*>())
-        .def("PyRecvBegin", &ns3::Ns3AiMsgInterfaceImpl<Ns3AiGymMsg, Ns3AiGymMsg>::PyRecvBegin)
-        .def("PyRecvEnd", &ns3::Ns3AiMsgInterfaceImpl<Ns3AiGymMsg, Ns3AiGymMsg>::PyRecvEnd)
-        .def("PySendBegin", &ns3::Ns3AiMsgInterfaceImpl<Ns3AiGymMsg, Ns3AiGymMsg>::PySendBegin)
-        .def("PySendEnd", &ns3::Ns3AiMsgInterfaceImpl<Ns3AiGymMsg, Ns3AiGymMsg>::PySendEnd)
-        .def("GetCpp2PyStruct",
-             &ns3::Ns3AiMsgInterfaceImpl<Ns3AiGymMsg, Ns3AiGymMsg>::GetCpp2PyStruct,
+        .def("PyRecvBegin",
+             &ns3::Ns3AiMsgInterfaceImpl<Ns3AiGymMsg, Ns3AiGymMsg>::PyRecvBegin,
+             py::call_guard<py::gil_scoped_release>())
+        .def("PyRecvEnd",
+             &ns3::Ns3AiMsgInterfaceImpl<Ns3AiGymMsg, Ns3AiGymMsg>::PyRecvEnd,
+             py::call_guard<py::gil_scoped_release>())
+        .def("PySendBegin",
+             &ns3::Ns3AiMsgInterfaceImpl<Ns3AiGymMsg, Ns3AiGymMsg>::PySendBegin,
+             py::call_guard<py::gil_scoped_release>())
+        .def("PySendEnd",
+             &ns3::Ns3AiMsgInterfaceImpl<Ns3AiGymMsg, Ns3AiGymMsg>::PySendEnd,
+             py::call_guard<py::gil_scoped_release>())
+        .def("SetWaitMode",
+             [](ns3::Ns3AiMsgInterfaceImpl<Ns3AiGymMsg, Ns3AiGymMsg>& self,
+                uint8_t mode,
+                uint32_t spinBudgetUs) {
+                 self.SetWaitMode(static_cast<Ns3AiSemaphore::WaitMode>(mode), spinBudgetUs);
+             })
+        .def("GetSendWaitStats",
+             [](ns3::Ns3AiMsgInterfaceImpl<Ns3AiGymMsg, Ns3AiGymMsg>& self) {
+                 return self.GetSendWaitStats().ToMap();
+             })
+        .def("GetRecvWaitStats",
+             [](ns3::Ns3AiMsgInterfaceImpl<Ns3AiGymMsg, Ns3AiGymMsg>& self) {
+                 return self.GetRecvWaitStats().ToMap();
+             })
+        .def("SetHugePages", &ns3::Ns3AiMsgInterfaceImpl<Ns3AiGymMsg, Ns3AiGymMsg>::SetHugePages)
+        .def("GetMemorySize", &ns3::Ns3AiMsgInterfaceImpl<Ns3AiGymMsg, Ns3AiGymMsg>::GetMemorySize)
+        .def("GetFreeMemory", &ns3::Ns3AiMsgInterfaceImpl<Ns3AiGymMsg, Ns3AiGymMsg>::GetFreeMemory)
+        .def("EnableStats", &ns3::Ns3AiMsgInterfaceImpl<Ns3AiGymMsg, Ns3AiGymMsg>::EnableStats)
+        .def("GetStats",
+             [](ns3::Ns3AiMsgInterfaceImpl<Ns3AiGymMsg, Ns3AiGymMsg>& self) -> py::object {
+                 const ns3::Ns3AiMsgStats* stats = self.GetStats();
+                 return stats ? py::cast(stats->ToMap()) : py::none();
+             })
+        .def("GetCpp2PyVector",
+             &ns3::Ns3AiMsgInterfaceImpl<Ns3AiGymMsg, Ns3AiGymMsg>::GetCpp2PyVector,
              py::return_value_policy::reference)
-        .def("GetPy2CppStruct",
-             &ns3::Ns3AiMsgInterfaceImpl<Ns3AiGymMsg, Ns3AiGymMsg>::GetPy2CppStruct,
-             py::return_value_policy::reference);
+        .def("GetPy2CppVector",
+             &ns3::Ns3AiMsgInterfaceImpl<Ns3AiGymMsg, Ns3AiGymMsg>::GetPy2CppVector,
+             py::return_value_policy::reference)
+        .def("ResizeCpp2PyVector",
+             &ns3::Ns3AiMsgInterfaceImpl<Ns3AiGymMsg, Ns3AiGymMsg>::ResizeCpp2PyVector)
+        .def("ResizePy2CppVector",
+             &ns3::Ns3AiMsgInterfaceImpl<Ns3AiGymMsg, Ns3AiGymMsg>::ResizePy2CppVector);
+
+    ns3::Ns3AiBindMsgReplayer<Ns3AiGymMsg, Ns3AiGymMsg>(m);
+    ns3::Ns3AiBindMsgAsync<Ns3AiGymMsg, Ns3AiGymMsg>(m);
+    ns3::Ns3AiBindSnapshot(m);
+    ns3::Ns3AiBindLaunch(m);
 }
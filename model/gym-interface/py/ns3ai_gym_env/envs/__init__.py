@@ -1 +1,3 @@
 from ns3ai_gym_env.envs.ns3_environment import Ns3Env
+from ns3ai_gym_env.envs.ns3_vector_environment import Ns3VectorEnv
+from ns3ai_gym_env.envs.ns3_multiagent_environment import Ns3MultiAgentEnv
@@ -1,13 +1,104 @@
+import struct
+import time
+from collections import namedtuple
 import numpy as np
 import gymnasium as gym
 from gymnasium import spaces
 import messages_pb2 as pb
 import ns3ai_gym_msg_py as py_binding
-from ns3ai_utils import Experiment
+from ns3ai_utils import Experiment, Replay
+
+# headers of the steps in the flat binary format, see Ns3AiGymStateHeader
+# and Ns3AiGymActionHeader in ns3-ai-gym-msg.h
+STATE_HEADER = struct.Struct('=fBBBxII')
+ACTION_HEADER = struct.Struct('=BBxxI')
+# headers of the batched steps in multi-agent mode, see Ns3AiGymBatchHeader
+# and Ns3AiGymAgentHeader
+BATCH_HEADER = struct.Struct('=IB3x')
+AGENT_HEADER = struct.Struct('=II')
+# formats of the data of a step, see Ns3AiGymDataFormat
+FLAT_FORMAT = 0
+PROTOBUF_FORMAT = 1
+# NumPy dtypes of the Box elements by wire type, in the flat format and rawData
+FLAT_DTYPES = {pb.INT8: np.int8, pb.INT16: np.int16, pb.INT: np.int32, pb.INT64: np.int64,
+               pb.UINT8: np.uint8, pb.UINT16: np.uint16, pb.UINT: np.uint32, pb.UINT64: np.uint64,
+               pb.FLOAT16: np.float16, pb.FLOAT: np.float32, pb.DOUBLE: np.float64}
+
+# a leaf (Box or Discrete space) of a space compiled into the flat binary
+# format, see OpenGymFlatLeaf. The shape is None for Discrete.
+FlatLeaf = namedtuple('FlatLeaf', ['path', 'dtype', 'shape', 'offset', 'nbytes'])
+
+
+# This class records durations (in ns) into the same buckets as
+# Ns3AiHistogram on the C++ side (8 linear buckets per power of two), so
+# that the step profiles of both sides have the same precision and keys.
+class StepTimer:
+    SUB_BUCKETS = 8
+    MAX_BITS = 40
+    NUM_BUCKETS = (MAX_BITS - 2) * SUB_BUCKETS
+
+    def __init__(self):
+        self.counts = [0] * self.NUM_BUCKETS
+        self.count = 0
+        self.sum = 0
+        self.min = None
+        self.max = 0
+
+    @classmethod
+    def _bucket(cls, ns):
+        if ns < cls.SUB_BUCKETS:
+            return ns
+        msb = ns.bit_length() - 1
+        if msb >= cls.MAX_BITS:
+            return cls.NUM_BUCKETS - 1
+        return (msb - 2) * cls.SUB_BUCKETS + ((ns >> (msb - 3)) & (cls.SUB_BUCKETS - 1))
+
+    @classmethod
+    def _lower_bound(cls, i):
+        if i < cls.SUB_BUCKETS:
+            return i
+        msb = i // cls.SUB_BUCKETS + 2
+        return (cls.SUB_BUCKETS + i % cls.SUB_BUCKETS) << (msb - 3)
+
+    def record(self, ns):
+        self.counts[self._bucket(ns)] += 1
+        self.count += 1
+        self.sum += ns
+        self.min = ns if self.min is None else min(self.min, ns)
+        self.max = max(self.max, ns)
+
+    # approximation of the given percentile (0 to 100), the middle of the
+    # bucket which contains it
+    def percentile(self, percentile):
+        if self.count == 0:
+            return 0
+        rank = int(percentile / 100 * (self.count - 1)) + 1
+        seen = 0
+        for i, count in enumerate(self.counts):
+            seen += count
+            if seen >= rank:
+                mid = (self._lower_bound(i) + self._lower_bound(i + 1)) // 2
+                return min(max(mid, self.min), self.max)
+        return self.max
+
+    # count, total, mean, min, max and usual percentiles (in ns), keyed as
+    # OpenGymStepProfile::ToMap
+    def to_map(self):
+        return {'count': self.count, 'total_ns': self.sum,
+                'mean_ns': self.sum / self.count if self.count else 0,
+                'min_ns': self.min or 0, 'max_ns': self.max,
+                'p50_ns': self.percentile(50), 'p90_ns': self.percentile(90),
+                'p99_ns': self.percentile(99), 'p999_ns': self.percentile(99.9)}
 
 
 class Ns3Env(gym.Env):
-    _created = False
+    # whether steps are batched over agents, see Ns3MultiAgentEnv
+    MULTI_AGENT = False
+    # phases of the steps timed on this side with profile=True: receiving
+    # the state (waiting for ns-3 included), creating the observation,
+    # packing the action, and the agent (from step returning to the next
+    # step call)
+    PROFILE_PHASES = ('rx_env_state', 'create_data', 'pack_data', 'agent')
 
     def _create_space(self, spaceDesc):
         space = None
@@ -22,16 +113,8 @@ class Ns3Env(gym.Env):
             low = boxSpacePb.low
             high = boxSpacePb.high
             shape = tuple(boxSpacePb.shape)
-            mtype = boxSpacePb.dtype
-
-            if mtype == pb.INT:
-                mtype = np.int
-            elif mtype == pb.UINT:
-                mtype = np.uint
-            elif mtype == pb.DOUBLE:
-                mtype = np.float
-            else:
-                mtype = np.float
+            # the dtype of the elements sent by C++
+            mtype = FLAT_DTYPES.get(boxSpacePb.dtype, np.float32)
 
             space = spaces.Box(low=low, high=high, shape=shape, dtype=mtype)
 
@@ -72,17 +155,20 @@ class Ns3Env(gym.Env):
             dataContainerPb.data.Unpack(boxContainerPb)
             # print(boxContainerPb.shape, boxContainerPb.dtype, boxContainerPb.uintData)
 
+            dtype = FLAT_DTYPES.get(boxContainerPb.dtype, np.float32)
             if boxContainerPb.dtype == pb.INT:
                 data = boxContainerPb.intData
             elif boxContainerPb.dtype == pb.UINT:
                 data = boxContainerPb.uintData
             elif boxContainerPb.dtype == pb.DOUBLE:
                 data = boxContainerPb.doubleData
+            elif boxContainerPb.dtype in FLAT_DTYPES and boxContainerPb.dtype != pb.FLOAT:
+                return np.frombuffer(boxContainerPb.rawData, dtype=dtype).copy()
             else:
                 data = boxContainerPb.floatData
 
             # TODO: reshape using shape info
-            data = np.array(data)
+            data = np.array(data, dtype=dtype)
             return data
 
         elif dataContainerPb.type == pb.Tuple:
@@ -109,38 +195,198 @@ class Ns3Env(gym.Env):
             data = myDataDict
             return data
 
-    def initialize_env(self):
-        simInitMsg = pb.SimInitMsg()
+    # receive a message from the C++ side, parsed from shared memory
+    def _recv_msg(self, msg):
         self.msgInterface.PyRecvBegin()
-        request = self.msgInterface.GetCpp2PyStruct().get_buffer()
-        simInitMsg.ParseFromString(request)
+        msg.ParseFromString(self.msgInterface.GetCpp2PyVector().get_buffer())
         self.msgInterface.PyRecvEnd()
 
+    # send a message to the C++ side, the vector grows if the message is
+    # larger than the spaces allow
+    def _send_msg(self, msg):
+        data = msg.SerializeToString()
+        self.msgInterface.PySendBegin()
+        self.msgInterface.ResizePy2CppVector(len(data))
+        self.msgInterface.GetPy2CppVector().get_buffer()[:] = data
+        self.msgInterface.PySendEnd()
+
+    # compile a space description into the flat binary format, as
+    # OpenGymSpace::GetFlatLayout: appends the leaves to layout, and returns
+    # the structure of the samples, with leaf indexes in place of the leaves
+    @staticmethod
+    def _compile_layout(spaceDesc, layout, path=''):
+        if spaceDesc.type in (pb.Discrete, pb.Box):
+            if spaceDesc.type == pb.Discrete:
+                dtype, shape = np.dtype(np.int32), None
+                count = 1
+            else:
+                boxSpacePb = pb.BoxSpace()
+                spaceDesc.space.Unpack(boxSpacePb)
+                dtype = np.dtype(FLAT_DTYPES.get(boxSpacePb.dtype, np.float32))
+                shape = tuple(boxSpacePb.shape)
+                count = int(np.prod(shape))
+            end = layout[-1].offset + layout[-1].nbytes if layout else 0
+            offset = -(-end // dtype.itemsize) * dtype.itemsize
+            layout.append(FlatLeaf(path, dtype, shape, offset, count * dtype.itemsize))
+            return len(layout) - 1
+
+        if spaceDesc.type == pb.Tuple:
+            tupleSpacePb = pb.TupleSpace()
+            spaceDesc.space.Unpack(tupleSpacePb)
+            return tuple(Ns3Env._compile_layout(element, layout, Ns3Env._child_path(path, str(i)))
+                         for i, element in enumerate(tupleSpacePb.element))
+
+        if spaceDesc.type == pb.Dict:
+            dictSpacePb = pb.DictSpace()
+            spaceDesc.space.Unpack(dictSpacePb)
+            # in key order, as sent by C++
+            return {element.name: Ns3Env._compile_layout(element, layout,
+                                                         Ns3Env._child_path(path, element.name))
+                    for element in dictSpacePb.element}
+
+        return None
+
+    @staticmethod
+    def _child_path(path, name):
+        return name if not path else path + '/' + name
+
+    # build a sample from the values of its leaves
+    def _assemble(self, node, values):
+        if isinstance(node, int):
+            return values[node]
+        if isinstance(node, tuple):
+            return tuple(self._assemble(child, values) for child in node)
+        return {name: self._assemble(child, values) for name, child in node.items()}
+
+    # get the values of the leaves of a sample, as flat arrays of the leaf
+    # types. Raises ValueError, KeyError or TypeError if the sample does not
+    # match the space.
+    def _disassemble(self, node, data, layout, values):
+        if isinstance(node, int):
+            value = np.asarray(data, dtype=layout[node].dtype).reshape(-1)
+            if value.nbytes != layout[node].nbytes:
+                raise ValueError('sample does not match leaf ' + layout[node].path)
+            values.append(value)
+        elif isinstance(node, tuple):
+            if len(data) != len(node):
+                raise ValueError('sample does not match the tuple space')
+            for child, subData in zip(node, data):
+                self._disassemble(child, subData, layout, values)
+        else:
+            for name, child in node.items():
+                self._disassemble(child, data[name], layout, values)
+        return values
+
+    # create the observation from data in the flat binary format. The data
+    # is copied out of shared memory once, and the leaves are views of the
+    # copy, also available by path in self.obsLeaves
+    def _create_flat_data(self, buffer, offset, size):
+        if size == 0:
+            self.obsLeaves = {}
+            return None
+        data = np.frombuffer(buffer, np.uint8, size, offset).copy()
+        values = []
+        for leaf in self.obsLayout:
+            value = data[leaf.offset:leaf.offset + leaf.nbytes].view(leaf.dtype)
+            values.append(int(value[0]) if leaf.shape is None else value.reshape(leaf.shape))
+        self.obsLeaves = {leaf.path: value for leaf, value in zip(self.obsLayout, values)}
+        return self._assemble(self.obsTree, values)
+
+    # parse a state in the flat binary format at offset in buffer, returns
+    # the observation, reward, game over flag, reason, extra info, and the
+    # end of the state
+    def _parse_flat_state(self, buffer, offset=0):
+        reward, gameOver, reason, obsFormat, obsSize, infoSize = \
+            STATE_HEADER.unpack_from(buffer, offset)
+        offset += STATE_HEADER.size
+        start = self._now()
+        if obsFormat == PROTOBUF_FORMAT:
+            # the observation does not match the space
+            obsDataPb = pb.DataContainer()
+            obsDataPb.ParseFromString(buffer[offset:offset + obsSize])
+            obs = self._create_data(obsDataPb)
+            self.obsLeaves = None
+        else:
+            obs = self._create_flat_data(buffer, offset, obsSize)
+        self._record('create_data', start)
+        offset += obsSize
+        extraInfo = str(buffer[offset:offset + infoSize], 'utf-8')
+        return obs, reward, bool(gameOver), reason, extraInfo, offset + infoSize
+
+    # encode an action in the flat binary format: returns its format, its
+    # data (leaf arrays, or serialized protobuf if it does not match the
+    # action space) and its size. See _write_flat_action.
+    def _encode_flat_action(self, actions):
+        if actions is None or not self.actLayout:
+            return FLAT_FORMAT, [], 0
+        start = self._now()
+        try:
+            values = self._disassemble(self.actTree, actions, self.actLayout, [])
+            encoded = FLAT_FORMAT, values, self.actLayout[-1].offset + self.actLayout[-1].nbytes
+        except (ValueError, KeyError, TypeError):
+            data = self._pack_data(actions, self.action_space).SerializeToString()
+            encoded = PROTOBUF_FORMAT, data, len(data)
+        self._record('pack_data', start)
+        return encoded
+
+    # write an encoded action (or the stop request) at offset in buffer, the
+    # leaves are written in place. Returns the end of the action.
+    def _write_flat_action(self, buffer, offset, encoded, stopSimReq=False):
+        dataFormat, values, size = encoded
+        ACTION_HEADER.pack_into(buffer, offset, stopSimReq, dataFormat, size)
+        offset += ACTION_HEADER.size
+        if dataFormat == PROTOBUF_FORMAT:
+            buffer[offset:offset + size] = values
+        elif size:
+            data = np.frombuffer(buffer, np.uint8, size, offset)
+            for leaf, value in zip(self.actLayout, values):
+                data[leaf.offset:leaf.offset + leaf.nbytes].view(leaf.dtype)[:] = value
+        return offset + size
+
+    # send an action (or the stop request) in the flat binary format, the
+    # leaves are written in place into shared memory. Actions which do not
+    # match the action space are sent with protobuf.
+    def _send_flat_actions(self, actions, stopSimReq=False):
+        encoded = self._encode_flat_action(None if stopSimReq else actions)
+        self.msgInterface.PySendBegin()
+        self.msgInterface.ResizePy2CppVector(ACTION_HEADER.size + encoded[2])
+        buffer = self.msgInterface.GetPy2CppVector().get_buffer()
+        self._write_flat_action(buffer, 0, encoded, stopSimReq)
+        self.msgInterface.PySendEnd()
+
+    def initialize_env(self):
+        simInitMsg = pb.SimInitMsg()
+        self._recv_msg(simInitMsg)
+
         self.action_space = self._create_space(simInitMsg.actSpace)
         self.observation_space = self._create_space(simInitMsg.obsSpace)
 
+        # steps skip protobuf if C++ offers it, with the same layouts on both sides
+        self.flatSteps = simInitMsg.flatSteps
+        self.obsLayout, self.actLayout = [], []
+        self.obsTree = self._compile_layout(simInitMsg.obsSpace, self.obsLayout)
+        self.actTree = self._compile_layout(simInitMsg.actSpace, self.actLayout)
+
         reply = pb.SimInitAck()
         reply.done = True
         reply.stopSimReq = False
-        reply_str = reply.SerializeToString()
-        assert len(reply_str) <= py_binding.msg_buffer_size
-
-        self.msgInterface.PySendBegin()
-        self.msgInterface.GetPy2CppStruct().size = len(reply_str)
-        self.msgInterface.GetPy2CppStruct().get_buffer_full()[:len(reply_str)] = reply_str
-        self.msgInterface.PySendEnd()
+        reply.flatSteps = self.flatSteps
+        # batched steps need Ns3MultiAgentEnv (the C++ side checks it too)
+        reply.multiAgent = simInitMsg.multiAgent and self.MULTI_AGENT
+        self._send_msg(reply)
+        if simInitMsg.multiAgent and not self.MULTI_AGENT:
+            raise Exception('Error: the simulation registers agents, use Ns3MultiAgentEnv')
+        if self.MULTI_AGENT and not simInitMsg.multiAgent:
+            raise Exception('Error: the simulation does not register agents, use Ns3Env')
         return True
 
     def send_close_command(self):
-        reply = pb.EnvActMsg()
-        reply.stopSimReq = True
-
-        replyMsg = reply.SerializeToString()
-        assert len(replyMsg) <= py_binding.msg_buffer_size
-        self.msgInterface.PySendBegin()
-        self.msgInterface.GetPy2CppStruct().size = len(replyMsg)
-        self.msgInterface.GetPy2CppStruct().get_buffer_full()[:len(replyMsg)] = replyMsg
-        self.msgInterface.PySendEnd()
+        if self.flatSteps:
+            self._send_flat_actions(None, stopSimReq=True)
+        else:
+            reply = pb.EnvActMsg()
+            reply.stopSimReq = True
+            self._send_msg(reply)
 
         self.newStateRx = False
         return True
@@ -149,25 +395,37 @@ class Ns3Env(gym.Env):
         if self.newStateRx:
             return
 
-        envStateMsg = pb.EnvStateMsg()
-        self.msgInterface.PyRecvBegin()
-        request = self.msgInterface.GetCpp2PyStruct().get_buffer()
-        envStateMsg.ParseFromString(request)
-        self.msgInterface.PyRecvEnd()
-
-        self.obsData = self._create_data(envStateMsg.obsData)
-        self.reward = envStateMsg.reward
-        self.gameOver = envStateMsg.isGameOver
-        self.gameOverReason = envStateMsg.reason
+        start = self._now()
+        if self.flatSteps:
+            self.msgInterface.PyRecvBegin()
+            buffer = self.msgInterface.GetCpp2PyVector().get_buffer()
+            self.obsData, reward, gameOver, reason, extraInfo, _ = self._parse_flat_state(buffer)
+            self.msgInterface.PyRecvEnd()
+        else:
+            envStateMsg = pb.EnvStateMsg()
+            self._recv_msg(envStateMsg)
+            createStart = self._now()
+            self.obsData = self._create_data(envStateMsg.obsData)
+            self._record('create_data', createStart)
+            reward = envStateMsg.reward
+            gameOver = envStateMsg.isGameOver
+            reason = envStateMsg.reason
+            extraInfo = envStateMsg.info
+
+        self.reward = reward
+        self.gameOver = bool(gameOver)
+        self.gameOverReason = reason
+        self._record('rx_env_state', start)
 
         if self.gameOver:
             self.send_close_command()
 
-        self.extraInfo = envStateMsg.info
+        self.extraInfo = extraInfo
         if not self.extraInfo:
             self.extraInfo = {}
 
         self.newStateRx = True
+        self._print_profile()
 
     def get_obs(self):
         return self.obsData
@@ -181,6 +439,14 @@ class Ns3Env(gym.Env):
     def get_extra_info(self):
         return self.extraInfo
 
+    # get the dtype sent for the elements of a Box space
+    @staticmethod
+    def _get_pb_dtype(spaceDesc):
+        for pbDtype, dtype in FLAT_DTYPES.items():
+            if spaceDesc.dtype == dtype:
+                return pbDtype
+        return pb.FLOAT
+
     def _pack_data(self, actions, spaceDesc):
         dataContainer = pb.DataContainer()
 
@@ -198,26 +464,23 @@ class Ns3Env(gym.Env):
             shape = [len(actions)]
             boxContainerPb.shape.extend(shape)
 
-            if spaceDesc.dtype in ['int', 'int8', 'int16', 'int32', 'int64']:
-                boxContainerPb.dtype = pb.INT
+            boxContainerPb.dtype = self._get_pb_dtype(spaceDesc)
+            if boxContainerPb.dtype == pb.INT:
                 boxContainerPb.intData.extend(actions)
 
-            elif spaceDesc.dtype in ['uint', 'uint8', 'uint16', 'uint32', 'uint64']:
-                boxContainerPb.dtype = pb.UINT
+            elif boxContainerPb.dtype == pb.UINT:
                 boxContainerPb.uintData.extend(actions)
 
-            elif spaceDesc.dtype in ['float', 'float32', 'float64']:
-                boxContainerPb.dtype = pb.FLOAT
-                boxContainerPb.floatData.extend(actions)
-
-            elif spaceDesc.dtype in ['double']:
-                boxContainerPb.dtype = pb.DOUBLE
+            elif boxContainerPb.dtype == pb.DOUBLE:
                 boxContainerPb.doubleData.extend(actions)
 
-            else:
-                boxContainerPb.dtype = pb.FLOAT
+            elif boxContainerPb.dtype == pb.FLOAT:
                 boxContainerPb.floatData.extend(actions)
 
+            else:
+                dtype = FLAT_DTYPES[boxContainerPb.dtype]
+                boxContainerPb.rawData = np.asarray(actions, dtype=dtype).tobytes()
+
             dataContainer.data.Pack(boxContainerPb)
 
         elif spaceType == spaces.Tuple:
@@ -250,17 +513,18 @@ class Ns3Env(gym.Env):
         return dataContainer
 
     def send_actions(self, actions):
+        if self.flatSteps:
+            self._send_flat_actions(actions)
+            self.newStateRx = False
+            return True
+
         reply = pb.EnvActMsg()
 
+        start = self._now()
         actionMsg = self._pack_data(actions, self.action_space)
         reply.actData.CopyFrom(actionMsg)
-
-        replyMsg = reply.SerializeToString()
-        assert len(replyMsg) <= py_binding.msg_buffer_size
-        self.msgInterface.PySendBegin()
-        self.msgInterface.GetPy2CppStruct().size = len(replyMsg)
-        self.msgInterface.GetPy2CppStruct().get_buffer_full()[:len(replyMsg)] = replyMsg
-        self.msgInterface.PySendEnd()
+        self._record('pack_data', start)
+        self._send_msg(reply)
         self.newStateRx = False
         return True
 
@@ -271,11 +535,23 @@ class Ns3Env(gym.Env):
         extraInfo = {"info": self.get_extra_info()}
         return obs, reward, done, False, extraInfo
 
-    def __init__(self, targetName, ns3Path, ns3Settings=None, shmSize=4096):
-        if self._created:
-            raise Exception('Error: Ns3Env is singleton')
-        self._created = True
-        self.exp = Experiment(targetName, ns3Path, py_binding, shmSize=shmSize)
+    def __init__(self, targetName, ns3Path, ns3Settings=None, shmSize=None,
+                 waitMode="spin", spinBudgetUs=100, stats=False, cpuAffinity=None,
+                 replayLog=None, segName="My Seg", launch=True, snapshot=False,
+                 directLaunch=True, poolSize=0, profile=False):
+        if replayLog is not None:
+            # serve a recorded run instead of starting ns-3
+            self.exp = Replay(replayLog, py_binding, shmSize=shmSize,
+                              useVector=True, vectorSize=0,
+                              waitMode=waitMode, spinBudgetUs=spinBudgetUs, stats=stats,
+                              cpuAffinity=cpuAffinity, segName=segName)
+        else:
+            # messages are byte vectors, sized by the C++ side at Init
+            self.exp = Experiment(targetName, ns3Path, py_binding, shmSize=shmSize,
+                                  useVector=True, vectorSize=0,
+                                  waitMode=waitMode, spinBudgetUs=spinBudgetUs, stats=stats,
+                                  cpuAffinity=cpuAffinity, segName=segName, snapshot=snapshot,
+                                  directLaunch=directLaunch, poolSize=poolSize)
         self.ns3Settings = ns3Settings
 
         self.newStateRx = False
@@ -284,24 +560,35 @@ class Ns3Env(gym.Env):
         self.gameOver = False
         self.gameOverReason = None
         self.extraInfo = None
-
+        self.msgInterface = None
+        self.envDirty = False
+        self.flatSteps = False
+        self.obsLeaves = None
+        # per-phase step timers (see get_profile), None if disabled
+        self.profile = None
+        if profile:
+            self.profile = {name: StepTimer() for name in self.PROFILE_PHASES}
+        self.stepReturn = None
+
+        if launch:
+            self.launch()
+            self.connect()
+
+    # start the simulation, without waiting for it (see connect). With
+    # snapshot, only the first launch starts ns-3, the next ones fork it
+    # at the episode start (see OpenGymInterface::MarkEpisodeStart)
+    def launch(self):
         self.msgInterface = self.exp.run(setting=self.ns3Settings, show_output=True)
+
+    # wait for the started simulation, then get the spaces and the first
+    # observations
+    def connect(self):
         self.initialize_env()
-        # get first observations
         self.rx_env_state()
         self.envDirty = False
 
-    def step(self, actions):
-        self.send_actions(actions)
-        self.rx_env_state()
-        self.envDirty = True
-        return self.get_state()
-
-    def reset(self, seed=None, options=None):
-        if not self.envDirty:
-            obs = self.get_obs()
-            return obs, {}
-
+    # stop the current simulation before launching another one
+    def end_episode(self):
         # not using self.exp.kill() here in order for semaphores to reset to initial state
         if not self.gameOver:
             self.rx_env_state()
@@ -310,20 +597,68 @@ class Ns3Env(gym.Env):
         self.msgInterface = None
         self.newStateRx = False
         self.obsData = None
+        self.obsLeaves = None
         self.reward = 0
         self.gameOver = False
         self.gameOverReason = None
         self.extraInfo = None
 
-        self.msgInterface = self.exp.run(show_output=True)
-        self.initialize_env()
-        # get first observations
+    def step(self, actions):
+        self._record('agent', self.stepReturn)
+        self.send_actions(actions)
         self.rx_env_state()
-        self.envDirty = False
+        self.envDirty = True
+        state = self.get_state()
+        self.stepReturn = self._now()
+        return state
+
+    def reset(self, seed=None, options=None):
+        self.stepReturn = None
+        if not self.envDirty:
+            obs = self.get_obs()
+            return obs, {}
+
+        self.end_episode()
+        self.launch()
+        self.connect()
 
         obs = self.get_obs()
         return obs, {}
 
+    # get the step profile (None if disabled): the summaries of the timers
+    # of PROFILE_PHASES, as OpenGymStepProfile::ToMap on the C++ side (which
+    # prints its own at the end of the simulation), and the channel
+    # statistics if enabled (see Experiment.get_stats)
+    def get_profile(self):
+        if self.profile is None:
+            return None
+        report = {name: timer.to_map() for name, timer in self.profile.items()}
+        stats = self.exp.get_stats()
+        if stats is not None:
+            report['channel'] = stats
+        return report
+
+    def _now(self):
+        return time.perf_counter_ns() if self.profile is not None else None
+
+    # record the time since start (from _now) into the timer of a phase
+    def _record(self, name, start):
+        if start is not None and self.profile is not None:
+            self.profile[name].record(time.perf_counter_ns() - start)
+
+    # print the step profile when the simulation has ended, as the C++ side
+    def _print_profile(self):
+        if self.profile is None or not self.gameOver or \
+                self.gameOverReason != pb.EnvStateMsg.SimulationEnd:
+            return
+        print('ns3-ai gym python step profile:')
+        for name, summary in self.profile.items():
+            summary = summary.to_map()
+            print('  {}: count {} total_ms {:g} mean_us {:g} p50_us {:g} p99_us {:g} max_us {:g}'
+                  .format(name, summary['count'], summary['total_ns'] / 1e6,
+                          summary['mean_ns'] / 1000, summary['p50_ns'] / 1000,
+                          summary['p99_ns'] / 1000, summary['max_ns'] / 1000))
+
     def render(self, mode='human'):
         return
 
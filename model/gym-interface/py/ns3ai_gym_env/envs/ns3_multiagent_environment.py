@@ -0,0 +1,125 @@
+import numpy as np
+from gymnasium.vector.utils import batch_space, concatenate, create_empty_array, iterate
+import messages_pb2 as pb
+from ns3ai_gym_env.envs.ns3_environment import Ns3Env, BATCH_HEADER, AGENT_HEADER, ACTION_HEADER
+
+
+# This class runs an ns-3 simulation with several agents, registered in C++
+# with OpenGymInterface::RegisterAgent (e.g., one per node, flow or BSS).
+# The agents which notify within one batch window cross to Python in one
+# message, and their actions go back in one message.
+#
+# It follows the PettingZoo parallel API: reset returns the observations
+# and infos, and step takes the actions and returns the observations,
+# rewards, terminations, truncations and infos, all keyed by agent ID. Only
+# the agents of the last batch are present (in self.agents), and an agent
+# missing from the actions keeps its previous action. With stacked=True,
+# they are arrays stacked in the order of self.agents instead (infos is then
+# a dict with the "agents" and their "info").
+class Ns3MultiAgentEnv(Ns3Env):
+    MULTI_AGENT = True
+
+    # \param[in] stacked : whether observations and actions are stacked
+    #                      arrays instead of dicts keyed by agent ID
+    # other parameters : as in Ns3Env
+    def __init__(self, targetName, ns3Path, ns3Settings=None, stacked=False, **kwargs):
+        self.stacked = stacked
+        self.agents = []
+        self.agentStates = {}
+        super().__init__(targetName, ns3Path, ns3Settings=ns3Settings, **kwargs)
+
+    def send_close_command(self):
+        self.msgInterface.PySendBegin()
+        self.msgInterface.ResizePy2CppVector(BATCH_HEADER.size)
+        BATCH_HEADER.pack_into(self.msgInterface.GetPy2CppVector().get_buffer(), 0, 0, True)
+        self.msgInterface.PySendEnd()
+
+        self.newStateRx = False
+        return True
+
+    def rx_env_state(self):
+        if self.newStateRx:
+            return
+
+        start = self._now()
+        self.msgInterface.PyRecvBegin()
+        buffer = self.msgInterface.GetCpp2PyVector().get_buffer()
+        numAgents, _ = BATCH_HEADER.unpack_from(buffer)
+        offset = BATCH_HEADER.size
+        self.agents = []
+        self.agentStates = {}
+        for _ in range(numAgents):
+            offset = self._align_record(offset)
+            agentId, size = AGENT_HEADER.unpack_from(buffer, offset)
+            offset += AGENT_HEADER.size
+            self.agentStates[agentId] = self._parse_flat_state(buffer, offset)[:5]
+            self.agents.append(agentId)
+            offset += size
+        self.msgInterface.PyRecvEnd()
+        self._record('rx_env_state', start)
+
+        # the simulation has ended, the agents are only game over
+        self.gameOver = any(state[2] and state[3] == pb.EnvStateMsg.SimulationEnd
+                            for state in self.agentStates.values())
+        self.gameOverReason = pb.EnvStateMsg.SimulationEnd if self.gameOver else None
+        if self.gameOver:
+            self.send_close_command()
+
+        self.newStateRx = True
+        self._print_profile()
+
+    def send_actions(self, actions):
+        if self.stacked:
+            actionSpace = batch_space(self.action_space, len(self.agents))
+            items = list(zip(self.agents, iterate(actionSpace, actions)))
+        else:
+            items = [(agentId, actions[agentId]) for agentId in self.agents if agentId in actions]
+        encoded = [(agentId, self._encode_flat_action(action)) for agentId, action in items]
+
+        offsets = []
+        end = BATCH_HEADER.size
+        for _, action in encoded:
+            offsets.append(self._align_record(end))
+            end = offsets[-1] + AGENT_HEADER.size + ACTION_HEADER.size + action[2]
+
+        self.msgInterface.PySendBegin()
+        self.msgInterface.ResizePy2CppVector(end)
+        buffer = self.msgInterface.GetPy2CppVector().get_buffer()
+        BATCH_HEADER.pack_into(buffer, 0, len(encoded), False)
+        for offset, (agentId, action) in zip(offsets, encoded):
+            AGENT_HEADER.pack_into(buffer, offset, agentId, ACTION_HEADER.size + action[2])
+            self._write_flat_action(buffer, offset + AGENT_HEADER.size, action)
+        self.msgInterface.PySendEnd()
+        self.newStateRx = False
+        return True
+
+    def get_obs(self):
+        obs = [self.agentStates[agentId][0] for agentId in self.agents]
+        if self.stacked:
+            out = create_empty_array(self.observation_space, len(obs))
+            return concatenate(self.observation_space, obs, out)
+        return dict(zip(self.agents, obs))
+
+    def get_state(self):
+        states = [self.agentStates[agentId] for agentId in self.agents]
+        rewards = [state[1] for state in states]
+        terminations = [state[2] for state in states]
+        infos = [{"info": state[4]} for state in states]
+        if self.stacked:
+            return (self.get_obs(), np.array(rewards, dtype=np.float32),
+                    np.array(terminations, dtype=np.bool_), np.zeros(len(states), dtype=np.bool_),
+                    {"agents": np.array(self.agents), "info": [info["info"] for info in infos]})
+        return (self.get_obs(), dict(zip(self.agents, rewards)),
+                dict(zip(self.agents, terminations)), {agentId: False for agentId in self.agents},
+                dict(zip(self.agents, infos)))
+
+    def reset(self, seed=None, options=None):
+        obs, _ = super().reset(seed=seed, options=options)
+        if self.stacked:
+            return obs, {"agents": np.array(self.agents)}
+        return obs, {agentId: {} for agentId in self.agents}
+
+    # records of a batch start at multiples of 8 bytes
+    @staticmethod
+    def _align_record(offset):
+        return -(-offset // 8) * 8
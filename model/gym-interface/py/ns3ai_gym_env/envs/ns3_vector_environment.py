@@ -0,0 +1,96 @@
+import os
+from copy import deepcopy
+import numpy as np
+from gymnasium.vector import AutoresetMode, VectorEnv
+from gymnasium.vector.utils import batch_space, concatenate, create_empty_array, iterate
+from ns3ai_gym_env.envs.ns3_environment import Ns3Env
+
+
+# This class runs num_envs ns-3 simulations of the same program at once, each
+# with its own segment, and batches their observations, rewards and flags.
+# A step sends the actions to all simulations before waiting for any of
+# them, so that they simulate concurrently. A simulation whose episode is
+# over is relaunched within the same step (its last observation and info are
+# in infos["final_obs"] and infos["final_info"]).
+class Ns3VectorEnv(VectorEnv):
+    metadata = {"autoreset_mode": AutoresetMode.SAME_STEP}
+
+    # \param[in] num_envs : number of simulations
+    # \param[in] targetName, ns3Path, ns3Settings : as in Ns3Env, the same
+    #                                               for all simulations
+    # \param[in] segNamePrefix : the segment names are
+    #                            "<prefix>-<pid>-<index>", unique per process
+    # \param[in] waitMode : as in Ns3Env, "spin_then_sleep" by default so
+    #                       that the waiting simulations do not keep the
+    #                       cores busy
+    # other parameters : as in Ns3Env, passed to every simulation
+    #                    (cpuAffinity and replayLog are not supported)
+    def __init__(self, num_envs, targetName, ns3Path, ns3Settings=None,
+                 segNamePrefix="ns3ai-vec", waitMode="spin_then_sleep", **kwargs):
+        if kwargs.get('cpuAffinity') is not None or kwargs.get('replayLog') is not None:
+            raise Exception('Error: Ns3VectorEnv does not support cpuAffinity or replayLog')
+        self.num_envs = num_envs
+        self.envs = [Ns3Env(targetName, ns3Path, ns3Settings=ns3Settings, waitMode=waitMode,
+                            segName='{}-{}-{}'.format(segNamePrefix, os.getpid(), i),
+                            launch=False, **kwargs)
+                     for i in range(num_envs)]
+        # start all the simulations before waiting for them
+        for env in self.envs:
+            env.launch()
+        for env in self.envs:
+            env.connect()
+
+        self.single_observation_space = self.envs[0].observation_space
+        self.single_action_space = self.envs[0].action_space
+        for env in self.envs[1:]:
+            if (env.observation_space != self.single_observation_space or
+                    env.action_space != self.single_action_space):
+                raise Exception('Error: Ns3VectorEnv simulations have different spaces')
+        self.observation_space = batch_space(self.single_observation_space, num_envs)
+        self.action_space = batch_space(self.single_action_space, num_envs)
+
+        self._observations = create_empty_array(self.single_observation_space, num_envs)
+        self._rewards = np.zeros(num_envs, dtype=np.float64)
+        self._terminations = np.zeros(num_envs, dtype=np.bool_)
+        self._truncations = np.zeros(num_envs, dtype=np.bool_)
+
+    def reset(self, *, seed=None, options=None):
+        super().reset(seed=seed)
+        dirty = [env for env in self.envs if env.envDirty]
+        self._relaunch(dirty)
+        return self._batch_obs(), {}
+
+    def step(self, actions):
+        for env, action in zip(self.envs, iterate(self.action_space, actions)):
+            env.send_actions(action)
+        infos = {}
+        done = []
+        for i, env in enumerate(self.envs):
+            env.rx_env_state()
+            env.envDirty = True
+            _, self._rewards[i], self._terminations[i], self._truncations[i], info = \
+                env.get_state()
+            if self._terminations[i] or self._truncations[i]:
+                infos = self._add_info(infos, {"final_obs": env.get_obs(), "final_info": info}, i)
+                done.append(env)
+            infos = self._add_info(infos, info, i)
+        self._relaunch(done)
+        return (self._batch_obs(), np.copy(self._rewards), np.copy(self._terminations),
+                np.copy(self._truncations), infos)
+
+    def close_extras(self, **kwargs):
+        for env in self.envs:
+            env.close()
+
+    # start new episodes, launching all the simulations before waiting for them
+    def _relaunch(self, envs):
+        for env in envs:
+            env.end_episode()
+            env.launch()
+        for env in envs:
+            env.connect()
+
+    def _batch_obs(self):
+        self._observations = concatenate(self.single_observation_space,
+                                         [env.get_obs() for env in self.envs], self._observations)
+        return deepcopy(self._observations)
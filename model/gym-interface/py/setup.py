@@ -21,5 +21,5 @@ from setuptools import setup
 setup(
     name="ns3ai_gym_env",
     version="0.0.1",
-    install_requires=["numpy", "gymnasium", "protobuf==3.20.3"],
+    install_requires=["numpy", "gymnasium>=1.1", "protobuf==3.20.3"],
 )
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:  Muyuan Shen <muyuan_shen@hust.edu.cn>
+ */
+
+#ifndef NS3_AI_LAUNCH_PY_H
+#define NS3_AI_LAUNCH_PY_H
+
+// Helper for Python binding modules only, see ns3-ai-msg-numpy.h
+
+#include <ns3/ns3-ai-launch.h>
+
+#include <pybind11/pybind11.h>
+
+namespace ns3
+{
+
+/**
+ * Binds Ns3AiLauncher to Python as "Ns3AiLauncher", so that Experiment
+ * detects when the simulation is ready instead of sleeping, and can keep
+ * a pool of parked simulations (its poolSize parameter). Any binding
+ * module can expose it.
+ *
+ * \param m the module
+ */
+inline void
+Ns3AiBindLaunch(pybind11::module_& m)
+{
+    namespace py = pybind11;
+
+    py::class_<Ns3AiLauncher>(m, "Ns3AiLauncher")
+        .def(py::init<const std::string&>())
+        .def("GetParked", &Ns3AiLauncher::GetParked)
+        .def("Start", &Ns3AiLauncher::Start, py::call_guard<py::gil_scoped_release>());
+}
+
+} // namespace ns3
+
+#endif // NS3_AI_LAUNCH_PY_H
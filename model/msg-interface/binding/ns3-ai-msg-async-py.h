@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:  Muyuan Shen <muyuan_shen@hust.edu.cn>
+ */
+
+#ifndef NS3_AI_MSG_ASYNC_PY_H
+#define NS3_AI_MSG_ASYNC_PY_H
+
+// Helper for Python binding modules only, see ns3-ai-msg-numpy.h
+
+#include <ns3/ns3-ai-msg-async.h>
+#include <ns3/ns3-ai-msg-interface.h>
+
+#include <pybind11/pybind11.h>
+
+namespace ns3
+{
+
+/**
+ * Binds Ns3AiMsgAsyncWaiter to Python as "Ns3AiMsgAsyncWaiter", for the
+ * interface of this module's message types, so that python_utils.AsyncChannel
+ * can await its messages. The waiter keeps the interface alive.
+ *
+ * \param m the module
+ */
+template <typename Cpp2PyMsgType, typename Py2CppMsgType>
+void
+Ns3AiBindMsgAsync(pybind11::module_& m)
+{
+    namespace py = pybind11;
+    typedef Ns3AiMsgInterfaceImpl<Cpp2PyMsgType, Py2CppMsgType> Interface;
+    typedef Ns3AiMsgAsyncWaiter<Interface> Waiter;
+
+    py::class_<Waiter>(m, "Ns3AiMsgAsyncWaiter")
+        .def(py::init<Interface*>(), py::keep_alive<1, 2>())
+        .def("GetFd", &Waiter::GetFd)
+        .def("StartRecvBegin", [](Waiter& waiter) { waiter.Start(Waiter::RECV_BEGIN); })
+        .def("StartSendBegin", [](Waiter& waiter) { waiter.Start(Waiter::SEND_BEGIN); })
+        .def("Collect", &Waiter::Collect)
+        .def("Cancel", &Waiter::Cancel, py::call_guard<py::gil_scoped_release>());
+}
+
+} // namespace ns3
+
+#endif // NS3_AI_MSG_ASYNC_PY_H
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:  Muyuan Shen <muyuan_shen@hust.edu.cn>
+ */
+
+#ifndef NS3_AI_MSG_NUMPY_H
+#define NS3_AI_MSG_NUMPY_H
+
+// Helpers for Python binding modules only: this header needs pybind11, so
+// it is not part of ai-module.h. Binding targets get its directory through
+// ${NS3AI_BINDING_INCLUDE_DIR}.
+
+#include <ns3/ns3-ai-msg-interface.h>
+
+#include <cstdint>
+#include <iostream>
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+
+namespace ns3
+{
+
+/**
+ * Gets the address of the first element of a vector in shared memory
+ * (nullptr if it is empty), without going through the offset pointer
+ * at each access
+ */
+template <typename VectorType>
+typename VectorType::value_type*
+Ns3AiVectorData(VectorType& vec)
+{
+    return vec.empty() ? nullptr : &vec[0];
+}
+
+/**
+ * Binds a Cpp2PyMsgVector or Py2CppMsgVector to Python. Besides len and
+ * per-element access, the vector supports the buffer protocol and
+ * as_numpy(), which return a NumPy structured array viewing the elements
+ * in shared memory (no copy). It has no resize: the binding must expose
+ * the interface's ResizeCpp2PyVector and ResizePy2CppVector, which lock
+ * and grow the segment. The element type must have its
+ * dtype registered with PYBIND11_NUMPY_DTYPE (or PYBIND11_NUMPY_DTYPE_EX
+ * to use the same field names as the element bindings).
+ *
+ * Writes to the array go directly to shared memory. The array is only
+ * valid until the vector is resized.
+ *
+ * \param m the module
+ * \param name Python name of the vector class
+ */
+template <typename VectorType>
+pybind11::class_<VectorType>
+Ns3AiBindMsgVector(pybind11::module_& m, const char* name)
+{
+    namespace py = pybind11;
+    typedef typename VectorType::value_type T;
+
+    return py::class_<VectorType>(m, name, py::buffer_protocol())
+        .def("__len__", &VectorType::size)
+        .def(
+            "__getitem__",
+            [](VectorType& vec, uint32_t i) -> T& {
+                if (i >= vec.size())
+                {
+                    std::cerr << "Invalid index " << i << " for vector, whose size is "
+                              << vec.size() << std::endl;
+                    exit(1);
+                }
+                return vec.at(i);
+            },
+            py::return_value_policy::reference)
+        .def_buffer([](VectorType& vec) {
+            return py::buffer_info(Ns3AiVectorData(vec),
+                                   sizeof(T),
+                                   py::format_descriptor<T>::format(),
+                                   1,
+                                   {static_cast<py::ssize_t>(vec.size())},
+                                   {static_cast<py::ssize_t>(sizeof(T))});
+        })
+        .def("as_numpy", [](py::object self) {
+            VectorType& vec = self.cast<VectorType&>();
+            // the vector object is the base of the array, so the data is not copied
+            return py::array_t<T>({static_cast<py::ssize_t>(vec.size())},
+                                  {static_cast<py::ssize_t>(sizeof(T))},
+                                  Ns3AiVectorData(vec),
+                                  self);
+        });
+}
+
+} // namespace ns3
+
+#endif // NS3_AI_MSG_NUMPY_H
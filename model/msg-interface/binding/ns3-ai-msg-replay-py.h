@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:  Muyuan Shen <muyuan_shen@hust.edu.cn>
+ */
+
+#ifndef NS3_AI_MSG_REPLAY_PY_H
+#define NS3_AI_MSG_REPLAY_PY_H
+
+// Helper for Python binding modules only, see ns3-ai-msg-numpy.h
+
+#include <ns3/ns3-ai-msg-replay.h>
+
+#include <pybind11/pybind11.h>
+
+namespace ns3
+{
+
+/**
+ * Binds Ns3AiMsgReplayer to Python as "Ns3AiMsgReplayer", so that
+ * python_utils.Replay can serve a message log to the Python side of this
+ * module's message types without the simulation.
+ *
+ * \param m the module
+ */
+template <typename Cpp2PyMsgType, typename Py2CppMsgType>
+void
+Ns3AiBindMsgReplayer(pybind11::module_& m)
+{
+    namespace py = pybind11;
+    typedef Ns3AiMsgReplayer<Cpp2PyMsgType, Py2CppMsgType> Replayer;
+
+    py::class_<Replayer>(m, "Ns3AiMsgReplayer")
+        .def(py::init<const std::string&,
+                      bool,
+                      bool,
+                      const char*,
+                      const char*,
+                      const char*,
+                      const char*>())
+        .def("Start", &Replayer::Start)
+        .def("IsFinished", &Replayer::IsFinished)
+        .def("GetNumMessages", &Replayer::GetNumMessages);
+}
+
+} // namespace ns3
+
+#endif // NS3_AI_MSG_REPLAY_PY_H
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:  Muyuan Shen <muyuan_shen@hust.edu.cn>
+ */
+
+#ifndef NS3_AI_SNAPSHOT_PY_H
+#define NS3_AI_SNAPSHOT_PY_H
+
+// Helper for Python binding modules only, see ns3-ai-msg-numpy.h
+
+#include <ns3/ns3-ai-snapshot.h>
+
+#include <pybind11/pybind11.h>
+
+namespace ns3
+{
+
+/**
+ * Binds Ns3AiSnapshotClient to Python as "Ns3AiSnapshotClient", so that
+ * Experiment can start episodes from a snapshot (its snapshot parameter).
+ * Its message type does not depend on the module's, so any binding module
+ * can expose it.
+ *
+ * \param m the module
+ */
+inline void
+Ns3AiBindSnapshot(pybind11::module_& m)
+{
+    namespace py = pybind11;
+
+    py::class_<Ns3AiSnapshotClient>(m, "Ns3AiSnapshotClient")
+        .def(py::init<const std::string&>())
+        .def("WaitReady",
+             &Ns3AiSnapshotClient::WaitReady,
+             py::call_guard<py::gil_scoped_release>())
+        .def("Fork", &Ns3AiSnapshotClient::Fork, py::call_guard<py::gil_scoped_release>())
+        .def("Exit", &Ns3AiSnapshotClient::Exit, py::call_guard<py::gil_scoped_release>());
+}
+
+} // namespace ns3
+
+#endif // NS3_AI_SNAPSHOT_PY_H
@@ -0,0 +1,266 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:  Muyuan Shen <muyuan_shen@hust.edu.cn>
+ */
+
+#include "ns3-ai-embedded.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#ifdef NS3AI_EMBEDDED_PYTHON
+#include <pybind11/embed.h>
+
+namespace py = pybind11;
+#endif
+
+namespace ns3
+{
+
+namespace
+{
+
+/**
+ * State of the embedded script, shared with its thread
+ */
+struct EmbeddedState
+{
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_started{false};
+    bool m_ready{false};
+    bool m_ended{false};
+    std::string m_error;
+    std::thread m_thread;
+};
+
+EmbeddedState&
+GetState()
+{
+    static EmbeddedState* state = new EmbeddedState; // never destroyed, see Join
+    return *state;
+}
+
+} // namespace
+
+#ifdef NS3AI_EMBEDDED_PYTHON
+
+/**
+ * The handlers registered by the script, by lockable name. Guarded by the
+ * state's mutex, and the GIL is needed to change them.
+ */
+static std::map<std::string, py::object>&
+GetHandlers()
+{
+    static auto* handlers = new std::map<std::string, py::object>; // see GetState
+    return *handlers;
+}
+
+// imported by ns3ai_utils to detect that it runs embedded
+PYBIND11_EMBEDDED_MODULE(ns3ai_embedded, m)
+{
+    m.def("ready", []() {
+        EmbeddedState& state = GetState();
+        std::lock_guard<std::mutex> lock(state.m_mutex);
+        state.m_ready = true;
+        state.m_cv.notify_all();
+    });
+    // before ready, for the channels to find their handler
+    m.def("set_handler", [](const std::string& lockableName, py::object handler) {
+        EmbeddedState& state = GetState();
+        std::lock_guard<std::mutex> lock(state.m_mutex);
+        GetHandlers()[lockableName] = handler;
+    });
+}
+
+static void
+RunScript(std::string script, std::vector<std::string> args)
+{
+    EmbeddedState& state = GetState();
+    std::string error;
+    {
+        py::gil_scoped_acquire gil;
+        try
+        {
+            py::module_ sys = py::module_::import("sys");
+            py::list argv;
+            argv.append(script);
+            for (const auto& arg : args)
+            {
+                argv.append(arg);
+            }
+            sys.attr("argv") = argv;
+            // as if run by "python script": its directory comes first in the path
+            py::object dirname = py::module_::import("os.path").attr("dirname");
+            py::object abspath = py::module_::import("os.path").attr("abspath");
+            sys.attr("path").attr("insert")(0, dirname(abspath(script)));
+
+            py::dict globals;
+            globals["__name__"] = "__main__";
+            globals["__file__"] = script;
+            globals["__builtins__"] = py::module_::import("builtins");
+            py::eval_file(script, globals);
+        }
+        catch (py::error_already_set& e)
+        {
+            // exit() in the script is a normal end
+            if (!e.matches(PyExc_SystemExit))
+            {
+                error = e.what();
+            }
+        }
+        catch (const std::exception& e)
+        {
+            error = e.what();
+        }
+        try
+        {
+            py::module_ sys = py::module_::import("sys");
+            sys.attr("stdout").attr("flush")();
+            sys.attr("stderr").attr("flush")();
+        }
+        catch (py::error_already_set&)
+        {
+        }
+    }
+    if (!error.empty())
+    {
+        std::cerr << "ns3-ai: embedded script " << script << " failed: " << error << std::endl;
+    }
+    std::lock_guard<std::mutex> lock(state.m_mutex);
+    state.m_ended = true;
+    state.m_error = error;
+    state.m_cv.notify_all();
+}
+
+#endif
+
+void
+Ns3AiEmbeddedPython::Start(const std::string& script, const std::vector<std::string>& args)
+{
+#ifdef NS3AI_EMBEDDED_PYTHON
+    EmbeddedState& state = GetState();
+    std::unique_lock<std::mutex> lock(state.m_mutex);
+    if (state.m_started)
+    {
+        throw std::runtime_error("ns3-ai: an embedded script is already started");
+    }
+    state.m_started = true;
+    // the script thread takes the GIL, this thread does not run Python
+    py::initialize_interpreter();
+    PyEval_SaveThread();
+    state.m_thread = std::thread(RunScript, script, args);
+    state.m_cv.wait(lock, [&state]() { return state.m_ready || state.m_ended; });
+    if (!state.m_ready)
+    {
+        throw std::runtime_error("ns3-ai: embedded script " + script +
+                                 " ended before creating the message interface" +
+                                 (state.m_error.empty() ? "" : ": " + state.m_error));
+    }
+#else
+    (void)args;
+    throw std::runtime_error("ns3-ai: cannot run " + script +
+                             " embedded, ns3-ai was built without NS3AI_EMBEDDED_PYTHON");
+#endif
+}
+
+bool
+Ns3AiEmbeddedPython::IsStarted()
+{
+    EmbeddedState& state = GetState();
+    std::lock_guard<std::mutex> lock(state.m_mutex);
+    return state.m_started;
+}
+
+void
+Ns3AiEmbeddedPython::Join(uint32_t timeoutMs)
+{
+    EmbeddedState& state = GetState();
+    std::unique_lock<std::mutex> lock(state.m_mutex);
+    if (!state.m_thread.joinable())
+    {
+        return;
+    }
+    bool ended = state.m_cv.wait_for(lock, std::chrono::milliseconds(timeoutMs), [&state]() {
+        return state.m_ended;
+    });
+    lock.unlock();
+    if (ended)
+    {
+        state.m_thread.join();
+#ifdef NS3AI_EMBEDDED_PYTHON
+        // the Python side's channels (and their segment) are released
+        py::gil_scoped_acquire gil;
+        lock.lock();
+        GetHandlers().clear();
+#endif
+    }
+    else
+    {
+        // the process exits anyway; the interpreter is not finalized
+        std::cerr << "ns3-ai: embedded script did not end, leaving it" << std::endl;
+        state.m_thread.detach();
+    }
+}
+
+std::function<void()>
+Ns3AiEmbeddedPython::GetHandler(const std::string& lockableName)
+{
+#ifdef NS3AI_EMBEDDED_PYTHON
+    EmbeddedState& state = GetState();
+    std::lock_guard<std::mutex> lock(state.m_mutex);
+    auto it = GetHandlers().find(lockableName);
+    if (it == GetHandlers().end())
+    {
+        return {};
+    }
+    // the handlers are not moved in the map, and stay until Join
+    const py::object* handler = &it->second;
+    return [handler, lockableName]() {
+        py::gil_scoped_acquire gil;
+        try
+        {
+            (*handler)();
+        }
+        catch (py::error_already_set& e)
+        {
+            throw std::runtime_error("ns3-ai: embedded handler of '" + lockableName +
+                                     "' failed: " + e.what());
+        }
+    };
+#else
+    (void)lockableName;
+    return {};
+#endif
+}
+
+bool
+Ns3AiEmbeddedPython::IsAvailable()
+{
+#ifdef NS3AI_EMBEDDED_PYTHON
+    return true;
+#else
+    return false;
+#endif
+}
+
+} // namespace ns3
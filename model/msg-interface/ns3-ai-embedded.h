@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:  Muyuan Shen <muyuan_shen@hust.edu.cn>
+ */
+
+#ifndef NS3_AI_EMBEDDED_H
+#define NS3_AI_EMBEDDED_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \brief Runs the Python side in the simulation's process, with an
+ * embedded interpreter, instead of in a separate Python process.
+ *
+ * The script is the usual Python side of an example: ns3ai_utils detects
+ * that it is embedded, so Experiment does not launch ns-3 but signals that
+ * the message interfaces are created. The script runs in a thread of this
+ * process and the two sides still use the shared segment and semaphores,
+ * so the C++ and Python APIs are unchanged; there is no second process to
+ * start, but each message still switches between the two threads.
+ *
+ * A script can instead register a handler per channel before creating the
+ * interfaces (Experiment.set_handler) and end: CppSendEnd then calls the
+ * handler on the simulation's thread, which receives the message and
+ * replies before CppRecvBegin, so no message waits for the other thread.
+ *
+ * Needs ns3-ai built with NS3AI_EMBEDDED_PYTHON=ON, which links libpython.
+ * Normally used through Ns3AiMsgInterface::SetEmbeddedScript or the
+ * NS3AI_EMBEDDED_SCRIPT environment variable.
+ */
+class Ns3AiEmbeddedPython
+{
+  public:
+    /**
+     * Starts the interpreter and runs the script in a new thread, with
+     * sys.argv = [script] + args. Returns once the script has created the
+     * message interfaces (Experiment.run). Throws if the script ends or
+     * fails before, or if embedding is not built.
+     */
+    static void Start(const std::string& script, const std::vector<std::string>& args = {});
+
+    /**
+     * Gets whether a script was started
+     */
+    static bool IsStarted();
+
+    /**
+     * Waits at most timeoutMs milliseconds for the script to end, e.g.
+     * after the simulation has sent its finish message
+     */
+    static void Join(uint32_t timeoutMs);
+
+    /**
+     * Gets a function which calls the handler registered by the script for
+     * the channel whose lockable object is named lockableName, holding the
+     * GIL, or an empty function if there is none. Throws if the handler
+     * raises an exception. Handlers are released by Join.
+     */
+    static std::function<void()> GetHandler(const std::string& lockableName);
+
+    /**
+     * Gets whether ns3-ai was built with NS3AI_EMBEDDED_PYTHON
+     */
+    static bool IsAvailable();
+};
+
+} // namespace ns3
+
+#endif // NS3_AI_EMBEDDED_H
@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:  Muyuan Shen <muyuan_shen@hust.edu.cn>
+ */
+
+#ifndef NS3_AI_LAUNCH_H
+#define NS3_AI_LAUNCH_H
+
+#include "ns3-ai-segment.h"
+#include "ns3-ai-semaphore.h"
+#include "ns3-ai-socket.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+namespace ns3
+{
+
+/**
+ * \brief Handshake between the Python side and the simulation processes it
+ * launches, in the shared segment
+ */
+struct Ns3AiLaunchSync
+{
+    volatile uint32_t m_parked{0};  //!< processes which reached the handshake
+    volatile uint32_t m_started{0}; //!< processes which went on
+    volatile int32_t m_startedPid{0};
+    volatile uint8_t m_go{0}; //!< semaphore, posted to let one process go on
+    Ns3AiFutex m_goFutex;
+};
+
+/**
+ * \brief Simulation processes parked until the Python side needs them.
+ *
+ * A process launched by Experiment (with NS3AI_LAUNCH_HANDSHAKE=1 in its
+ * environment) parks when it creates its first channel: its setup is done,
+ * and it has attached to the segment. It tells Python that it is ready, so
+ * that Python does not have to guess when an early crash would have
+ * happened, and waits there until Python lets it go on. Python can keep a
+ * pool of such processes, so that the next episode starts at once.
+ */
+class Ns3AiLaunch
+{
+  public:
+    static constexpr const char* SYNC_NAME = "ns3ai-launch";
+
+    /**
+     * C++ side: parks the process, if it was launched with the handshake
+     * and the segment has a launcher. Called by Ns3AiMsgInterface.
+     */
+    static void Park(const std::string& segmentName)
+    {
+        static bool parked = false;
+        const char* enabled = std::getenv("NS3AI_LAUNCH_HANDSHAKE");
+        if (parked || !enabled || std::string(enabled) != "1" ||
+            Ns3AiSocket::IsAddress(segmentName))
+        {
+            return;
+        }
+        parked = true;
+        std::shared_ptr<Ns3AiSegment> segment = Ns3AiSegment::Open(segmentName, false, 0);
+        Ns3AiLaunchSync* sync;
+        {
+            Ns3AiSegment::Lock lock = segment->LockSegment();
+            sync = segment->Get()->find<Ns3AiLaunchSync>(SYNC_NAME).first;
+        }
+        if (!sync)
+        {
+            return;
+        }
+        __sync_fetch_and_add(const_cast<uint32_t*>(&sync->m_parked), 1);
+        // parked processes may wait for long, do not keep a core busy
+        Ns3AiWaitStats stats;
+        Ns3AiSemaphore::sem_wait(&sync->m_go,
+                                 &sync->m_goFutex,
+                                 Ns3AiSemaphore::SPIN_THEN_SLEEP,
+                                 Ns3AiSemaphore::DEFAULT_SPIN_BUDGET_US,
+                                 &stats);
+        sync->m_startedPid = getpid();
+        __sync_fetch_and_add(const_cast<uint32_t*>(&sync->m_started), 1);
+    };
+};
+
+/**
+ * \brief Python side of the handshake, used by Experiment. Its counters
+ * start from zero, so create a new launcher after killing parked
+ * processes.
+ */
+class Ns3AiLauncher
+{
+  public:
+    explicit Ns3AiLauncher(const std::string& segmentName)
+        : m_segment(Ns3AiSegment::Open(segmentName, true, Ns3AiSegment::GetSegmentSize(GetBytes())))
+    {
+        Ns3AiSegment::Lock lock = m_segment->LockSegment();
+        m_segment->Reserve(GetBytes());
+        m_segment->Get()->construct<Ns3AiLaunchSync>(Ns3AiLaunch::SYNC_NAME)();
+    }
+
+    ~Ns3AiLauncher()
+    {
+        Ns3AiSegment::Lock lock = m_segment->LockSegment();
+        m_segment->Get()->destroy<Ns3AiLaunchSync>(Ns3AiLaunch::SYNC_NAME);
+    }
+
+    /**
+     * Gets the number of parked processes, which Start can let go on
+     */
+    uint32_t GetParked()
+    {
+        Ns3AiLaunchSync* sync = GetSync();
+        return sync->m_parked - sync->m_started;
+    };
+
+    /**
+     * Lets one parked process go on, and waits at most timeoutMs until it
+     * has. Returns its pid, or 0 on timeout (e.g., if the process died
+     * while parked).
+     */
+    int32_t Start(uint32_t timeoutMs)
+    {
+        Ns3AiLaunchSync* sync = GetSync();
+        if (sync->m_parked == sync->m_started)
+        {
+            throw std::runtime_error("ns3-ai: no parked simulation to start");
+        }
+        uint32_t started = sync->m_started;
+        Ns3AiSemaphore::sem_post(&sync->m_go, &sync->m_goFutex);
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        while (Ns3AiSemaphore::atomic_read32(&sync->m_started) == started)
+        {
+            if (std::chrono::steady_clock::now() >= deadline)
+            {
+                return 0;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+        return sync->m_startedPid;
+    };
+
+  private:
+    Ns3AiLaunchSync* GetSync()
+    {
+        // found again, as the segment may have been grown (and remapped)
+        Ns3AiSegment::Lock lock = m_segment->LockSegment();
+        return m_segment->Get()->find<Ns3AiLaunchSync>(Ns3AiLaunch::SYNC_NAME).first;
+    };
+
+    static uint64_t GetBytes()
+    {
+        return Ns3AiSegment::GetObjectSize(sizeof(Ns3AiLaunchSync),
+                                           std::strlen(Ns3AiLaunch::SYNC_NAME));
+    };
+
+    std::shared_ptr<Ns3AiSegment> m_segment;
+};
+
+} // namespace ns3
+
+#endif // NS3_AI_LAUNCH_H
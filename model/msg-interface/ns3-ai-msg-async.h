@@ -0,0 +1,257 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:  Muyuan Shen <muyuan_shen@hust.edu.cn>
+ */
+
+#ifndef NS3_AI_MSG_ASYNC_H
+#define NS3_AI_MSG_ASYNC_H
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fcntl.h>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+namespace ns3
+{
+
+/**
+ * \brief Runs the Python side's waits of a channel (PyRecvBegin and
+ * PySendBegin) in a thread of its own, and signals their completion
+ * through a file descriptor. An event loop (e.g., Python's asyncio) can
+ * watch the descriptors of many channels and serve whichever is ready,
+ * from a single thread.
+ *
+ * The descriptor is an eventfd on Linux, a pipe elsewhere. At most one
+ * wait is in progress. Use the SPIN_THEN_SLEEP wait mode, otherwise each
+ * waiting channel keeps a core busy.
+ */
+template <typename Interface>
+class Ns3AiMsgAsyncWaiter
+{
+  public:
+    enum Operation : uint8_t
+    {
+        NONE = 0,
+        RECV_BEGIN = 1,
+        SEND_BEGIN = 2,
+    };
+
+    Ns3AiMsgAsyncWaiter() = delete;
+    Ns3AiMsgAsyncWaiter(const Ns3AiMsgAsyncWaiter&) = delete;
+    Ns3AiMsgAsyncWaiter& operator=(const Ns3AiMsgAsyncWaiter&) = delete;
+
+    explicit Ns3AiMsgAsyncWaiter(Interface* interface)
+        : m_interface(interface),
+          m_request(NONE),
+          m_lastRequest(NONE),
+          m_completed(NONE),
+          m_cancel(false),
+          m_stop(false)
+    {
+#ifdef __linux__
+        m_readFd = m_writeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (m_readFd < 0)
+#else
+        int fds[2];
+        if (pipe(fds) == 0)
+        {
+            m_readFd = fds[0];
+            m_writeFd = fds[1];
+            fcntl(m_readFd, F_SETFL, O_NONBLOCK);
+            fcntl(m_readFd, F_SETFD, FD_CLOEXEC);
+            fcntl(m_writeFd, F_SETFD, FD_CLOEXEC);
+        }
+        else
+#endif
+        {
+            throw std::runtime_error("ns3-ai: cannot create the descriptor of the async waiter");
+        }
+        m_thread = std::thread([this]() { Run(); });
+    }
+
+    ~Ns3AiMsgAsyncWaiter()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_one();
+        m_interface->PyWake();
+        m_thread.join();
+        close(m_readFd);
+        if (m_writeFd != m_readFd)
+        {
+            close(m_writeFd);
+        }
+    }
+
+    /**
+     * Gets the descriptor which becomes readable when the wait completes
+     */
+    int GetFd() const
+    {
+        return m_readFd;
+    };
+
+    /**
+     * Starts waiting (PyRecvBegin or PySendBegin) in the thread. If a
+     * cancelled wait for the same operation had completed anyway, the
+     * descriptor is signalled at once.
+     */
+    void Start(Operation op)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_request != NONE)
+        {
+            throw std::runtime_error("ns3-ai: a wait is already in progress");
+        }
+        if (m_completed != NONE)
+        {
+            if (m_completed != op)
+            {
+                throw std::runtime_error("ns3-ai: a cancelled wait completed, resume it first");
+            }
+            m_completed = NONE;
+            Signal();
+            return;
+        }
+        m_cancel = false;
+        m_request = op;
+        m_wake.notify_one();
+    };
+
+    /**
+     * Consumes the completion signal. Returns false if the wait has not
+     * completed yet; rethrows the error of a failed wait.
+     */
+    bool Collect()
+    {
+        uint64_t value;
+        if (read(m_readFd, &value, sizeof(value)) <= 0)
+        {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_error.empty())
+        {
+            std::string error;
+            error.swap(m_error);
+            throw std::runtime_error(error);
+        }
+        return true;
+    };
+
+    /**
+     * Cancels the wait in progress and waits for the thread to give up.
+     * Returns true if the wait completed anyway: the message is then kept
+     * for the next Start of the same operation.
+     */
+    bool Cancel()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        Operation op = m_request != NONE ? m_request : m_lastRequest;
+        m_cancel = true;
+        while (m_request != NONE)
+        {
+            lock.unlock();
+            m_interface->PyWake();
+            lock.lock();
+            m_idle.wait_for(lock, std::chrono::milliseconds(1));
+        }
+        uint64_t value;
+        if (read(m_readFd, &value, sizeof(value)) > 0 && m_error.empty())
+        {
+            m_completed = op;
+            return true;
+        }
+        m_error.clear();
+        return false;
+    };
+
+  private:
+    void Run()
+    {
+        auto cancelled = [this]() { return m_cancel.load() || m_stop.load(); };
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true)
+        {
+            m_wake.wait(lock, [this]() { return m_stop || m_request != NONE; });
+            if (m_stop)
+            {
+                return;
+            }
+            Operation op = m_request;
+            lock.unlock();
+            bool done = false;
+            std::string error;
+            try
+            {
+                done = op == RECV_BEGIN ? m_interface->PyRecvBeginUnless(cancelled)
+                                        : m_interface->PySendBeginUnless(cancelled);
+            }
+            catch (const std::exception& e)
+            {
+                error = e.what();
+            }
+            lock.lock();
+            m_lastRequest = op;
+            m_request = NONE;
+            if (done || !error.empty())
+            {
+                m_error = error;
+                Signal();
+            }
+            m_idle.notify_all();
+        }
+    };
+
+    void Signal()
+    {
+        uint64_t one = 1;
+        while (write(m_writeFd, &one, sizeof(one)) < 0 && errno == EINTR)
+        {
+        }
+    };
+
+    Interface* m_interface;
+    int m_readFd;
+    int m_writeFd;
+    Operation m_request;     //!< wait in progress, NONE if the thread is idle
+    Operation m_lastRequest; //!< the previous wait
+    Operation m_completed;   //!< cancelled wait which completed anyway
+    std::atomic<bool> m_cancel;
+    std::atomic<bool> m_stop;
+    std::string m_error; //!< error of the last wait, thrown by Collect
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    std::thread m_thread;
+};
+
+} // namespace ns3
+
+#endif // NS3_AI_MSG_ASYNC_H
@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:  Muyuan Shen <muyuan_shen@hust.edu.cn>
+ */
+
+#ifndef NS3_AI_MSG_FUTURE_H
+#define NS3_AI_MSG_FUTURE_H
+
+#include "ns3-ai-msg-interface.h"
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \brief A request sent to Python whose reply is collected later, so that
+ * the simulation keeps running while Python computes the action.
+ *
+ * At most one request is in flight. The reply is copied out of shared
+ * memory when it arrives, and stays available (as the latest action)
+ * until the next reply replaces it. Typical use, with a controller delay:
+ *
+ * \code
+ *   if (future.TrySendBegin())
+ *   {
+ *       ... fill interface->GetCpp2PyStruct() ...
+ *       future.SendEnd();
+ *   }
+ *   Simulator::Schedule(MilliSeconds(2), [&]() {
+ *       future.Poll();
+ *       if (future.HasAction())
+ *       {
+ *           Apply(future.GetAction()); // the previous action if not ready
+ *       }
+ *   });
+ * \endcode
+ */
+template <typename Cpp2PyMsgType, typename Py2CppMsgType>
+class Ns3AiMsgFuture
+{
+  public:
+    typedef Ns3AiMsgInterfaceImpl<Cpp2PyMsgType, Py2CppMsgType> Interface;
+
+    Ns3AiMsgFuture() = delete;
+
+    explicit Ns3AiMsgFuture(Interface* interface)
+        : m_interface(interface),
+          m_isPending(false),
+          m_hasAction(false),
+          m_numActions(0)
+    {
+    }
+
+    /**
+     * Starts a request without blocking. Returns false, and nothing must
+     * be written, if the previous request is still unanswered or if
+     * Python has not read the previous message yet. Otherwise writes go to
+     * the interface's struct or vector, and SendEnd must follow.
+     */
+    bool TrySendBegin()
+    {
+        if (m_isPending && !Poll())
+        {
+            return false;
+        }
+        return m_interface->CppTrySendBegin();
+    };
+
+    /**
+     * Sends the request started with TrySendBegin
+     */
+    void SendEnd()
+    {
+        m_interface->CppSendEnd();
+        m_isPending = true;
+    };
+
+    /**
+     * Checks, without blocking, whether the reply to the pending request
+     * has arrived. If so, copies it and returns true.
+     */
+    bool Poll()
+    {
+        if (!m_isPending || !m_interface->CppPollRecvBegin())
+        {
+            return false;
+        }
+        Collect();
+        return true;
+    };
+
+    /**
+     * Blocks until the reply to the pending request has arrived, if any
+     */
+    void Wait()
+    {
+        if (!m_isPending)
+        {
+            return;
+        }
+        m_interface->CppRecvBegin();
+        Collect();
+    };
+
+    /**
+     * Gets whether a request was sent and its reply is not collected yet
+     */
+    bool IsPending() const
+    {
+        return m_isPending;
+    };
+
+    /**
+     * Gets whether at least one reply was collected
+     */
+    bool HasAction() const
+    {
+        return m_hasAction;
+    };
+
+    /**
+     * Gets the number of replies collected so far, useful to tell a
+     * fresh action from the previous one
+     */
+    uint64_t GetNumActions() const
+    {
+        return m_numActions;
+    };
+
+    /**
+     * Gets the latest collected reply, struct-based interface
+     */
+    const Py2CppMsgType& GetAction() const
+    {
+        assert(m_hasAction && !m_interface->IsUsingVector());
+        return m_action;
+    };
+
+    /**
+     * Gets the latest collected reply, vector-based interface
+     */
+    const std::vector<Py2CppMsgType>& GetActions() const
+    {
+        assert(m_hasAction && m_interface->IsUsingVector());
+        return m_actions;
+    };
+
+  private:
+    /**
+     * Copies the reply out of shared memory and frees the mailbox
+     */
+    void Collect()
+    {
+        if (m_interface->IsUsingVector())
+        {
+            m_actions.assign(m_interface->GetPy2CppVector()->begin(),
+                             m_interface->GetPy2CppVector()->end());
+        }
+        else
+        {
+            m_action = *m_interface->GetPy2CppStruct();
+        }
+        m_interface->CppRecvEnd();
+        m_isPending = false;
+        m_hasAction = true;
+        ++m_numActions;
+    };
+
+    Interface* m_interface;
+    bool m_isPending;
+    bool m_hasAction;
+    uint64_t m_numActions;
+    Py2CppMsgType m_action;
+    std::vector<Py2CppMsgType> m_actions;
+};
+
+} // namespace ns3
+
+#endif // NS3_AI_MSG_FUTURE_H
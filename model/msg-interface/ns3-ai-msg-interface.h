@@ -20,19 +20,41 @@
 #ifndef NS3_AI_MSG_INTERFACE_H
 #define NS3_AI_MSG_INTERFACE_H
 
+#include "ns3-ai-embedded.h"
+#include "ns3-ai-launch.h"
+#include "ns3-ai-msg-log.h"
+#include "ns3-ai-msg-ring.h"
+#include "ns3-ai-msg-stats.h"
+#include "ns3-ai-segment.h"
 #include "ns3-ai-semaphore.h"
+#include "ns3-ai-socket.h"
 
+#include <ns3/abort.h>
+#include <ns3/simulator.h>
 #include <ns3/singleton.h>
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <typeindex>
+#include <utility>
 #include <vector>
 #include <boost/interprocess/allocators/allocator.hpp>
 #include <boost/interprocess/containers/vector.hpp>
 #include <boost/interprocess/managed_shared_memory.hpp>
 
+#ifdef __linux__
+#include <sched.h>
+#endif
+
 namespace ns3
 {
 
@@ -46,6 +68,17 @@ struct Ns3AiMsgSync
     volatile uint8_t m_py2cppEmptyCount{1};
     volatile uint8_t m_py2cppFullCount{0};
     bool m_isFinished{false};
+
+    // futex words to park on in SPIN_THEN_SLEEP mode, one per semaphore
+    Ns3AiFutex m_cpp2pyEmptyFutex;
+    Ns3AiFutex m_cpp2pyFullFutex;
+    Ns3AiFutex m_py2cppEmptyFutex;
+    Ns3AiFutex m_py2cppFullFutex;
+
+    // wait mode chosen by the memory creator, adopted by the other side
+    // unless it configures its own
+    uint8_t m_waitMode{Ns3AiSemaphore::SPIN};
+    uint32_t m_spinBudgetUs{Ns3AiSemaphore::DEFAULT_SPIN_BUDGET_US};
 };
 
 /**
@@ -60,7 +93,7 @@ class Ns3AiMsgInterfaceImpl
     explicit Ns3AiMsgInterfaceImpl(bool is_memory_creator,
                                    bool use_vector,
                                    bool handle_finish,
-                                   uint32_t size = 4096,
+                                   uint32_t size = 0,
                                    const char* segment_name = "My Seg",
                                    const char* cpp2py_msg_name = "My Cpp to Python Msg",
                                    const char* py2cpp_msg_name = "My Python to Cpp Msg",
@@ -69,64 +102,94 @@ class Ns3AiMsgInterfaceImpl
           m_useVector(use_vector),
           m_handleFinish(handle_finish),
           m_segName(segment_name),
-          m_isFinished(false)
+          m_cpp2pyMsgName(cpp2py_msg_name),
+          m_py2cppMsgName(py2cpp_msg_name),
+          m_lockableName(lockable_name),
+          m_isSocket(Ns3AiSocket::IsAddress(segment_name)),
+          m_isFinished(false),
+          m_waitMode(Ns3AiSemaphore::SPIN),
+          m_spinBudgetUs(Ns3AiSemaphore::DEFAULT_SPIN_BUDGET_US),
+          m_lastSendEnd(0)
     {
-        using namespace boost::interprocess;
-        if (m_isCreator)
+        uint64_t objectBytes =
+            GetObjectBytes(m_useVector,
+                           0,
+                           std::max({m_cpp2pyMsgName.size(),
+                                     m_py2cppMsgName.size(),
+                                     GetStatsName().size()}));
+        uint64_t segmentSize = size > 0 ? size : Ns3AiSegment::GetSegmentSize(objectBytes);
+        // the segment is shared with the other channels of this process
+        // which use the same segment name. Over a socket, each side keeps
+        // its messages in a segment of its own.
+        m_segment = m_isSocket ? Ns3AiSegment::Open(GetSocketSegmentName(), true, segmentSize)
+                               : Ns3AiSegment::Open(m_segName, m_isCreator, segmentSize);
+        if (m_isCreator || m_isSocket)
         {
-            shared_memory_object::remove(m_segName.c_str());
-            static managed_shared_memory segment(create_only, m_segName.c_str(), size);
+            // grows the segment if it already holds other channels
+            Ns3AiSegment::Lock lock = m_segment->LockSegment();
+            m_segment->Reserve(objectBytes);
+            Ns3AiSegment::Manager* segment = m_segment->Get();
             if (m_useVector)
             {
-                static const Cpp2PyMsgAllocator alloc_env(segment.get_segment_manager());
-                static const Cpp2PyMsgAllocator alloc_act(segment.get_segment_manager());
-                m_cpp2pyVector = segment.construct<Cpp2PyMsgVector>(cpp2py_msg_name)(alloc_env);
-                m_py2cppVector = segment.construct<Py2CppMsgVector>(py2cpp_msg_name)(alloc_act);
-                m_cpp2pyStruct = nullptr;
-                m_py2CppStruct = nullptr;
+                const Cpp2PyMsgAllocator alloc_env(segment);
+                const Py2CppMsgAllocator alloc_act(segment);
+                segment->construct<Cpp2PyMsgVector>(cpp2py_msg_name)(alloc_env);
+                segment->construct<Py2CppMsgVector>(py2cpp_msg_name)(alloc_act);
             }
             else
             {
-                m_cpp2pyVector = nullptr;
-                m_py2cppVector = nullptr;
-                m_cpp2pyStruct = segment.construct<Cpp2PyMsgType>(cpp2py_msg_name)();
-                m_py2CppStruct = segment.construct<Py2CppMsgType>(py2cpp_msg_name)();
+                segment->construct<Cpp2PyMsgType>(cpp2py_msg_name)();
+                segment->construct<Py2CppMsgType>(py2cpp_msg_name)();
             }
-            m_sync = segment.construct<Ns3AiMsgSync>(lockable_name)();
+            segment->construct<Ns3AiMsgSync>(lockable_name)();
         }
-        else
+        Attach();
+        if (m_isSocket)
         {
-            static managed_shared_memory segment(open_only, segment_name);
-            if (m_useVector)
-            {
-                m_cpp2pyVector = segment.find<Cpp2PyMsgVector>(cpp2py_msg_name).first;
-                m_py2cppVector = segment.find<Py2CppMsgVector>(py2cpp_msg_name).first;
-                m_cpp2pyStruct = nullptr;
-                m_py2CppStruct = nullptr;
-            }
-            else
-            {
-                m_cpp2pyVector = nullptr;
-                m_py2cppVector = nullptr;
-                m_cpp2pyStruct = segment.find<Cpp2PyMsgType>(cpp2py_msg_name).first;
-                m_py2CppStruct = segment.find<Py2CppMsgType>(py2cpp_msg_name).first;
-            }
-            m_sync = segment.find<Ns3AiMsgSync>(lockable_name).first;
+            OpenSocket();
+        }
+        else if (!m_isCreator)
+        {
+            m_waitMode = static_cast<Ns3AiSemaphore::WaitMode>(m_sync->m_waitMode);
+            m_spinBudgetUs = m_sync->m_spinBudgetUs;
         }
     };
 
     ~Ns3AiMsgInterfaceImpl()
     {
-        if (m_isCreator)
+        if (!m_isCreator && m_handleFinish)
         {
-            boost::interprocess::shared_memory_object::remove(m_segName.c_str());
+            try
+            {
+                CppSetFinished();
+            }
+            catch (const std::exception& e)
+            {
+                // the other side is gone
+                std::cerr << e.what() << std::endl;
+            }
         }
-        else
+        if (m_isCreator || m_isSocket)
         {
-            if (m_handleFinish)
+            // the segment may outlive this channel, so free the channel's objects
+            Ns3AiSegment::Lock lock = m_segment->LockSegment();
+            Ns3AiSegment::Manager* segment = m_segment->Get();
+            if (m_useVector)
             {
-                CppSetFinished();
+                segment->destroy<Cpp2PyMsgVector>(m_cpp2pyMsgName.c_str());
+                segment->destroy<Py2CppMsgVector>(m_py2cppMsgName.c_str());
             }
+            else
+            {
+                segment->destroy<Cpp2PyMsgType>(m_cpp2pyMsgName.c_str());
+                segment->destroy<Py2CppMsgType>(m_py2cppMsgName.c_str());
+            }
+            segment->destroy<Ns3AiMsgSync>(m_lockableName.c_str());
+            segment->destroy<Ns3AiMsgStats>(GetStatsName().c_str());
+        }
+        if (m_listener && m_socket)
+        {
+            m_listener->Release(m_lockableName);
         }
     };
 
@@ -139,6 +202,41 @@ class Ns3AiMsgInterfaceImpl
             Py2CppMsgAllocator;
     typedef boost::interprocess::vector<Py2CppMsgType, Py2CppMsgAllocator> Py2CppMsgVector;
 
+    /**
+     * Gets the segment size needed by one channel with these message
+     * types. For the vector-based interface, vector_capacity is the
+     * number of elements in each vector.
+     */
+    static uint64_t GetRequiredSize(bool use_vector, uint32_t vector_capacity)
+    {
+        return Ns3AiSegment::GetSegmentSize(GetObjectBytes(use_vector, vector_capacity));
+    };
+
+    /**
+     * Gets the size of the segment in bytes, which may have grown
+     */
+    uint64_t GetMemorySize()
+    {
+        return m_segment->GetSize();
+    };
+
+    /**
+     * Gets the number of bytes still available in the segment
+     */
+    uint64_t GetFreeMemory()
+    {
+        return m_segment->GetFreeMemory();
+    };
+
+    /**
+     * Asks for the segment to be backed by transparent huge pages, see
+     * Ns3AiSegment::SetHugePages. Returns false if not supported.
+     */
+    bool SetHugePages(bool enable)
+    {
+        return m_segment->SetHugePages(enable);
+    };
+
     // use structure for the simple case:
 
     /**
@@ -183,6 +281,44 @@ class Ns3AiMsgInterfaceImpl
         return m_py2cppVector;
     };
 
+    /**
+     * Resizes the vector used in C++ to Python transmission, growing the
+     * segment if needed. Call it at a synchronization point, such as
+     * between CppSendBegin and CppSendEnd (or before the other side
+     * attaches). Pointers to the elements are invalidated.
+     */
+    void ResizeCpp2PyVector(uint32_t size)
+    {
+        assert(m_useVector);
+        Refresh();
+        if (size > m_cpp2pyVector->capacity())
+        {
+            Ns3AiSegment::Lock lock = m_segment->LockSegment();
+            m_segment->Reserve(Ns3AiSegment::GetObjectSize(size * sizeof(Cpp2PyMsgType), 0));
+            Refresh();
+            m_cpp2pyVector->reserve(size);
+        }
+        m_cpp2pyVector->resize(size);
+    };
+
+    /**
+     * Resizes the vector used in Python to C++ transmission, growing the
+     * segment if needed. See ResizeCpp2PyVector.
+     */
+    void ResizePy2CppVector(uint32_t size)
+    {
+        assert(m_useVector);
+        Refresh();
+        if (size > m_py2cppVector->capacity())
+        {
+            Ns3AiSegment::Lock lock = m_segment->LockSegment();
+            m_segment->Reserve(Ns3AiSegment::GetObjectSize(size * sizeof(Py2CppMsgType), 0));
+            Refresh();
+            m_py2cppVector->reserve(size);
+        }
+        m_py2cppVector->resize(size);
+    };
+
     // for C++ side:
 
     /**
@@ -191,7 +327,22 @@ class Ns3AiMsgInterfaceImpl
      */
     void CppSendBegin()
     {
-        Ns3AiSemaphore::sem_wait(&m_sync->m_cpp2pyEmptyCount);
+        if (m_isSocket)
+        {
+            // the previous message is already on its way (pipelining)
+            return;
+        }
+        uint64_t start = m_stats ? Ns3AiMsgStats::Now() : 0;
+        Ns3AiSemaphore::sem_wait(&m_sync->m_cpp2pyEmptyCount,
+                                 &m_sync->m_cpp2pyEmptyFutex,
+                                 m_waitMode,
+                                 m_spinBudgetUs,
+                                 &m_sendWaitStats);
+        Refresh();
+        if (m_stats && start)
+        {
+            m_stats->m_cpp2py.m_sendWait.Record(Ns3AiMsgStats::Now() - start);
+        }
     };
 
     /**
@@ -200,7 +351,32 @@ class Ns3AiMsgInterfaceImpl
      */
     void CppSendEnd()
     {
-        Ns3AiSemaphore::sem_post(&m_sync->m_cpp2pyFullCount);
+        // the finish message is not recorded, the replay sends its own
+        if (m_log && !m_isFinished)
+        {
+            RecordMessage(Ns3AiMsgLogRecord::CPP2PY);
+        }
+        if (m_stats)
+        {
+            RecordSend(m_stats->m_cpp2py,
+                       m_useVector ? m_cpp2pyVector->size() * sizeof(Cpp2PyMsgType)
+                                   : sizeof(Cpp2PyMsgType));
+        }
+        if (m_isSocket)
+        {
+            SocketSend(m_isFinished ? Ns3AiSocketFrame::FINISH : Ns3AiSocketFrame::MSG,
+                       m_cpp2pyStruct,
+                       m_cpp2pyVector);
+        }
+        else
+        {
+            Ns3AiSemaphore::sem_post(&m_sync->m_cpp2pyFullCount, &m_sync->m_cpp2pyFullFutex);
+            if (m_directHandler && !m_isFinished)
+            {
+                // the embedded script replies now, so CppRecvBegin does not wait
+                m_directHandler();
+            }
+        }
     };
 
     /**
@@ -209,7 +385,30 @@ class Ns3AiMsgInterfaceImpl
      */
     void CppRecvBegin()
     {
-        Ns3AiSemaphore::sem_wait(&m_sync->m_py2cppFullCount);
+        uint64_t start = m_stats ? Ns3AiMsgStats::Now() : 0;
+        if (m_isSocket)
+        {
+            SocketRecv(&Ns3AiMsgInterfaceImpl::m_py2CppStruct,
+                       &Ns3AiMsgInterfaceImpl::m_py2cppVector,
+                       &Ns3AiMsgInterfaceImpl::ResizePy2CppVector);
+        }
+        else
+        {
+            Ns3AiSemaphore::sem_wait(&m_sync->m_py2cppFullCount,
+                                     &m_sync->m_py2cppFullFutex,
+                                     m_waitMode,
+                                     m_spinBudgetUs,
+                                     &m_recvWaitStats);
+            Refresh();
+        }
+        if (m_stats)
+        {
+            RecordRecv(m_stats->m_py2cpp, m_stats->m_cpp2py, start);
+        }
+        if (m_log)
+        {
+            RecordMessage(Ns3AiMsgLogRecord::PY2CPP);
+        }
     };
 
     /**
@@ -218,7 +417,65 @@ class Ns3AiMsgInterfaceImpl
      */
     void CppRecvEnd()
     {
-        Ns3AiSemaphore::sem_post(&m_sync->m_py2cppEmptyCount);
+        if (!m_isSocket)
+        {
+            Ns3AiSemaphore::sem_post(&m_sync->m_py2cppEmptyCount, &m_sync->m_py2cppEmptyFutex);
+        }
+    };
+
+    /**
+     * Non-blocking CppSendBegin. Returns true if C++ can start writing
+     * (then CppSendEnd must follow), or false if Python has not read the
+     * previous message yet.
+     */
+    bool CppTrySendBegin()
+    {
+        if (m_isSocket)
+        {
+            return true;
+        }
+        if (!Ns3AiSemaphore::sem_try_wait(&m_sync->m_cpp2pyEmptyCount))
+        {
+            return false;
+        }
+        Refresh();
+        return true;
+    };
+
+    /**
+     * Non-blocking CppRecvBegin. Returns true if Python's message has
+     * arrived and C++ can start reading (then CppRecvEnd must follow),
+     * or false if it is not ready yet.
+     */
+    bool CppPollRecvBegin()
+    {
+        if (m_isSocket)
+        {
+            if (!GetSocket()->Poll())
+            {
+                return false;
+            }
+            SocketRecv(&Ns3AiMsgInterfaceImpl::m_py2CppStruct,
+                       &Ns3AiMsgInterfaceImpl::m_py2cppVector,
+                       &Ns3AiMsgInterfaceImpl::ResizePy2CppVector);
+        }
+        else
+        {
+            if (!Ns3AiSemaphore::sem_try_wait(&m_sync->m_py2cppFullCount))
+            {
+                return false;
+            }
+            Refresh();
+        }
+        if (m_stats)
+        {
+            RecordRecv(m_stats->m_py2cpp, m_stats->m_cpp2py, 0);
+        }
+        if (m_log)
+        {
+            RecordMessage(Ns3AiMsgLogRecord::PY2CPP);
+        }
+        return true;
     };
 
     /**
@@ -232,6 +489,29 @@ class Ns3AiMsgInterfaceImpl
         CppSendBegin();
         m_sync->m_isFinished = true;
         CppSendEnd();
+        if (m_stats)
+        {
+            std::cout << "ns3-ai: statistics of channel '" << m_lockableName << "':\n";
+            m_stats->Print(std::cout);
+        }
+    };
+
+    /**
+     * Sets the function which makes the Python side reply to each message
+     * as soon as CppSendEnd has sent it, on this thread (see
+     * Ns3AiEmbeddedPython::GetHandler). The finish message is not handled.
+     */
+    void SetDirectHandler(std::function<void()> handler)
+    {
+        m_directHandler = std::move(handler);
+    };
+
+    /**
+     * Gets whether the interface is vector-based
+     */
+    bool IsUsingVector() const
+    {
+        return m_useVector;
     };
 
     // for Python side:
@@ -242,11 +522,24 @@ class Ns3AiMsgInterfaceImpl
      */
     void PyRecvBegin()
     {
-        Ns3AiSemaphore::sem_wait(&m_sync->m_cpp2pyFullCount);
-        if (m_handleFinish)
+        uint64_t start = m_stats ? Ns3AiMsgStats::Now() : 0;
+        if (m_isSocket)
         {
-            m_isFinished = m_sync->m_isFinished;
+            uint32_t type = SocketRecv(&Ns3AiMsgInterfaceImpl::m_cpp2pyStruct,
+                                       &Ns3AiMsgInterfaceImpl::m_cpp2pyVector,
+                                       &Ns3AiMsgInterfaceImpl::ResizeCpp2PyVector);
+            m_sync->m_isFinished = type == Ns3AiSocketFrame::FINISH;
+        }
+        else
+        {
+            Ns3AiSemaphore::sem_wait(&m_sync->m_cpp2pyFullCount,
+                                     &m_sync->m_cpp2pyFullFutex,
+                                     m_waitMode,
+                                     m_spinBudgetUs,
+                                     &m_recvWaitStats);
+            Refresh();
         }
+        PyRecvDone(start);
     };
 
     /**
@@ -255,7 +548,10 @@ class Ns3AiMsgInterfaceImpl
      */
     void PyRecvEnd()
     {
-        Ns3AiSemaphore::sem_post(&m_sync->m_cpp2pyEmptyCount);
+        if (!m_isSocket)
+        {
+            Ns3AiSemaphore::sem_post(&m_sync->m_cpp2pyEmptyCount, &m_sync->m_cpp2pyEmptyFutex);
+        }
     };
 
     /**
@@ -264,7 +560,21 @@ class Ns3AiMsgInterfaceImpl
      */
     void PySendBegin()
     {
-        Ns3AiSemaphore::sem_wait(&m_sync->m_py2cppEmptyCount);
+        if (m_isSocket)
+        {
+            return;
+        }
+        uint64_t start = m_stats ? Ns3AiMsgStats::Now() : 0;
+        Ns3AiSemaphore::sem_wait(&m_sync->m_py2cppEmptyCount,
+                                 &m_sync->m_py2cppEmptyFutex,
+                                 m_waitMode,
+                                 m_spinBudgetUs,
+                                 &m_sendWaitStats);
+        Refresh();
+        if (m_stats && start)
+        {
+            m_stats->m_py2cpp.m_sendWait.Record(Ns3AiMsgStats::Now() - start);
+        }
     };
 
     /**
@@ -273,7 +583,114 @@ class Ns3AiMsgInterfaceImpl
      */
     void PySendEnd()
     {
-        Ns3AiSemaphore::sem_post(&m_sync->m_py2cppFullCount);
+        if (m_stats)
+        {
+            RecordSend(m_stats->m_py2cpp,
+                       m_useVector ? m_py2cppVector->size() * sizeof(Py2CppMsgType)
+                                   : sizeof(Py2CppMsgType));
+        }
+        if (m_isSocket)
+        {
+            SocketSend(Ns3AiSocketFrame::MSG, m_py2CppStruct, m_py2cppVector);
+        }
+        else
+        {
+            Ns3AiSemaphore::sem_post(&m_sync->m_py2cppFullCount, &m_sync->m_py2cppFullFutex);
+        }
+    };
+
+    /**
+     * PyRecvBegin which gives up, returning false, as soon as cancelled()
+     * returns true. Waits which sleep check it again when woken by
+     * PyWake. For waiting in another thread, see Ns3AiMsgAsyncWaiter.
+     */
+    template <typename Cancelled>
+    bool PyRecvBeginUnless(Cancelled cancelled)
+    {
+        if (m_isSocket)
+        {
+            // polls the connection, so that cancelled is checked periodically
+            while (true)
+            {
+                Ns3AiSocket* socket = GetSocket(SOCKET_POLL_MS);
+                if (socket && socket->WaitReadable(SOCKET_POLL_MS))
+                {
+                    break;
+                }
+                if (cancelled())
+                {
+                    return false;
+                }
+            }
+            PyRecvBegin();
+            return true;
+        }
+        uint64_t start = m_stats ? Ns3AiMsgStats::Now() : 0;
+        bool received = false;
+        Ns3AiSemaphore::wait_until(
+            [this, &cancelled, &received]() {
+                received = Ns3AiSemaphore::sem_try_wait(&m_sync->m_cpp2pyFullCount);
+                return received || cancelled();
+            },
+            &m_sync->m_cpp2pyFullFutex,
+            m_waitMode,
+            m_spinBudgetUs,
+            &m_recvWaitStats);
+        if (!received)
+        {
+            return false;
+        }
+        Refresh();
+        PyRecvDone(start);
+        return true;
+    };
+
+    /**
+     * PySendBegin which gives up, returning false, as soon as cancelled()
+     * returns true. See PyRecvBeginUnless.
+     */
+    template <typename Cancelled>
+    bool PySendBeginUnless(Cancelled cancelled)
+    {
+        if (m_isSocket)
+        {
+            PySendBegin();
+            return true;
+        }
+        uint64_t start = m_stats ? Ns3AiMsgStats::Now() : 0;
+        bool ready = false;
+        Ns3AiSemaphore::wait_until(
+            [this, &cancelled, &ready]() {
+                ready = Ns3AiSemaphore::sem_try_wait(&m_sync->m_py2cppEmptyCount);
+                return ready || cancelled();
+            },
+            &m_sync->m_py2cppEmptyFutex,
+            m_waitMode,
+            m_spinBudgetUs,
+            &m_sendWaitStats);
+        if (!ready)
+        {
+            return false;
+        }
+        Refresh();
+        if (m_stats && start)
+        {
+            m_stats->m_py2cpp.m_sendWait.Record(Ns3AiMsgStats::Now() - start);
+        }
+        return true;
+    };
+
+    /**
+     * Wakes the Python side's sleeping waits, so that the cancellable ones
+     * check their condition again
+     */
+    void PyWake()
+    {
+        if (!m_isSocket)
+        {
+            Ns3AiSemaphore::notify(&m_sync->m_cpp2pyFullFutex);
+            Ns3AiSemaphore::notify(&m_sync->m_py2cppEmptyFutex);
+        }
     };
 
     /**
@@ -285,18 +702,443 @@ class Ns3AiMsgInterfaceImpl
         return m_isFinished;
     };
 
+    // wait mode and statistics, for both sides:
+
+    /**
+     * Sets how this side waits on the semaphores. With SPIN_THEN_SLEEP,
+     * a wait spins for at most spinBudgetUs microseconds and then sleeps
+     * until the other side posts. If this side is the memory creator,
+     * the mode also becomes the default of the other side.
+     */
+    void SetWaitMode(Ns3AiSemaphore::WaitMode mode,
+                     uint32_t spinBudgetUs = Ns3AiSemaphore::DEFAULT_SPIN_BUDGET_US)
+    {
+        m_waitMode = mode;
+        m_spinBudgetUs = spinBudgetUs;
+        if (m_isCreator)
+        {
+            m_sync->m_waitMode = mode;
+            m_sync->m_spinBudgetUs = spinBudgetUs;
+        }
+    };
+
+    /**
+     * Gets the wait mode used on this side
+     */
+    Ns3AiSemaphore::WaitMode GetWaitMode() const
+    {
+        return m_waitMode;
+    };
+
+    /**
+     * Gets the spin budget (in microseconds) used on this side
+     */
+    uint32_t GetSpinBudgetUs() const
+    {
+        return m_spinBudgetUs;
+    };
+
+    /**
+     * Gets the statistics of waiting for the right to send (CppSendBegin
+     * or PySendBegin on this side)
+     */
+    const Ns3AiWaitStats& GetSendWaitStats() const
+    {
+        return m_sendWaitStats;
+    };
+
+    /**
+     * Gets the statistics of waiting for a message to receive (CppRecvBegin
+     * or PyRecvBegin on this side)
+     */
+    const Ns3AiWaitStats& GetRecvWaitStats() const
+    {
+        return m_recvWaitStats;
+    };
+
+    /**
+     * Clears the wait statistics of this side
+     */
+    void ResetWaitStats()
+    {
+        m_sendWaitStats.Reset();
+        m_recvWaitStats.Reset();
+    };
+
+    /**
+     * Starts recording the channel statistics (messages, payload bytes,
+     * wait times and round-trip times of both directions) in shared
+     * memory, where both sides update and read them. Either side can
+     * enable them, the other side starts recording at its next Begin.
+     * Call it at a synchronization point, or before the other side
+     * attaches, since it may grow the segment.
+     */
+    void EnableStats()
+    {
+        Refresh();
+        if (m_stats)
+        {
+            return;
+        }
+        Ns3AiSegment::Lock lock = m_segment->LockSegment();
+        m_segment->Reserve(
+            Ns3AiSegment::GetObjectSize(sizeof(Ns3AiMsgStats), GetStatsName().size()));
+        Refresh();
+        m_stats = m_segment->Get()->find_or_construct<Ns3AiMsgStats>(GetStatsName().c_str())();
+    };
+
+    /**
+     * Records the messages of this channel (both directions, as the C++
+     * side sends and receives them) with their timestamp, to a message
+     * log which can be replayed without the simulation (Ns3AiMsgReplayer,
+     * or Replay in Python). For the C++ side.
+     *
+     * \param path the log file, overwritten
+     * \param clock gives the timestamps, e.g., the simulation time in nanoseconds
+     */
+    void StartRecording(const std::string& path, std::function<int64_t()> clock)
+    {
+        m_logClock = clock;
+        m_log = std::make_unique<Ns3AiMsgLogWriter>(path,
+                                                    m_useVector,
+                                                    sizeof(Cpp2PyMsgType),
+                                                    sizeof(Py2CppMsgType));
+    };
+
+    /**
+     * Stops recording and closes the log
+     */
+    void StopRecording()
+    {
+        m_log.reset();
+    };
+
+    /**
+     * Gets the channel statistics, or nullptr if they are not enabled.
+     * They are printed by CppSetFinished.
+     */
+    const Ns3AiMsgStats* GetStats()
+    {
+        Refresh();
+        return m_stats;
+    };
+
   private:
+    /**
+     * Bytes of the named objects of one channel, whose names are at most
+     * nameLength characters, see GetRequiredSize
+     */
+    static uint64_t GetObjectBytes(bool use_vector,
+                                   uint32_t vector_capacity,
+                                   uint64_t nameLength = Ns3AiSegment::DEFAULT_NAME_LENGTH)
+    {
+        uint64_t bytes = Ns3AiSegment::GetObjectSize(sizeof(Ns3AiMsgSync), nameLength);
+        if (use_vector)
+        {
+            bytes += Ns3AiSegment::GetObjectSize(sizeof(Cpp2PyMsgVector), nameLength) +
+                     Ns3AiSegment::GetObjectSize(sizeof(Py2CppMsgVector), nameLength);
+            if (vector_capacity > 0)
+            {
+                // the vector storage is not named
+                bytes +=
+                    Ns3AiSegment::GetObjectSize(uint64_t(vector_capacity) * sizeof(Cpp2PyMsgType),
+                                                0) +
+                    Ns3AiSegment::GetObjectSize(uint64_t(vector_capacity) * sizeof(Py2CppMsgType),
+                                                0);
+            }
+        }
+        else
+        {
+            bytes += Ns3AiSegment::GetObjectSize(sizeof(Cpp2PyMsgType), nameLength) +
+                     Ns3AiSegment::GetObjectSize(sizeof(Py2CppMsgType), nameLength);
+        }
+        return bytes;
+    };
+
+    /**
+     * Finds the channel's objects in the (current mapping of the) segment
+     */
+    void Attach()
+    {
+        Ns3AiSegment::Lock lock = m_segment->LockSegment();
+        Ns3AiSegment::Manager* segment = m_segment->Get();
+        m_generation = m_segment->Refresh();
+        m_cpp2pyVector = nullptr;
+        m_py2cppVector = nullptr;
+        m_cpp2pyStruct = nullptr;
+        m_py2CppStruct = nullptr;
+        if (m_useVector)
+        {
+            m_cpp2pyVector = segment->find<Cpp2PyMsgVector>(m_cpp2pyMsgName.c_str()).first;
+            m_py2cppVector = segment->find<Py2CppMsgVector>(m_py2cppMsgName.c_str()).first;
+        }
+        else
+        {
+            m_cpp2pyStruct = segment->find<Cpp2PyMsgType>(m_cpp2pyMsgName.c_str()).first;
+            m_py2CppStruct = segment->find<Py2CppMsgType>(m_py2cppMsgName.c_str()).first;
+        }
+        m_sync = segment->find<Ns3AiMsgSync>(m_lockableName.c_str()).first;
+        // optional, nullptr unless one side enabled them
+        m_stats = segment->find<Ns3AiMsgStats>(GetStatsName().c_str()).first;
+        if (!m_sync ||
+            !(m_useVector ? m_cpp2pyVector && m_py2cppVector : m_cpp2pyStruct && m_py2CppStruct))
+        {
+            throw std::runtime_error("ns3-ai: channel '" + m_lockableName +
+                                     "' not found in segment '" + m_segName +
+                                     "', was it created by the other side?");
+        }
+    };
+
+    std::string GetStatsName() const
+    {
+        return m_lockableName + " stats";
+    };
+
+    /**
+     * Records a message sent in the given direction, and when it was sent
+     */
+    void RecordSend(Ns3AiMsgDirectionStats& dir, uint64_t bytes)
+    {
+        ++dir.m_messages;
+        dir.m_payloadBytes += bytes;
+        m_lastSendEnd = Ns3AiMsgStats::Now();
+    };
+
+    /**
+     * Records the wait for a message received in the direction recv (if
+     * start is not 0), and the round trip of the last message this side
+     * sent, in the direction sent
+     */
+    void RecordRecv(Ns3AiMsgDirectionStats& recv, Ns3AiMsgDirectionStats& sent, uint64_t start)
+    {
+        uint64_t now = Ns3AiMsgStats::Now();
+        if (start)
+        {
+            recv.m_recvWait.Record(now - start);
+        }
+        if (m_lastSendEnd)
+        {
+            sent.m_roundTrip.Record(now - m_lastSendEnd);
+            m_lastSendEnd = 0;
+        }
+    };
+
+    /**
+     * Appends the current message in the given direction to the log
+     */
+    void RecordMessage(Ns3AiMsgLogRecord::Direction direction)
+    {
+        int64_t now = m_logClock();
+        if (direction == Ns3AiMsgLogRecord::CPP2PY)
+        {
+            if (m_useVector)
+            {
+                m_log->Append(direction,
+                              now,
+                              m_cpp2pyVector->empty() ? nullptr : &(*m_cpp2pyVector)[0],
+                              m_cpp2pyVector->size(),
+                              sizeof(Cpp2PyMsgType));
+            }
+            else
+            {
+                m_log->Append(direction, now, m_cpp2pyStruct, 1, sizeof(Cpp2PyMsgType));
+            }
+        }
+        else
+        {
+            if (m_useVector)
+            {
+                m_log->Append(direction,
+                              now,
+                              m_py2cppVector->empty() ? nullptr : &(*m_py2cppVector)[0],
+                              m_py2cppVector->size(),
+                              sizeof(Py2CppMsgType));
+            }
+            else
+            {
+                m_log->Append(direction, now, m_py2CppStruct, 1, sizeof(Py2CppMsgType));
+            }
+        }
+    };
+
+    /**
+     * Updates the statistics and the finished status once a message from
+     * C++ has been received
+     */
+    void PyRecvDone(uint64_t start)
+    {
+        if (m_stats)
+        {
+            RecordRecv(m_stats->m_cpp2py, m_stats->m_py2cpp, start);
+        }
+        if (m_handleFinish)
+        {
+            m_isFinished = m_sync->m_isFinished;
+        }
+    };
+
+    /**
+     * Name of the segment holding this side's messages over a socket,
+     * private to the process (and to the side, for tests in one process)
+     */
+    std::string GetSocketSegmentName() const
+    {
+        return "ns3ai-socket-" + std::to_string(getpid()) + (m_isCreator ? "-py" : "-cpp");
+    };
+
+    /**
+     * Connects to the memory creator, which listens on the address. The
+     * creator accepts the connection when it first uses the socket, so
+     * that the C++ side can be started after it.
+     */
+    void OpenSocket()
+    {
+        if (m_isCreator)
+        {
+            m_listener = Ns3AiSocketListener::Open(m_segName);
+            return;
+        }
+        Ns3AiSocketHello hello{};
+        hello.m_useVector = m_useVector;
+        hello.m_cpp2pySize = sizeof(Cpp2PyMsgType);
+        hello.m_py2cppSize = sizeof(Py2CppMsgType);
+        std::strncpy(hello.m_name, m_lockableName.c_str(), sizeof(hello.m_name) - 1);
+        m_socket = Ns3AiSocket::Connect(m_segName, hello, SOCKET_CONNECT_TIMEOUT_MS);
+    };
+
+    /**
+     * Gets the connection, accepting it first on the memory creator side.
+     * Returns nullptr if it is not accepted within timeoutMs (-1: no timeout).
+     */
+    Ns3AiSocket* GetSocket(int timeoutMs = -1)
+    {
+        if (!m_socket)
+        {
+            Ns3AiSocketHello hello;
+            m_socket = m_listener->Accept(m_lockableName, hello, timeoutMs);
+            if (!m_socket)
+            {
+                return nullptr;
+            }
+            if (bool(hello.m_useVector) != m_useVector ||
+                hello.m_cpp2pySize != sizeof(Cpp2PyMsgType) ||
+                hello.m_py2cppSize != sizeof(Py2CppMsgType))
+            {
+                throw std::runtime_error("ns3-ai: the other side of channel '" + m_lockableName +
+                                         "' uses other message types");
+            }
+        }
+        return m_socket.get();
+    };
+
+    /**
+     * Sends this side's message (struct, or vector) as a frame
+     */
+    template <typename T, typename V>
+    void SocketSend(uint32_t type, const T* object, V* vec)
+    {
+        if (m_useVector)
+        {
+            GetSocket()->Send(type, vec->empty() ? nullptr : &(*vec)[0], vec->size(), sizeof(T));
+        }
+        else
+        {
+            GetSocket()->Send(type, object, 1, sizeof(T));
+        }
+    };
+
+    /**
+     * Receives the other side's message into this side's struct, or into
+     * its vector after resizing it. Returns the frame type.
+     */
+    template <typename T, typename V>
+    uint32_t SocketRecv(T* Ns3AiMsgInterfaceImpl::*object,
+                        V* Ns3AiMsgInterfaceImpl::*vec,
+                        void (Ns3AiMsgInterfaceImpl::*resize)(uint32_t))
+    {
+        Ns3AiSocketFrame frame;
+        while (true)
+        {
+            try
+            {
+                frame = GetSocket()->RecvFrame(m_waitMode, m_spinBudgetUs, &m_recvWaitStats);
+                break;
+            }
+            catch (const Ns3AiSocketClosed&)
+            {
+                if (!m_isCreator)
+                {
+                    throw;
+                }
+                // the next simulation connects again, like it would attach
+                // to the segment (e.g., when a Gym environment is reset)
+                m_listener->Release(m_lockableName);
+                m_socket.reset();
+            }
+        }
+        Ns3AiSocket* socket = GetSocket();
+        if (m_useVector)
+        {
+            (this->*resize)(frame.m_count);
+            V& v = *(this->*vec);
+            socket->RecvPayload(v.empty() ? nullptr : &v[0], uint64_t(frame.m_count) * sizeof(T));
+        }
+        else
+        {
+            if (frame.m_count != 1)
+            {
+                throw std::runtime_error("ns3-ai: unexpected frame on channel '" + m_lockableName +
+                                         "'");
+            }
+            socket->RecvPayload(this->*object, sizeof(T));
+        }
+        return frame.m_type;
+    };
+
+    /**
+     * Finds the objects again if the segment has grown
+     */
+    void Refresh()
+    {
+        if (m_segment->Refresh() != m_generation)
+        {
+            Attach();
+        }
+    };
+
     Cpp2PyMsgType* m_cpp2pyStruct;
     Py2CppMsgType* m_py2CppStruct;
     Cpp2PyMsgVector* m_cpp2pyVector;
     Py2CppMsgVector* m_py2cppVector;
 
+    std::shared_ptr<Ns3AiSegment> m_segment;
+    uint32_t m_generation;
     Ns3AiMsgSync* m_sync;
+    Ns3AiMsgStats* m_stats;
     const bool m_isCreator;
     const bool m_useVector;
     const bool m_handleFinish;
     const std::string m_segName;
+    const std::string m_cpp2pyMsgName;
+    const std::string m_py2cppMsgName;
+    const std::string m_lockableName;
+    const bool m_isSocket; //!< the segment name is a socket address
     bool m_isFinished;
+
+    Ns3AiSemaphore::WaitMode m_waitMode;
+    uint32_t m_spinBudgetUs;
+    Ns3AiWaitStats m_sendWaitStats;
+    Ns3AiWaitStats m_recvWaitStats;
+    uint64_t m_lastSendEnd; //!< when this side last sent, 0 once the reply arrived
+
+    std::unique_ptr<Ns3AiMsgLogWriter> m_log;
+    std::function<int64_t()> m_logClock;
+    std::function<void()> m_directHandler; //!< the embedded script's, if it registered one
+
+    static constexpr uint32_t SOCKET_CONNECT_TIMEOUT_MS = 30000;
+    static constexpr int SOCKET_POLL_MS = 10; //!< period of the cancellable waits
+    std::shared_ptr<Ns3AiSocketListener> m_listener; //!< the memory creator's
+    std::unique_ptr<Ns3AiSocket> m_socket;
 };
 
 /**
@@ -306,6 +1148,14 @@ class Ns3AiMsgInterfaceImpl
 class Ns3AiMsgInterface : public Singleton<Ns3AiMsgInterface>
 {
   public:
+    ~Ns3AiMsgInterface()
+    {
+        // the channels send their finish message, then the embedded
+        // script (if any) can end
+        m_channels.clear();
+        Ns3AiEmbeddedPython::Join(EMBEDDED_JOIN_TIMEOUT_MS);
+    };
+
     /**
      * Sets if this side (C++ or Python) is the memory creator.
      * Configuration on two sides must be different
@@ -335,18 +1185,98 @@ class Ns3AiMsgInterface : public Singleton<Ns3AiMsgInterface>
 
     /**
      * Sets shared memory segment size, only valid for
-     * the shared memory creator. Normally the default
-     * size is OK.
+     * the shared memory creator. By default (0) the size
+     * is computed from the message types, and the segment
+     * grows when vectors are resized.
      */
     void SetMemorySize(uint32_t size)
     {
         this->m_size = size;
     };
 
+    /**
+     * Sets how this side waits on the semaphores. By default the side
+     * which is not the memory creator adopts the creator's choice (busy
+     * spinning unless configured otherwise in Python).
+     * SPIN_THEN_SLEEP spins for at most spinBudgetUs microseconds and then
+     * sleeps, which frees the core while the other side is busy.
+     */
+    void SetWaitMode(Ns3AiSemaphore::WaitMode mode,
+                     uint32_t spinBudgetUs = Ns3AiSemaphore::DEFAULT_SPIN_BUDGET_US)
+    {
+        this->m_waitModeSet = true;
+        this->m_waitMode = mode;
+        this->m_spinBudgetUs = spinBudgetUs;
+    };
+
+    /**
+     * Sets whether the segment should be backed by transparent huge
+     * pages, see Ns3AiSegment::SetHugePages. For hugetlbfs, use a
+     * segment name which is a path on the hugetlbfs mount instead.
+     */
+    void SetHugePages(bool hugePages)
+    {
+        this->m_hugePages = hugePages;
+    };
+
+    /**
+     * Sets whether the message interfaces record statistics (see
+     * Ns3AiMsgInterfaceImpl::EnableStats), printed at CppSetFinished.
+     * They are also recorded if the Python side enables them.
+     */
+    void SetStats(bool stats)
+    {
+        this->m_stats = stats;
+    };
+
+    /**
+     * Pins this process (the simulation) to the given CPU, so that it
+     * stays close to the caches shared with the other side. Best with a
+     * sibling core of the Python process. Returns false if not supported.
+     */
+    bool SetCpuAffinity(int cpu)
+    {
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+        (void)cpu;
+        return false;
+#endif
+    };
+
+    /**
+     * Records the messages of the channels created from now on to a
+     * message log, with the simulation time (see
+     * Ns3AiMsgInterfaceImpl::StartRecording). Named channels use
+     * "<path>.<channelName>".
+     */
+    void SetRecordPath(const std::string& path)
+    {
+        this->m_recordPath = path;
+    };
+
+    /**
+     * Runs the Python side in this process instead of a separate one (see
+     * Ns3AiEmbeddedPython): the script is started when the first channel
+     * is created, and the channel is attached once the script has created
+     * it. The NS3AI_EMBEDDED_SCRIPT environment variable does the same
+     * without changing the program.
+     */
+    void SetEmbeddedScript(const std::string& script, const std::vector<std::string>& args = {})
+    {
+        this->m_embeddedScript = script;
+        this->m_embeddedArgs = args;
+    };
+
     /**
      * Sets the names of the named objects. See Boost's
      * documentation for details. Normally the default
-     * names are OK.
+     * names are OK. The NS3AI_SEGMENT_NAME environment variable, set by
+     * the Python side when it launches several simulations (each with its
+     * own segment), takes precedence over the segment name.
      */
     void SetNames(std::string segmentName,
                   std::string cpp2pyMsgName,
@@ -359,34 +1289,200 @@ class Ns3AiMsgInterface : public Singleton<Ns3AiMsgInterface>
         this->m_lockableName = lockableName;
     };
 
+    /**
+     * Gets the segment name used by the channels, after the
+     * NS3AI_SEGMENT_NAME override
+     */
+    std::string GetSegmentName() const
+    {
+        const char* segmentName = std::getenv("NS3AI_SEGMENT_NAME");
+        return segmentName && *segmentName ? segmentName : m_segmentName;
+    };
+
     /**
      * Gets the impl which has semaphore (synchronization)
-     * methods
+     * methods. It is the default channel, which uses the
+     * names set by SetNames as they are.
      */
     template <typename Cpp2PyMsgType, typename Py2CppMsgType>
     Ns3AiMsgInterfaceImpl<Cpp2PyMsgType, Py2CppMsgType>* GetInterface()
     {
-        static Ns3AiMsgInterfaceImpl<Cpp2PyMsgType, Py2CppMsgType> interface(
-            this->m_isMemoryCreator,
-            this->m_useVector,
-            this->m_handleFinish,
-            this->m_size,
-            this->m_segmentName.c_str(),
-            this->m_cpp2pyMsgName.c_str(),
-            this->m_py2cppMsgName.c_str(),
-            this->m_lockableName.c_str());
-        return &interface;
+        static Ns3AiMsgInterfaceImpl<Cpp2PyMsgType, Py2CppMsgType>* interface =
+            GetInterface<Cpp2PyMsgType, Py2CppMsgType>("");
+        return interface;
+    };
+
+    /**
+     * Gets the impl of a named channel. Channels with different names
+     * are independent mailboxes (possibly with different message types)
+     * in the same segment, their object names are prefixed with
+     * "<channelName>/". The channel is created (or attached) at the first
+     * call, with the configuration at that time.
+     */
+    template <typename Cpp2PyMsgType, typename Py2CppMsgType>
+    Ns3AiMsgInterfaceImpl<Cpp2PyMsgType, Py2CppMsgType>* GetInterface(
+        const std::string& channelName)
+    {
+        using Impl = Ns3AiMsgInterfaceImpl<Cpp2PyMsgType, Py2CppMsgType>;
+        return GetChannel<Impl>(channelName, [this, &channelName]() {
+            auto impl = std::make_shared<Impl>(
+                this->m_isMemoryCreator,
+                this->m_useVector,
+                this->m_handleFinish,
+                this->m_size,
+                this->m_segmentName.c_str(),
+                GetObjectName(channelName, this->m_cpp2pyMsgName).c_str(),
+                GetObjectName(channelName, this->m_py2cppMsgName).c_str(),
+                GetObjectName(channelName, this->m_lockableName).c_str());
+            if (this->m_waitModeSet)
+            {
+                impl->SetWaitMode(this->m_waitMode, this->m_spinBudgetUs);
+            }
+            if (this->m_hugePages)
+            {
+                impl->SetHugePages(true);
+            }
+            if (this->m_stats)
+            {
+                impl->EnableStats();
+            }
+            if (!this->m_recordPath.empty())
+            {
+                impl->StartRecording(GetRecordPath(channelName),
+                                     []() { return Simulator::Now().GetNanoSeconds(); });
+            }
+            impl->SetDirectHandler(Ns3AiEmbeddedPython::GetHandler(
+                GetObjectName(channelName, this->m_lockableName)));
+            return impl;
+        });
+    };
+
+    /**
+     * Sets the number of slots of the ring-buffer channel, only valid
+     * for the shared memory creator.
+     */
+    void SetRingCapacity(uint32_t capacity)
+    {
+        this->m_ringCapacity = capacity;
+    };
+
+    /**
+     * Gets the ring-buffer channel, a one-way (C++ to Python) stream
+     * of Cpp2PyMsgType messages. It uses the segment name, the C++ to
+     * Python message name and the lockable name set by SetNames.
+     */
+    template <typename Cpp2PyMsgType>
+    Ns3AiMsgRingImpl<Cpp2PyMsgType>* GetRingInterface()
+    {
+        static Ns3AiMsgRingImpl<Cpp2PyMsgType>* ring = GetRingInterface<Cpp2PyMsgType>("");
+        return ring;
+    };
+
+    /**
+     * Gets the ring-buffer channel with the given name, see
+     * GetInterface(channelName) for the naming of channels.
+     */
+    template <typename Cpp2PyMsgType>
+    Ns3AiMsgRingImpl<Cpp2PyMsgType>* GetRingInterface(const std::string& channelName)
+    {
+        using Impl = Ns3AiMsgRingImpl<Cpp2PyMsgType>;
+        return GetChannel<Impl>(channelName, [this, &channelName]() {
+            auto ring =
+                std::make_shared<Impl>(this->m_isMemoryCreator,
+                                       this->m_handleFinish,
+                                       this->m_ringCapacity,
+                                       this->m_size,
+                                       this->m_segmentName.c_str(),
+                                       GetObjectName(channelName, this->m_cpp2pyMsgName).c_str(),
+                                       GetObjectName(channelName, this->m_lockableName).c_str());
+            if (this->m_waitModeSet)
+            {
+                ring->SetWaitMode(this->m_waitMode, this->m_spinBudgetUs);
+            }
+            if (this->m_hugePages)
+            {
+                ring->SetHugePages(true);
+            }
+            return ring;
+        });
+    };
+
+  private:
+    /**
+     * A channel of any impl type, type-checked on lookup
+     */
+    struct Channel
+    {
+        std::type_index m_type;
+        std::shared_ptr<void> m_impl;
+    };
+
+    static std::string GetObjectName(const std::string& channelName, const std::string& name)
+    {
+        return channelName.empty() ? name : channelName + "/" + name;
+    };
+
+    std::string GetRecordPath(const std::string& channelName) const
+    {
+        return channelName.empty() ? m_recordPath : m_recordPath + "." + channelName;
+    };
+
+    /**
+     * Starts the embedded script, if one is configured and not started yet
+     */
+    void StartEmbeddedScript()
+    {
+        if (m_embeddedScript.empty())
+        {
+            const char* script = std::getenv("NS3AI_EMBEDDED_SCRIPT");
+            m_embeddedScript = script ? script : "";
+        }
+        if (!m_embeddedScript.empty() && !Ns3AiEmbeddedPython::IsStarted())
+        {
+            Ns3AiEmbeddedPython::Start(m_embeddedScript, m_embeddedArgs);
+        }
+    };
+
+    template <typename Impl, typename Factory>
+    Impl* GetChannel(const std::string& channelName, Factory create)
+    {
+        auto it = m_channels.find(channelName);
+        if (it == m_channels.end())
+        {
+            m_segmentName = GetSegmentName();
+            if (!m_isMemoryCreator)
+            {
+                Ns3AiLaunch::Park(m_segmentName);
+            }
+            StartEmbeddedScript();
+            it = m_channels.emplace(channelName, Channel{typeid(Impl), create()}).first;
+        }
+        NS_ABORT_MSG_IF(it->second.m_type != std::type_index(typeid(Impl)),
+                        "Channel '" << channelName << "' is used with different message types");
+        return static_cast<Impl*>(it->second.m_impl.get());
     };
 
   private:
+    static constexpr uint32_t EMBEDDED_JOIN_TIMEOUT_MS = 10000;
+
     bool m_isMemoryCreator;
     bool m_useVector;
     bool m_handleFinish;
-    uint32_t m_size = 4096;
+    uint32_t m_size = 0;
     std::string m_segmentName = "My Seg";
     std::string m_cpp2pyMsgName = "My Cpp to Python Msg";
     std::string m_py2cppMsgName = "My Python to Cpp Msg";
     std::string m_lockableName = "My Lockable";
+    bool m_waitModeSet = false;
+    Ns3AiSemaphore::WaitMode m_waitMode = Ns3AiSemaphore::SPIN;
+    uint32_t m_spinBudgetUs = Ns3AiSemaphore::DEFAULT_SPIN_BUDGET_US;
+    uint32_t m_ringCapacity = 64;
+    bool m_hugePages = false;
+    bool m_stats = false;
+    std::string m_recordPath;
+    std::string m_embeddedScript;
+    std::vector<std::string> m_embeddedArgs;
+    std::map<std::string, Channel> m_channels;
 };
 
 } // namespace ns3
@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:  Muyuan Shen <muyuan_shen@hust.edu.cn>
+ */
+
+#ifndef NS3_AI_MSG_LOG_H
+#define NS3_AI_MSG_LOG_H
+
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ns3
+{
+
+/**
+ * \brief Header of a message log, at the start of the file
+ */
+struct Ns3AiMsgLogHeader
+{
+    char m_magic[8];       //!< "NS3AILOG"
+    uint32_t m_version;    //!< format version, 1
+    uint32_t m_useVector;  //!< whether messages are vectors (1) or structs (0)
+    uint32_t m_cpp2pySize; //!< size of a C++ to Python message (or vector element)
+    uint32_t m_py2cppSize; //!< size of a Python to C++ message (or vector element)
+};
+
+/**
+ * \brief Header of a message in a log. It is followed by the m_count
+ * elements, padded to 8 bytes.
+ */
+struct Ns3AiMsgLogRecord
+{
+    // 0 marks the end, in a log not truncated (e.g., the simulation was killed)
+    enum Direction : uint32_t
+    {
+        CPP2PY = 1,
+        PY2CPP = 2,
+    };
+
+    uint32_t m_direction; //!< a Direction
+    uint32_t m_count;     //!< number of elements, 1 for a struct
+    int64_t m_timestamp;  //!< simulation time, in nanoseconds
+};
+
+/**
+ * \brief Appends messages to a log file, which is mapped in memory and
+ * grows by doubling. The file is truncated to its content when the
+ * writer is destroyed.
+ */
+class Ns3AiMsgLogWriter
+{
+  public:
+    Ns3AiMsgLogWriter(const std::string& path,
+                      bool useVector,
+                      uint32_t cpp2pySize,
+                      uint32_t py2cppSize)
+        : m_path(path),
+          m_data(nullptr),
+          m_capacity(0),
+          m_used(0)
+    {
+        m_fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (m_fd < 0)
+        {
+            throw std::runtime_error("ns3-ai: cannot create message log '" + path + "'");
+        }
+        Ns3AiMsgLogHeader header{};
+        std::memcpy(header.m_magic, MAGIC, sizeof(header.m_magic));
+        header.m_version = VERSION;
+        header.m_useVector = useVector;
+        header.m_cpp2pySize = cpp2pySize;
+        header.m_py2cppSize = py2cppSize;
+        Reserve(INITIAL_CAPACITY);
+        std::memcpy(m_data, &header, sizeof(header));
+        m_used = sizeof(header);
+    };
+
+    ~Ns3AiMsgLogWriter()
+    {
+        munmap(m_data, m_capacity);
+        // if it fails, the log ends with zeros, which readers ignore
+        int ret = ftruncate(m_fd, m_used);
+        (void)ret;
+        close(m_fd);
+    };
+
+    Ns3AiMsgLogWriter(const Ns3AiMsgLogWriter&) = delete;
+    Ns3AiMsgLogWriter& operator=(const Ns3AiMsgLogWriter&) = delete;
+
+    /**
+     * Appends a message of count elements of elementSize bytes
+     */
+    void Append(Ns3AiMsgLogRecord::Direction direction,
+                int64_t timestamp,
+                const void* data,
+                uint32_t count,
+                uint32_t elementSize)
+    {
+        uint64_t bytes = uint64_t(count) * elementSize;
+        uint64_t total = sizeof(Ns3AiMsgLogRecord) + GetPadded(bytes);
+        Reserve(m_used + total);
+        Ns3AiMsgLogRecord record{direction, count, timestamp};
+        std::memcpy(m_data + m_used, &record, sizeof(record));
+        if (bytes > 0)
+        {
+            std::memcpy(m_data + m_used + sizeof(record), data, bytes);
+        }
+        m_used += total;
+    };
+
+    static constexpr char MAGIC[9] = "NS3AILOG";
+    static constexpr uint32_t VERSION = 1;
+
+    static uint64_t GetPadded(uint64_t bytes)
+    {
+        return (bytes + 7) / 8 * 8;
+    };
+
+  private:
+    static constexpr uint64_t INITIAL_CAPACITY = 1 << 20;
+
+    /**
+     * Makes the file and its mapping at least size bytes long
+     */
+    void Reserve(uint64_t size)
+    {
+        if (size <= m_capacity)
+        {
+            return;
+        }
+        uint64_t capacity = m_capacity ? m_capacity : INITIAL_CAPACITY;
+        while (capacity < size)
+        {
+            capacity *= 2;
+        }
+        if (m_data)
+        {
+            munmap(m_data, m_capacity);
+        }
+        void* data = MAP_FAILED;
+        if (ftruncate(m_fd, capacity) == 0)
+        {
+            data = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+        }
+        if (data == MAP_FAILED)
+        {
+            throw std::runtime_error("ns3-ai: cannot grow message log '" + m_path + "'");
+        }
+        m_data = static_cast<uint8_t*>(data);
+        m_capacity = capacity;
+    };
+
+    const std::string m_path;
+    int m_fd;
+    uint8_t* m_data;
+    uint64_t m_capacity;
+    uint64_t m_used;
+};
+
+/**
+ * \brief Reads the messages of a log file, mapped in memory
+ */
+class Ns3AiMsgLogReader
+{
+  public:
+    explicit Ns3AiMsgLogReader(const std::string& path)
+        : m_data(nullptr),
+          m_size(0),
+          m_offset(sizeof(Ns3AiMsgLogHeader))
+    {
+        int fd = open(path.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0 || uint64_t(st.st_size) < sizeof(Ns3AiMsgLogHeader))
+        {
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+            throw std::runtime_error("ns3-ai: cannot read message log '" + path + "'");
+        }
+        m_size = st.st_size;
+        void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED)
+        {
+            throw std::runtime_error("ns3-ai: cannot map message log '" + path + "'");
+        }
+        m_data = static_cast<const uint8_t*>(data);
+        if (std::memcmp(GetHeader().m_magic, Ns3AiMsgLogWriter::MAGIC, 8) != 0 ||
+            GetHeader().m_version != Ns3AiMsgLogWriter::VERSION)
+        {
+            munmap(const_cast<uint8_t*>(m_data), m_size);
+            throw std::runtime_error("ns3-ai: '" + path + "' is not a message log");
+        }
+    };
+
+    ~Ns3AiMsgLogReader()
+    {
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+    };
+
+    Ns3AiMsgLogReader(const Ns3AiMsgLogReader&) = delete;
+    Ns3AiMsgLogReader& operator=(const Ns3AiMsgLogReader&) = delete;
+
+    const Ns3AiMsgLogHeader& GetHeader() const
+    {
+        return *reinterpret_cast<const Ns3AiMsgLogHeader*>(m_data);
+    };
+
+    /**
+     * Gets the next message, and a pointer to its elements. Returns false
+     * at the end of the log.
+     */
+    bool Next(Ns3AiMsgLogRecord& record, const uint8_t*& data)
+    {
+        if (m_offset + sizeof(Ns3AiMsgLogRecord) > m_size)
+        {
+            return false;
+        }
+        std::memcpy(&record, m_data + m_offset, sizeof(record));
+        if (record.m_direction != Ns3AiMsgLogRecord::CPP2PY &&
+            record.m_direction != Ns3AiMsgLogRecord::PY2CPP)
+        {
+            return false;
+        }
+        uint32_t elementSize = record.m_direction == Ns3AiMsgLogRecord::CPP2PY
+                                   ? GetHeader().m_cpp2pySize
+                                   : GetHeader().m_py2cppSize;
+        uint64_t bytes = uint64_t(record.m_count) * elementSize;
+        if (m_offset + sizeof(record) + bytes > m_size)
+        {
+            return false;
+        }
+        data = m_data + m_offset + sizeof(record);
+        m_offset += sizeof(record) + Ns3AiMsgLogWriter::GetPadded(bytes);
+        return true;
+    };
+
+    /**
+     * Goes back to the first message
+     */
+    void Rewind()
+    {
+        m_offset = sizeof(Ns3AiMsgLogHeader);
+    };
+
+  private:
+    const uint8_t* m_data;
+    uint64_t m_size;
+    uint64_t m_offset;
+};
+
+} // namespace ns3
+
+#endif // NS3_AI_MSG_LOG_H
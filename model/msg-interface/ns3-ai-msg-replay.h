@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:  Muyuan Shen <muyuan_shen@hust.edu.cn>
+ */
+
+#ifndef NS3_AI_MSG_REPLAY_H
+#define NS3_AI_MSG_REPLAY_H
+
+#include "ns3-ai-msg-interface.h"
+#include "ns3-ai-msg-log.h"
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace ns3
+{
+
+/**
+ * \brief Plays the C++ side of a recorded channel (see
+ * Ns3AiMsgInterfaceImpl::StartRecording) without the simulation: the
+ * recorded messages are sent to Python as fast as it reads them, and
+ * Python's replies are received and dropped. Python runs unmodified, it
+ * only has to create the shared memory as usual.
+ *
+ * The messages are played in a separate thread, so that it can be
+ * started from the process which runs the Python side.
+ */
+template <typename Cpp2PyMsgType, typename Py2CppMsgType>
+class Ns3AiMsgReplayer
+{
+  public:
+    typedef Ns3AiMsgInterfaceImpl<Cpp2PyMsgType, Py2CppMsgType> Interface;
+
+    Ns3AiMsgReplayer() = delete;
+    Ns3AiMsgReplayer(const Ns3AiMsgReplayer&) = delete;
+    Ns3AiMsgReplayer& operator=(const Ns3AiMsgReplayer&) = delete;
+
+    /**
+     * Opens the log and attaches to the channel created by Python, whose
+     * message types must be the recorded ones. If handle_finish, the
+     * channel is finished after the last message.
+     */
+    Ns3AiMsgReplayer(const std::string& path,
+                     bool use_vector,
+                     bool handle_finish,
+                     const char* segment_name = "My Seg",
+                     const char* cpp2py_msg_name = "My Cpp to Python Msg",
+                     const char* py2cpp_msg_name = "My Python to Cpp Msg",
+                     const char* lockable_name = "My Lockable")
+        : m_state(std::make_shared<State>(path))
+    {
+        const Ns3AiMsgLogHeader& header = m_state->m_log.GetHeader();
+        if (bool(header.m_useVector) != use_vector ||
+            header.m_cpp2pySize != sizeof(Cpp2PyMsgType) ||
+            header.m_py2cppSize != sizeof(Py2CppMsgType))
+        {
+            throw std::runtime_error("ns3-ai: message log '" + path +
+                                     "' was recorded with other message types");
+        }
+        m_state->m_interface = std::make_unique<Interface>(false,
+                                                           use_vector,
+                                                           handle_finish,
+                                                           0,
+                                                           segment_name,
+                                                           cpp2py_msg_name,
+                                                           py2cpp_msg_name,
+                                                           lockable_name);
+    };
+
+    ~Ns3AiMsgReplayer()
+    {
+        if (!m_thread.joinable())
+        {
+            return;
+        }
+        if (m_state->m_isFinished)
+        {
+            m_thread.join();
+        }
+        else
+        {
+            // blocked on Python, which gave up: the thread keeps the state alive
+            m_thread.detach();
+        }
+    };
+
+    /**
+     * Starts playing the messages
+     */
+    void Start()
+    {
+        if (m_thread.joinable())
+        {
+            throw std::runtime_error("ns3-ai: replay already started");
+        }
+        std::shared_ptr<State> state = m_state;
+        m_thread = std::thread([state]() { Play(*state); });
+    };
+
+    /**
+     * Gets whether all the messages were played (and the channel finished)
+     */
+    bool IsFinished() const
+    {
+        return m_state->m_isFinished;
+    };
+
+    /**
+     * Gets the number of messages played so far, in both directions
+     */
+    uint64_t GetNumMessages() const
+    {
+        return m_state->m_numMessages;
+    };
+
+  private:
+    struct State
+    {
+        explicit State(const std::string& path)
+            : m_log(path),
+              m_numMessages(0),
+              m_isFinished(false)
+        {
+        }
+
+        Ns3AiMsgLogReader m_log;
+        std::unique_ptr<Interface> m_interface;
+        std::atomic<uint64_t> m_numMessages;
+        std::atomic<bool> m_isFinished;
+    };
+
+    static void Play(State& state)
+    {
+        Interface& interface = *state.m_interface;
+        Ns3AiMsgLogRecord record;
+        const uint8_t* data;
+        while (state.m_log.Next(record, data))
+        {
+            if (record.m_direction == Ns3AiMsgLogRecord::CPP2PY)
+            {
+                interface.CppSendBegin();
+                if (interface.IsUsingVector())
+                {
+                    interface.ResizeCpp2PyVector(record.m_count);
+                    if (record.m_count > 0)
+                    {
+                        std::memcpy(&(*interface.GetCpp2PyVector())[0],
+                                    data,
+                                    record.m_count * sizeof(Cpp2PyMsgType));
+                    }
+                }
+                else
+                {
+                    std::memcpy(interface.GetCpp2PyStruct(), data, sizeof(Cpp2PyMsgType));
+                }
+                interface.CppSendEnd();
+            }
+            else
+            {
+                interface.CppRecvBegin();
+                interface.CppRecvEnd();
+            }
+            ++state.m_numMessages;
+        }
+        // detaching sends the finish message, if the channel handles it
+        state.m_interface.reset();
+        state.m_isFinished = true;
+    };
+
+    std::shared_ptr<State> m_state;
+    std::thread m_thread;
+};
+
+} // namespace ns3
+
+#endif // NS3_AI_MSG_REPLAY_H
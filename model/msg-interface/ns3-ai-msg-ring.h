@@ -0,0 +1,404 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:  Muyuan Shen <muyuan_shen@hust.edu.cn>
+ */
+
+#ifndef NS3_AI_MSG_RING_H
+#define NS3_AI_MSG_RING_H
+
+#include "ns3-ai-segment.h"
+#include "ns3-ai-semaphore.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <boost/interprocess/managed_shared_memory.hpp>
+
+#define NS3AI_CACHE_LINE_SIZE 64
+
+namespace ns3
+{
+
+/**
+ * \brief Indices and wait state of the ring-buffer channel, placed in the
+ * shared segment. The producer and the consumer indices are one cache line
+ * apart, so that the two sides do not steal each other's line at every message.
+ */
+struct Ns3AiMsgRingSync
+{
+    volatile uint32_t m_head{0}; //!< number of slots published by C++ (producer)
+    Ns3AiFutex m_headFutex;      //!< Python parks here while the ring is empty
+    uint8_t m_pad0[NS3AI_CACHE_LINE_SIZE - sizeof(uint32_t) - sizeof(Ns3AiFutex)];
+    volatile uint32_t m_tail{0}; //!< number of slots consumed by Python (consumer)
+    Ns3AiFutex m_tailFutex;      //!< C++ parks here while the ring is full
+    uint8_t m_pad1[NS3AI_CACHE_LINE_SIZE - sizeof(uint32_t) - sizeof(Ns3AiFutex)];
+    uint32_t m_capacity{0};
+    volatile bool m_isFinished{false};
+    uint8_t m_waitMode{Ns3AiSemaphore::SPIN};
+    uint32_t m_spinBudgetUs{Ns3AiSemaphore::DEFAULT_SPIN_BUDGET_US};
+};
+
+/**
+ * \brief A one-way (C++ to Python) channel implemented as a lock-free
+ * single-producer/single-consumer ring of Cpp2PyMsgType slots.
+ *
+ * Unlike Ns3AiMsgInterfaceImpl, which is a single-slot mailbox, C++ can
+ * publish up to 'capacity' messages before Python consumes any, and only
+ * blocks when the ring is full. Python drains all available messages at
+ * once. Suited for telemetry streams which need no reply.
+ */
+template <typename Cpp2PyMsgType>
+class Ns3AiMsgRingImpl
+{
+  public:
+    Ns3AiMsgRingImpl() = delete;
+
+    /**
+     * \param is_memory_creator whether this side creates the segment
+     * \param handle_finish whether C++ marks the ring as finished when destroyed
+     * \param capacity number of slots, only used by the memory creator
+     * \param size segment size, computed from the capacity if 0
+     */
+    explicit Ns3AiMsgRingImpl(bool is_memory_creator,
+                              bool handle_finish,
+                              uint32_t capacity,
+                              uint32_t size = 0,
+                              const char* segment_name = "My Seg",
+                              const char* slots_name = "My Cpp to Python Msg",
+                              const char* lockable_name = "My Lockable")
+        : m_isCreator(is_memory_creator),
+          m_handleFinish(handle_finish),
+          m_segName(segment_name),
+          m_slotsName(slots_name),
+          m_lockableName(lockable_name),
+          m_head(0),
+          m_headSlot(0),
+          m_cachedTail(0),
+          m_tail(0),
+          m_tailSlot(0),
+          m_cachedHead(0),
+          m_batch(0),
+          m_isFinished(false)
+    {
+        uint64_t nameLength = std::max(m_slotsName.size(), m_lockableName.size());
+        m_segment = Ns3AiSegment::Open(m_segName,
+                                       m_isCreator,
+                                       size > 0 ? size
+                                                : Ns3AiSegment::GetSegmentSize(
+                                                      GetObjectBytes(capacity, nameLength)));
+        Ns3AiSegment::Lock lock = m_segment->LockSegment();
+        if (m_isCreator)
+        {
+            assert(capacity > 0 && capacity <= (1U << 31));
+            // grows the segment if it already holds other channels
+            m_segment->Reserve(GetObjectBytes(capacity, nameLength));
+        }
+        // the slots never move, so this mapping stays valid if the segment grows
+        Ns3AiSegment::Manager* segment = m_segment->Get();
+        if (m_isCreator)
+        {
+            m_slots = segment->construct<Cpp2PyMsgType>(slots_name)[capacity]();
+            m_sync = segment->construct<Ns3AiMsgRingSync>(lockable_name)();
+            m_sync->m_capacity = capacity;
+        }
+        else
+        {
+            m_slots = segment->find<Cpp2PyMsgType>(slots_name).first;
+            m_sync = segment->find<Ns3AiMsgRingSync>(lockable_name).first;
+            if (!m_slots || !m_sync)
+            {
+                throw std::runtime_error("ns3-ai: ring '" + m_lockableName +
+                                         "' not found in segment '" + m_segName +
+                                         "', was it created by the other side?");
+            }
+        }
+        m_capacity = m_sync->m_capacity;
+        m_waitMode = static_cast<Ns3AiSemaphore::WaitMode>(m_sync->m_waitMode);
+        m_spinBudgetUs = m_sync->m_spinBudgetUs;
+    };
+
+    ~Ns3AiMsgRingImpl()
+    {
+        if (m_isCreator)
+        {
+            // the segment may outlive this ring, so free the ring's objects
+            Ns3AiSegment::Lock lock = m_segment->LockSegment();
+            m_segment->Get()->destroy<Cpp2PyMsgType>(m_slotsName.c_str());
+            m_segment->Get()->destroy<Ns3AiMsgRingSync>(m_lockableName.c_str());
+        }
+        else
+        {
+            if (m_handleFinish)
+            {
+                CppSetFinished();
+            }
+        }
+    };
+
+    /**
+     * Gets the segment size needed by a ring with this number of slots
+     */
+    static uint64_t GetRequiredSize(uint32_t capacity)
+    {
+        return Ns3AiSegment::GetSegmentSize(GetObjectBytes(capacity));
+    };
+
+    /**
+     * Asks for the segment to be backed by transparent huge pages, see
+     * Ns3AiSegment::SetHugePages. Returns false if not supported.
+     */
+    bool SetHugePages(bool enable)
+    {
+        return m_segment->SetHugePages(enable);
+    };
+
+    /**
+     * Gets the number of slots in the ring
+     */
+    uint32_t GetCapacity() const
+    {
+        return m_capacity;
+    };
+
+    // for C++ side (producer):
+
+    /**
+     * C++ side waits for a free slot and returns it for writing. Only
+     * blocks if Python has not consumed any of the 'capacity' previous
+     * messages.
+     */
+    Cpp2PyMsgType* CppSendBegin()
+    {
+        Ns3AiSemaphore::wait_until(
+            [this]() {
+                if (m_head - m_cachedTail < m_capacity)
+                {
+                    return true;
+                }
+                m_cachedTail = Ns3AiSemaphore::atomic_read32(&m_sync->m_tail);
+                return m_head - m_cachedTail < m_capacity;
+            },
+            &m_sync->m_tailFutex,
+            m_waitMode,
+            m_spinBudgetUs,
+            &m_sendWaitStats);
+        return &m_slots[m_headSlot];
+    };
+
+    /**
+     * Non-blocking CppSendBegin. Returns a free slot, or nullptr if the
+     * ring is full (then the message can be dropped or sent later).
+     */
+    Cpp2PyMsgType* CppTrySendBegin()
+    {
+        if (m_head - m_cachedTail >= m_capacity)
+        {
+            m_cachedTail = Ns3AiSemaphore::atomic_read32(&m_sync->m_tail);
+            if (m_head - m_cachedTail >= m_capacity)
+            {
+                return nullptr;
+            }
+        }
+        return &m_slots[m_headSlot];
+    };
+
+    /**
+     * C++ side publishes the slot obtained with CppSendBegin
+     * or CppTrySendBegin
+     */
+    void CppSendEnd()
+    {
+        m_headSlot = m_headSlot + 1 == m_capacity ? 0 : m_headSlot + 1;
+        Ns3AiSemaphore::atomic_write32(&m_sync->m_head, ++m_head);
+        Ns3AiSemaphore::notify(&m_sync->m_headFutex);
+    };
+
+    /**
+     * C++ side copies a message into the ring
+     */
+    void CppSend(const Cpp2PyMsgType& msg)
+    {
+        *CppSendBegin() = msg;
+        CppSendEnd();
+    };
+
+    /**
+     * C++ side marks the stream as finished. Python receives the
+     * remaining messages and then an empty batch.
+     */
+    void CppSetFinished()
+    {
+        assert(m_handleFinish);
+        m_isFinished = true;
+        __sync_synchronize();
+        m_sync->m_isFinished = true;
+        __sync_synchronize();
+        Ns3AiSemaphore::notify(&m_sync->m_headFutex);
+    };
+
+    // for Python side (consumer):
+
+    /**
+     * Python side waits until at least one message is available, and
+     * starts reading up to maxCount messages at once. Returns the number
+     * of messages in the batch, which is zero only when C++ has finished
+     * and the ring is drained.
+     */
+    uint32_t PyRecvBatchBegin(uint32_t maxCount)
+    {
+        assert(m_batch == 0);
+        bool finished = false;
+        Ns3AiSemaphore::wait_until(
+            [this, &finished]() {
+                if (m_cachedHead != m_tail)
+                {
+                    return true;
+                }
+                // check the flag before the index: messages published
+                // before finishing must not be missed
+                finished = m_sync->m_isFinished;
+                __sync_synchronize();
+                m_cachedHead = Ns3AiSemaphore::atomic_read32(&m_sync->m_head);
+                return m_cachedHead != m_tail || finished;
+            },
+            &m_sync->m_headFutex,
+            m_waitMode,
+            m_spinBudgetUs,
+            &m_recvWaitStats);
+        uint32_t available = m_cachedHead - m_tail;
+        if (available == 0 && finished)
+        {
+            m_isFinished = true;
+        }
+        m_batch = available < maxCount ? available : maxCount;
+        return m_batch;
+    };
+
+    /**
+     * Python side gets the i-th message of the current batch
+     */
+    Cpp2PyMsgType* PyGetSlot(uint32_t i)
+    {
+        assert(i < m_batch);
+        uint32_t slot = m_tailSlot + i;
+        return &m_slots[slot >= m_capacity ? slot - m_capacity : slot];
+    };
+
+    /**
+     * Python side stops reading, and frees the slots of the current batch
+     */
+    void PyRecvBatchEnd()
+    {
+        m_tail += m_batch;
+        m_tailSlot += m_batch;
+        if (m_tailSlot >= m_capacity)
+        {
+            m_tailSlot -= m_capacity;
+        }
+        m_batch = 0;
+        Ns3AiSemaphore::atomic_write32(&m_sync->m_tail, m_tail);
+        Ns3AiSemaphore::notify(&m_sync->m_tailFutex);
+    };
+
+    /**
+     * Python side gets whether C++ has finished and all messages are consumed
+     */
+    bool PyGetFinished()
+    {
+        assert(m_handleFinish);
+        return m_isFinished;
+    };
+
+    // wait mode and statistics, for both sides:
+
+    /**
+     * Sets how this side waits, see Ns3AiMsgInterfaceImpl::SetWaitMode
+     */
+    void SetWaitMode(Ns3AiSemaphore::WaitMode mode,
+                     uint32_t spinBudgetUs = Ns3AiSemaphore::DEFAULT_SPIN_BUDGET_US)
+    {
+        m_waitMode = mode;
+        m_spinBudgetUs = spinBudgetUs;
+        if (m_isCreator)
+        {
+            m_sync->m_waitMode = mode;
+            m_sync->m_spinBudgetUs = spinBudgetUs;
+        }
+    };
+
+    /**
+     * Gets the statistics of waiting for a free slot (C++ side)
+     */
+    const Ns3AiWaitStats& GetSendWaitStats() const
+    {
+        return m_sendWaitStats;
+    };
+
+    /**
+     * Gets the statistics of waiting for messages (Python side)
+     */
+    const Ns3AiWaitStats& GetRecvWaitStats() const
+    {
+        return m_recvWaitStats;
+    };
+
+  private:
+    static uint64_t GetObjectBytes(uint32_t capacity,
+                                   uint64_t nameLength = Ns3AiSegment::DEFAULT_NAME_LENGTH)
+    {
+        return Ns3AiSegment::GetObjectSize(uint64_t(capacity) * sizeof(Cpp2PyMsgType),
+                                           nameLength) +
+               Ns3AiSegment::GetObjectSize(sizeof(Ns3AiMsgRingSync), nameLength);
+    };
+
+    std::shared_ptr<Ns3AiSegment> m_segment;
+    Cpp2PyMsgType* m_slots;
+    Ns3AiMsgRingSync* m_sync;
+    uint32_t m_capacity;
+
+    const bool m_isCreator;
+    const bool m_handleFinish;
+    const std::string m_segName;
+    const std::string m_slotsName;
+    const std::string m_lockableName;
+
+    // producer-local state, m_cachedTail avoids reading the shared tail
+    // until the ring looks full. The counters wrap at 2^32, which is not
+    // a multiple of every capacity, so the slot index is kept apart.
+    uint32_t m_head;
+    uint32_t m_headSlot; //!< m_head modulo the capacity
+    uint32_t m_cachedTail;
+    // consumer-local state, m_cachedHead avoids reading the shared head
+    // until the ring looks empty
+    uint32_t m_tail;
+    uint32_t m_tailSlot; //!< m_tail modulo the capacity
+    uint32_t m_cachedHead;
+    uint32_t m_batch;
+    bool m_isFinished;
+
+    Ns3AiSemaphore::WaitMode m_waitMode;
+    uint32_t m_spinBudgetUs;
+    Ns3AiWaitStats m_sendWaitStats;
+    Ns3AiWaitStats m_recvWaitStats;
+};
+
+} // namespace ns3
+
+#endif // NS3_AI_MSG_RING_H
@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:  Muyuan Shen <muyuan_shen@hust.edu.cn>
+ */
+
+#ifndef NS3_AI_MSG_STATS_H
+#define NS3_AI_MSG_STATS_H
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+
+namespace ns3
+{
+
+/**
+ * \brief Histogram of durations in nanoseconds, with log-linear buckets:
+ * each power of two is split into 8 linear buckets, so the relative error
+ * is below 12.5%. Fixed size and no allocation, so it can live in shared
+ * memory and be updated on the hot path.
+ */
+class Ns3AiHistogram
+{
+  public:
+    static constexpr uint32_t SUB_BUCKETS = 8;   //!< linear buckets per power of two
+    static constexpr uint32_t MAX_BITS = 40;     //!< larger values (> 18 minutes) are clamped
+    static constexpr uint32_t NUM_BUCKETS = (MAX_BITS - 2) * SUB_BUCKETS;
+
+    /**
+     * Adds a duration, in nanoseconds
+     */
+    void Record(uint64_t ns)
+    {
+        ++m_counts[GetBucket(ns)];
+        ++m_count;
+        m_sum += ns;
+        m_min = ns < m_min ? ns : m_min;
+        m_max = ns > m_max ? ns : m_max;
+    };
+
+    uint64_t GetCount() const
+    {
+        return m_count;
+    };
+
+    /**
+     * Gets the sum of the durations, in nanoseconds
+     */
+    uint64_t GetSum() const
+    {
+        return m_sum;
+    };
+
+    /**
+     * Gets an approximation of the given percentile (0 to 100), the middle
+     * of the bucket which contains it
+     */
+    uint64_t GetPercentile(double percentile) const
+    {
+        if (m_count == 0)
+        {
+            return 0;
+        }
+        uint64_t rank = static_cast<uint64_t>(percentile / 100 * (m_count - 1)) + 1;
+        uint64_t seen = 0;
+        for (uint32_t i = 0; i < NUM_BUCKETS; ++i)
+        {
+            seen += m_counts[i];
+            if (seen >= rank)
+            {
+                uint64_t mid = (GetLowerBound(i) + GetLowerBound(i + 1)) / 2;
+                return mid < m_min ? m_min : (mid > m_max ? m_max : mid);
+            }
+        }
+        return m_max;
+    };
+
+    /**
+     * Gets count, mean, min, max and usual percentiles (in nanoseconds),
+     * keyed by name
+     */
+    std::map<std::string, double> ToMap() const
+    {
+        return {{"count", m_count},
+                {"mean_ns", m_count ? double(m_sum) / m_count : 0},
+                {"min_ns", m_count ? m_min : 0},
+                {"max_ns", m_max},
+                {"p50_ns", GetPercentile(50)},
+                {"p90_ns", GetPercentile(90)},
+                {"p99_ns", GetPercentile(99)},
+                {"p999_ns", GetPercentile(99.9)}};
+    };
+
+    /**
+     * Gets the lower bound (in nanoseconds) of bucket i
+     */
+    static uint64_t GetLowerBound(uint32_t i)
+    {
+        if (i < SUB_BUCKETS)
+        {
+            return i;
+        }
+        uint32_t msb = i / SUB_BUCKETS + 2;
+        return (uint64_t(SUB_BUCKETS + i % SUB_BUCKETS)) << (msb - 3);
+    };
+
+    /**
+     * Gets the number of values recorded in bucket i
+     */
+    uint64_t GetBucketCount(uint32_t i) const
+    {
+        return m_counts[i];
+    };
+
+  private:
+    static uint32_t GetBucket(uint64_t ns)
+    {
+        if (ns < SUB_BUCKETS)
+        {
+            return ns;
+        }
+        uint32_t msb = 63 - __builtin_clzll(ns);
+        if (msb >= MAX_BITS)
+        {
+            return NUM_BUCKETS - 1;
+        }
+        return (msb - 2) * SUB_BUCKETS + ((ns >> (msb - 3)) & (SUB_BUCKETS - 1));
+    };
+
+    uint64_t m_counts[NUM_BUCKETS]{};
+    uint64_t m_count{0};
+    uint64_t m_sum{0};
+    uint64_t m_min{UINT64_MAX};
+    uint64_t m_max{0};
+};
+
+/**
+ * \brief Statistics of one direction of a channel (C++ to Python, or
+ * Python to C++). The sender updates the send fields and the receiver
+ * the receive fields, so no synchronization is needed.
+ */
+struct Ns3AiMsgDirectionStats
+{
+    uint64_t m_messages{0};     //!< messages sent
+    uint64_t m_payloadBytes{0}; //!< payload bytes sent (struct size, or vector size)
+    Ns3AiHistogram m_sendWait;  //!< time the sender waited in SendBegin
+    Ns3AiHistogram m_recvWait;  //!< time the receiver waited in RecvBegin
+    Ns3AiHistogram m_roundTrip; //!< time from the sender's SendEnd to its next RecvBegin returning
+};
+
+/**
+ * \brief Statistics of a channel, in shared memory so that both sides
+ * can read them
+ */
+struct Ns3AiMsgStats
+{
+    Ns3AiMsgDirectionStats m_cpp2py;
+    Ns3AiMsgDirectionStats m_py2cpp;
+
+    /**
+     * Gets a steady timestamp in nanoseconds
+     */
+    static uint64_t Now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    };
+
+    /**
+     * Gets all the statistics keyed by name, convenient for Python bindings
+     */
+    std::map<std::string, std::map<std::string, double>> ToMap() const
+    {
+        std::map<std::string, std::map<std::string, double>> ret;
+        for (auto dir : {std::make_pair("cpp2py", &m_cpp2py), std::make_pair("py2cpp", &m_py2cpp)})
+        {
+            std::string name(dir.first);
+            ret[name] = {{"messages", dir.second->m_messages},
+                         {"payload_bytes", dir.second->m_payloadBytes}};
+            ret[name + ".send_wait"] = dir.second->m_sendWait.ToMap();
+            ret[name + ".recv_wait"] = dir.second->m_recvWait.ToMap();
+            ret[name + ".round_trip"] = dir.second->m_roundTrip.ToMap();
+        }
+        return ret;
+    };
+
+    /**
+     * Prints a summary, in microseconds
+     */
+    void Print(std::ostream& os) const
+    {
+        for (const auto& item : ToMap())
+        {
+            os << "  " << item.first << ":";
+            for (const auto& value : item.second)
+            {
+                bool isTime = value.first.size() > 3 &&
+                              value.first.compare(value.first.size() - 3, 3, "_ns") == 0;
+                if (isTime)
+                {
+                    os << " " << value.first.substr(0, value.first.size() - 3) << "_us "
+                       << value.second / 1000;
+                }
+                else
+                {
+                    os << " " << value.first << " " << uint64_t(value.second);
+                }
+            }
+            os << "\n";
+        }
+    };
+};
+
+} // namespace ns3
+
+#endif // NS3_AI_MSG_STATS_H
@@ -0,0 +1,470 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:  Muyuan Shen <muyuan_shen@hust.edu.cn>
+ */
+
+#ifndef NS3_AI_SEGMENT_H
+#define NS3_AI_SEGMENT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/statvfs.h>
+#include <type_traits>
+#include <unistd.h>
+#include <vector>
+#include <boost/interprocess/managed_external_buffer.hpp>
+#include <boost/interprocess/managed_mapped_file.hpp>
+#include <boost/interprocess/managed_shared_memory.hpp>
+#include <boost/interprocess/sync/interprocess_recursive_mutex.hpp>
+#include <boost/interprocess/sync/scoped_lock.hpp>
+
+namespace ns3
+{
+
+/**
+ * \brief Segment-wide state, the first named object of every segment
+ */
+struct Ns3AiSegmentInfo
+{
+    pid_t m_owner;                  //!< pid of the creator process
+    volatile uint32_t m_generation; //!< incremented each time the segment grows
+    //! serializes growing the segment with allocations and remapping, see Ns3AiSegment::Lock
+    boost::interprocess::interprocess_recursive_mutex m_mutex;
+};
+
+/**
+ * \brief A managed shared memory segment, shared by all the channels
+ * (message interfaces and rings) of this process that use the same name.
+ *
+ * The segment is mapped once per process. If this process created it,
+ * the segment is removed when the last channel using it is destroyed.
+ * The creator's pid is stored in the segment, so that a stale segment
+ * left by a crashed run is replaced, but not one created by this process.
+ *
+ * If the name is an absolute path, the segment is a file mapped in memory
+ * instead of a POSIX shared memory object. A file on a hugetlbfs mount
+ * (e.g., /dev/hugepages/ns3ai) gives a segment backed by huge pages. The
+ * sizes are then rounded up to the huge page size.
+ *
+ * The segment can grow while both sides are attached. The side which
+ * grows it must do so at a synchronization point of the channel it grows
+ * for, i.e., while the other side waits (e.g., between CppSendBegin and
+ * CppSendEnd). The other side maps the grown segment again when it calls
+ * Refresh, which the channels do at every Begin. Previous mappings are
+ * kept until the segment is released, so that pointers obtained before
+ * (e.g., NumPy views) stay valid.
+ *
+ * Boost's grow must not run while any process uses the segment manager,
+ * and other channels of the segment do not wait at that synchronization
+ * point. Growing, remapping, and every use of the segment manager
+ * (constructing, finding or destroying named objects, and allocating
+ * vector storage) therefore hold the segment's lock (see LockSegment).
+ * Accessing existing objects does not: growing never moves them.
+ */
+class Ns3AiSegment
+{
+  public:
+    typedef boost::interprocess::managed_shared_memory::segment_manager Manager;
+    static_assert(
+        std::is_same<Manager, boost::interprocess::managed_mapped_file::segment_manager>::value,
+        "shared memory and mapped file segments must be interchangeable");
+    typedef boost::interprocess::scoped_lock<boost::interprocess::interprocess_recursive_mutex>
+        Lock;
+
+    Ns3AiSegment() = delete;
+    Ns3AiSegment(const Ns3AiSegment&) = delete;
+    Ns3AiSegment& operator=(const Ns3AiSegment&) = delete;
+
+    ~Ns3AiSegment()
+    {
+        if (m_isCreator)
+        {
+            Remove();
+        }
+    };
+
+    /**
+     * Bytes used by the segment itself, not counting the named objects
+     */
+    static constexpr uint64_t SEGMENT_OVERHEAD = 1024;
+
+    /**
+     * Name length assumed by GetObjectSize when the name is not known
+     */
+    static constexpr uint64_t DEFAULT_NAME_LENGTH = 64;
+
+    /**
+     * Bytes needed to store a named object (or array) of the given size
+     * and name length: Boost's headers, the name, and the padding to the
+     * alignment of the object and of Boost's allocations. The headers are
+     * measured once, by constructing an object in a scratch segment
+     * managed as the real ones.
+     */
+    static uint64_t GetObjectSize(uint64_t bytes, uint64_t nameLength = DEFAULT_NAME_LENGTH)
+    {
+        static const uint64_t header = MeasureObjectHeader();
+        const uint64_t unit = Manager::memory_algorithm::Alignment;
+        return (header + bytes + nameLength + alignof(std::max_align_t) + unit - 1) / unit * unit;
+    };
+
+    /**
+     * Size of a segment holding named objects of objectBytes bytes in
+     * total (as counted by GetObjectSize), rounded up to whole pages
+     */
+    static uint64_t GetSegmentSize(uint64_t objectBytes)
+    {
+        if (objectBytes > std::numeric_limits<uint64_t>::max() - SEGMENT_OVERHEAD - 4095)
+        {
+            throw std::overflow_error("ns3-ai: segment size overflows");
+        }
+        return (SEGMENT_OVERHEAD + objectBytes + 4095) / 4096 * 4096;
+    };
+
+    /**
+     * Gets the segment with the given name. If it is already mapped in
+     * this process it is reused, otherwise it is created (removing any
+     * stale segment with the same name) or opened.
+     *
+     * \param name name of the segment, or path of the file to map
+     * \param create whether this side is the memory creator
+     * \param size size of the segment, only used when creating it
+     */
+    static std::shared_ptr<Ns3AiSegment> Open(const std::string& name, bool create, uint64_t size)
+    {
+        static std::mutex mutex;
+        static std::map<std::string, std::weak_ptr<Ns3AiSegment>> segments;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        std::shared_ptr<Ns3AiSegment> segment = segments[name].lock();
+        if (!segment)
+        {
+            segment.reset(new Ns3AiSegment(name, create, size));
+            segments[name] = segment;
+        }
+        return segment;
+    };
+
+    /**
+     * Locks the segment, across processes, for growing it or using the
+     * segment manager (see the class description). The lock is recursive.
+     */
+    Lock LockSegment()
+    {
+        return Lock(m_info->m_mutex);
+    };
+
+    /**
+     * Gets the segment manager, to construct or find named objects. Hold
+     * the segment's lock (LockSegment) while using it.
+     */
+    Manager* Get()
+    {
+        Refresh();
+        return m_manager;
+    };
+
+    /**
+     * Maps the segment again if the other side has grown it. Returns the
+     * current generation: objects found before must be found again if it
+     * has changed.
+     */
+    uint32_t Refresh()
+    {
+        if (m_info->m_generation != m_generation)
+        {
+            // the previous mapping is kept, so the lock stays valid
+            Lock lock(m_info->m_mutex);
+            if (m_info->m_generation != m_generation)
+            {
+                Map();
+            }
+        }
+        return m_generation;
+    };
+
+    /**
+     * Makes sure that bytes more bytes can be allocated, growing the
+     * segment if needed (at least doubling it, to grow rarely). Must be
+     * called at a synchronization point, see the class description, and
+     * with the segment's lock held until the bytes are allocated.
+     */
+    void Reserve(uint64_t bytes)
+    {
+        Lock lock = LockSegment();
+        Refresh();
+        uint64_t freeMemory = m_manager->get_free_memory();
+        // the free memory may be fragmented, keep a margin
+        uint64_t needed = bytes + bytes / 8 + SEGMENT_OVERHEAD;
+        if (freeMemory >= needed)
+        {
+            return;
+        }
+        uint64_t extra = needed - freeMemory;
+        if (extra < m_manager->get_size())
+        {
+            extra = m_manager->get_size();
+        }
+        extra = RoundToPages(extra);
+        bool grown = m_isFile
+                         ? boost::interprocess::managed_mapped_file::grow(m_name.c_str(), extra)
+                         : boost::interprocess::managed_shared_memory::grow(m_name.c_str(), extra);
+        if (!grown)
+        {
+            throw std::runtime_error("ns3-ai: cannot grow segment '" + m_name + "'");
+        }
+        __sync_fetch_and_add(const_cast<uint32_t*>(&m_info->m_generation), 1);
+        Map();
+    };
+
+    /**
+     * Asks the kernel to back the segment with transparent huge pages,
+     * which reduces TLB misses with large payloads. Only for POSIX shared
+     * memory segments (files on hugetlbfs already use huge pages), and
+     * only effective if /sys/kernel/mm/transparent_hugepage/shmem_enabled
+     * is "advise" (or "always"). Pages already touched are not affected,
+     * so call it before resizing vectors. Returns false if not supported.
+     */
+    bool SetHugePages(bool enable)
+    {
+        m_hugePages = enable;
+        return !enable || AdviseHugePages();
+    };
+
+    const std::string& GetName() const
+    {
+        return m_name;
+    };
+
+    bool IsCreator() const
+    {
+        return m_isCreator;
+    };
+
+    /**
+     * Gets whether the segment is a mapped file (e.g., on hugetlbfs)
+     */
+    bool IsFile() const
+    {
+        return m_isFile;
+    };
+
+    /**
+     * Gets the size of the segment in bytes
+     */
+    uint64_t GetSize()
+    {
+        Lock lock = LockSegment();
+        Refresh();
+        return m_manager->get_size();
+    };
+
+    /**
+     * Gets the number of bytes which can still be allocated
+     */
+    uint64_t GetFreeMemory()
+    {
+        Lock lock = LockSegment();
+        Refresh();
+        return m_manager->get_free_memory();
+    };
+
+  private:
+    Ns3AiSegment(const std::string& name, bool create, uint64_t size)
+        : m_name(name),
+          m_isCreator(create),
+          m_isFile(!name.empty() && name[0] == '/'),
+          m_pageSize(4096),
+          m_hugePages(false),
+          m_manager(nullptr)
+    {
+        using namespace boost::interprocess;
+        if (m_isFile)
+        {
+            // hugetlbfs reports the huge page size as block size
+            std::string dir = m_name.substr(0, m_name.rfind('/') + 1);
+            struct statvfs st;
+            if (statvfs(dir.c_str(), &st) == 0 && st.f_bsize > m_pageSize)
+            {
+                m_pageSize = st.f_bsize;
+            }
+        }
+        if (m_isCreator && IsCreatedByThisProcess())
+        {
+            // another module loaded in this process (e.g. another Python
+            // binding) has its own cache and already created the segment
+            m_isCreator = false;
+        }
+        if (m_isCreator)
+        {
+            Remove();
+            if (m_isFile)
+            {
+                m_file = managed_mapped_file(create_only, m_name.c_str(), RoundToPages(size));
+                m_manager = m_file.get_segment_manager();
+            }
+            else
+            {
+                m_memory = managed_shared_memory(create_only, m_name.c_str(), size);
+                m_manager = m_memory.get_segment_manager();
+            }
+            m_info = m_manager->construct<Ns3AiSegmentInfo>(INFO_NAME)();
+            m_info->m_owner = getpid();
+            m_info->m_generation = 0;
+            m_generation = 0;
+        }
+        else
+        {
+            Map();
+        }
+    };
+
+    bool IsCreatedByThisProcess()
+    {
+        using namespace boost::interprocess;
+        try
+        {
+            Map();
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+        bool ret = m_info->m_owner == getpid();
+        m_file = managed_mapped_file();
+        m_memory = managed_shared_memory();
+        m_oldFiles.clear();
+        m_oldMemories.clear();
+        m_manager = nullptr;
+        return ret;
+    };
+
+    /**
+     * Maps the whole (possibly grown) segment, keeping the previous mapping
+     */
+    void Map()
+    {
+        using namespace boost::interprocess;
+        if (m_isFile)
+        {
+            if (m_manager)
+            {
+                m_oldFiles.emplace_back(std::move(m_file));
+            }
+            m_file = managed_mapped_file(open_only, m_name.c_str());
+            m_manager = m_file.get_segment_manager();
+        }
+        else
+        {
+            if (m_manager)
+            {
+                m_oldMemories.emplace_back(std::move(m_memory));
+            }
+            m_memory = managed_shared_memory(open_only, m_name.c_str());
+            m_manager = m_memory.get_segment_manager();
+        }
+        m_info = m_manager->find<Ns3AiSegmentInfo>(INFO_NAME).first;
+        if (!m_info)
+        {
+            throw std::runtime_error("ns3-ai: segment '" + m_name + "' was not created by ns3-ai");
+        }
+        m_generation = m_info->m_generation;
+        if (m_hugePages)
+        {
+            AdviseHugePages();
+        }
+    };
+
+    bool AdviseHugePages()
+    {
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+        if (m_isFile)
+        {
+            return false;
+        }
+        uintptr_t begin = reinterpret_cast<uintptr_t>(m_memory.get_address());
+        uintptr_t end = begin + m_memory.get_size();
+        begin &= ~uintptr_t(4095);
+        return madvise(reinterpret_cast<void*>(begin), end - begin, MADV_HUGEPAGE) == 0;
+#else
+        return false;
+#endif
+    };
+
+    /**
+     * Measures the bytes taken by a one-byte object with a one-character
+     * name in a scratch segment, beyond those two bytes
+     */
+    static uint64_t MeasureObjectHeader()
+    {
+        typedef boost::interprocess::basic_managed_external_buffer<
+            char,
+            boost::interprocess::rbtree_best_fit<boost::interprocess::mutex_family>,
+            boost::interprocess::iset_index>
+            Scratch;
+        static_assert(std::is_same<Scratch::segment_manager, Manager>::value,
+                      "the scratch segment must be managed as the real ones");
+        std::vector<std::max_align_t> buffer(4096 / sizeof(std::max_align_t));
+        Scratch scratch(boost::interprocess::create_only, buffer.data(), 4096);
+        uint64_t before = scratch.get_free_memory();
+        scratch.construct<char>("x")();
+        return before - scratch.get_free_memory() - 2;
+    };
+
+    uint64_t RoundToPages(uint64_t bytes) const
+    {
+        return (bytes + m_pageSize - 1) / m_pageSize * m_pageSize;
+    };
+
+    void Remove()
+    {
+        if (m_isFile)
+        {
+            boost::interprocess::file_mapping::remove(m_name.c_str());
+        }
+        else
+        {
+            boost::interprocess::shared_memory_object::remove(m_name.c_str());
+        }
+    };
+
+    static constexpr const char* INFO_NAME = "ns3-ai segment info";
+
+    const std::string m_name;
+    bool m_isCreator;
+    const bool m_isFile;
+    uint64_t m_pageSize;
+    bool m_hugePages;
+    // only one of the two is used, depending on m_isFile
+    boost::interprocess::managed_shared_memory m_memory;
+    boost::interprocess::managed_mapped_file m_file;
+    std::vector<boost::interprocess::managed_shared_memory> m_oldMemories;
+    std::vector<boost::interprocess::managed_mapped_file> m_oldFiles;
+    Manager* m_manager;
+    Ns3AiSegmentInfo* m_info;
+    uint32_t m_generation;
+};
+
+} // namespace ns3
+
+#endif // NS3_AI_SEGMENT_H
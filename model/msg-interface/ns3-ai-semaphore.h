@@ -20,7 +20,59 @@
 #ifndef NS3_AI_SEMAPHORE_H
 #define NS3_AI_SEMAPHORE_H
 
+#include <chrono>
+#include <climits>
 #include <cstdint>
+#include <map>
+#include <string>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <time.h>
+#endif
+
+/**
+ * \brief Futex word paired with a semaphore, used to park waiters
+ * instead of spinning. It must live in the shared segment next to
+ * the semaphore it belongs to.
+ */
+struct Ns3AiFutex
+{
+    volatile uint32_t m_seq{0};      //!< bumped when waking sleepers, the futex word itself
+    volatile uint32_t m_sleepers{0}; //!< number of waiters parked (or about to park)
+};
+
+/**
+ * \brief Process-local counters of the time spent waiting on a semaphore
+ */
+struct Ns3AiWaitStats
+{
+    uint64_t m_waits{0};   //!< number of sem_wait calls
+    uint64_t m_spins{0};   //!< waits that were satisfied while spinning
+    uint64_t m_sleeps{0};  //!< waits that parked on the futex at least once
+    uint64_t m_spinNs{0};  //!< total nanoseconds spent spinning
+    uint64_t m_sleepNs{0}; //!< total nanoseconds spent parked
+
+    void Reset()
+    {
+        *this = Ns3AiWaitStats();
+    }
+
+    /**
+     * Gets the counters keyed by name, convenient for Python bindings
+     */
+    std::map<std::string, uint64_t> ToMap() const
+    {
+        return {{"waits", m_waits},
+                {"spins", m_spins},
+                {"sleeps", m_sleeps},
+                {"spin_ns", m_spinNs},
+                {"sleep_ns", m_sleepNs}};
+    }
+};
 
 /**
  * \brief Structure providing semaphore operations
@@ -29,6 +81,40 @@ struct Ns3AiSemaphore
 {
     explicit Ns3AiSemaphore() = default;
 
+    /**
+     * \brief How sem_wait behaves while the semaphore is unavailable
+     */
+    enum WaitMode : uint8_t
+    {
+        SPIN = 0,            //!< busy-spin until available (lowest latency, burns a core)
+        SPIN_THEN_SLEEP = 1, //!< spin for a bounded budget, then park on the futex
+    };
+
+    static constexpr uint32_t DEFAULT_SPIN_BUDGET_US = 100;
+
+    static inline void cpu_relax()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield" ::: "memory");
+#endif
+    }
+
+    static inline uint32_t atomic_read32(const volatile uint32_t* mem)
+    {
+        uint32_t old_val = *mem;
+        __sync_synchronize();
+        return old_val;
+    }
+
+    static inline void atomic_write32(volatile uint32_t* mem, uint32_t val)
+    {
+        __sync_synchronize();
+        *mem = val;
+        __sync_synchronize();
+    }
+
     static inline uint8_t atomic_read8(const volatile uint8_t* mem)
     {
         uint8_t old_val = *mem;
@@ -80,6 +166,143 @@ struct Ns3AiSemaphore
     {
         return atomic_add8(mem, 1);
     }
+
+    /**
+     * Parks the caller until the futex word differs from expected (or
+     * a spurious wakeup happens). Cross-process, so no FUTEX_PRIVATE_FLAG.
+     */
+    static inline void futex_wait(volatile uint32_t* word, uint32_t expected)
+    {
+#ifdef __linux__
+        syscall(SYS_futex, const_cast<uint32_t*>(word), FUTEX_WAIT, expected, nullptr, nullptr, 0);
+#else
+        // no futex: degrade to a short sleep, the caller re-checks anyway
+        (void)word;
+        (void)expected;
+        struct timespec ts = {0, 50000};
+        nanosleep(&ts, nullptr);
+#endif
+    }
+
+    static inline void futex_wake_all(volatile uint32_t* word)
+    {
+#ifdef __linux__
+        syscall(SYS_futex, const_cast<uint32_t*>(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#else
+        (void)word;
+#endif
+    }
+
+    /**
+     * Waits until ready() returns true, according to the wait mode. In SPIN
+     * mode the caller busy-spins. In SPIN_THEN_SLEEP mode, the caller spins
+     * for at most spin_budget_us microseconds and then parks on the futex
+     * until the peer calls notify on it. Time spent is accumulated into stats.
+     * The predicate must consume the resource it checks (like sem_try_wait).
+     */
+    template <typename Predicate>
+    static inline void wait_until(Predicate ready,
+                                  Ns3AiFutex* futex,
+                                  WaitMode mode,
+                                  uint32_t spin_budget_us,
+                                  Ns3AiWaitStats* stats)
+    {
+        ++stats->m_waits;
+        if (ready())
+        {
+            ++stats->m_spins;
+            return;
+        }
+
+        using Clock = std::chrono::steady_clock;
+        const Clock::time_point spinStart = Clock::now();
+        const Clock::time_point spinDeadline =
+            spinStart + std::chrono::microseconds(spin_budget_us);
+        uint32_t iter = 0;
+        while (true)
+        {
+            if (ready())
+            {
+                ++stats->m_spins;
+                stats->m_spinNs += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                       Clock::now() - spinStart)
+                                       .count();
+                return;
+            }
+            cpu_relax();
+            // reading the clock is much slower than a CAS, so check it sparsely
+            if (mode == SPIN_THEN_SLEEP && (++iter & 0x3f) == 0 && Clock::now() >= spinDeadline)
+            {
+                break;
+            }
+        }
+
+        const Clock::time_point sleepStart = Clock::now();
+        stats->m_spinNs +=
+            std::chrono::duration_cast<std::chrono::nanoseconds>(sleepStart - spinStart).count();
+        ++stats->m_sleeps;
+        while (true)
+        {
+            // Read the sequence before announcing ourselves, so that a notify
+            // happening in between changes it and futex_wait returns at once.
+            uint32_t seq = atomic_read32(&futex->m_seq);
+            __sync_fetch_and_add(const_cast<uint32_t*>(&futex->m_sleepers), 1);
+            if (ready())
+            {
+                __sync_fetch_and_sub(const_cast<uint32_t*>(&futex->m_sleepers), 1);
+                break;
+            }
+            futex_wait(&futex->m_seq, seq);
+            __sync_fetch_and_sub(const_cast<uint32_t*>(&futex->m_sleepers), 1);
+            if (ready())
+            {
+                break;
+            }
+        }
+        stats->m_sleepNs +=
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - sleepStart)
+                .count();
+    }
+
+    /**
+     * Wakes the waiters parked on the futex, if any. Must be called after
+     * the state they are waiting for has been published. The syscall is
+     * only made when somebody is actually sleeping.
+     */
+    static inline void notify(Ns3AiFutex* futex)
+    {
+        // A waiter announces itself before its last check of the state, so
+        // if no sleeper is seen here, that check will see the new state.
+        __sync_synchronize();
+        if (atomic_read32(&futex->m_sleepers) != 0)
+        {
+            __sync_fetch_and_add(const_cast<uint32_t*>(&futex->m_seq), 1);
+            futex_wake_all(&futex->m_seq);
+        }
+    }
+
+    /**
+     * Waits on the semaphore according to the wait mode, see wait_until.
+     * In SPIN mode this behaves like sem_wait(mem).
+     */
+    static inline void sem_wait(volatile uint8_t* mem,
+                                Ns3AiFutex* futex,
+                                WaitMode mode,
+                                uint32_t spin_budget_us,
+                                Ns3AiWaitStats* stats)
+    {
+        wait_until([mem]() { return sem_try_wait(mem); }, futex, mode, spin_budget_us, stats);
+    }
+
+    /**
+     * Posts on the semaphore and wakes the waiters parked on the futex, if any.
+     */
+    static inline uint8_t sem_post(volatile uint8_t* mem, Ns3AiFutex* futex)
+    {
+        uint8_t old = atomic_add8(mem, 1);
+        notify(futex);
+        return old;
+    }
 };
 
 #endif // NS3_AI_SEMAPHORE_H
@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:  Muyuan Shen <muyuan_shen@hust.edu.cn>
+ */
+
+#ifndef NS3_AI_SNAPSHOT_H
+#define NS3_AI_SNAPSHOT_H
+
+#include "ns3-ai-msg-interface.h"
+#include "ns3-ai-socket.h"
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+namespace ns3
+{
+
+/**
+ * \brief Message of the snapshot channel: a command from Python, or a
+ * pid from C++
+ */
+struct Ns3AiSnapshotMsg
+{
+    int32_t m_value;
+};
+
+/**
+ * \brief Episodes started from a snapshot of the simulation, instead of
+ * a new ns-3 process each.
+ *
+ * The scenario calls MarkEpisodeStart once its setup is done (e.g., after
+ * the topology is built and the stations have associated). If the Python
+ * side asked for snapshots (NS3AI_SNAPSHOT=1 in the environment, see
+ * Experiment's snapshot parameter), the process stops there and waits. For
+ * each episode, Python asks it to fork: the child returns from
+ * MarkEpisodeStart and goes on with the simulation, attached to the same
+ * segment. Otherwise MarkEpisodeStart returns at once.
+ *
+ * The channels must be idle at the mark (e.g., before the first
+ * notification of the Gym interface), so that each child starts them
+ * afresh. Random streams created before the mark are copied with the
+ * process, so every episode draws the same numbers unless the scenario
+ * varies them after the mark, e.g. with the episode number returned.
+ * Only shared memory segments are supported, not sockets.
+ */
+class Ns3AiSnapshot
+{
+  public:
+    typedef Ns3AiMsgInterfaceImpl<Ns3AiSnapshotMsg, Ns3AiSnapshotMsg> Channel;
+
+    enum Command : int32_t
+    {
+        FORK = 1,
+        EXIT = 2,
+    };
+
+    static constexpr const char* CPP2PY_MSG_NAME = "ns3ai-snapshot/cpp2py";
+    static constexpr const char* PY2CPP_MSG_NAME = "ns3ai-snapshot/py2cpp";
+    static constexpr const char* LOCKABLE_NAME = "ns3ai-snapshot/lockable";
+
+    /**
+     * C++ side: marks the start of an episode. In snapshot mode, returns
+     * only in the forked children, with the episode number (from 1).
+     * Otherwise, or when called again, returns the current episode
+     * number (0 without snapshots).
+     */
+    static uint32_t MarkEpisodeStart()
+    {
+        static uint32_t episode = 0;
+        static bool marked = false;
+        const char* enabled = std::getenv("NS3AI_SNAPSHOT");
+        if (marked || !enabled || std::string(enabled) != "1")
+        {
+            return episode;
+        }
+        marked = true;
+        std::string segmentName = Ns3AiMsgInterface::Get()->GetSegmentName();
+        if (Ns3AiSocket::IsAddress(segmentName))
+        {
+            throw std::runtime_error("ns3-ai: snapshots need a shared memory segment");
+        }
+        auto channel = std::make_unique<Channel>(false,
+                                                 false,
+                                                 false,
+                                                 0,
+                                                 segmentName.c_str(),
+                                                 CPP2PY_MSG_NAME,
+                                                 PY2CPP_MSG_NAME,
+                                                 LOCKABLE_NAME);
+        // the parent waits for long, do not keep a core busy
+        channel->SetWaitMode(Ns3AiSemaphore::SPIN_THEN_SLEEP);
+        // the children are reaped automatically
+        std::signal(SIGCHLD, SIG_IGN);
+        int32_t reply = getpid();
+        while (true)
+        {
+            channel->CppSendBegin();
+            channel->GetCpp2PyStruct()->m_value = reply;
+            channel->CppSendEnd();
+            channel->CppRecvBegin();
+            int32_t command = channel->GetPy2CppStruct()->m_value;
+            channel->CppRecvEnd();
+            if (command != FORK)
+            {
+                // skips the destructors, which would notify the other channels
+                std::_Exit(0);
+            }
+            // the buffered output would be printed by each child
+            std::cout.flush();
+            std::cerr.flush();
+            std::fflush(nullptr);
+            ++episode;
+            pid_t pid = fork();
+            if (pid == 0)
+            {
+                std::signal(SIGCHLD, SIG_DFL);
+                return episode;
+            }
+            reply = pid < 0 ? -errno : pid;
+        }
+    };
+};
+
+/**
+ * \brief Python side of the snapshot channel, used by Experiment
+ */
+class Ns3AiSnapshotClient
+{
+  public:
+    explicit Ns3AiSnapshotClient(const std::string& segmentName)
+        : m_channel(true,
+                    false,
+                    false,
+                    0,
+                    segmentName.c_str(),
+                    Ns3AiSnapshot::CPP2PY_MSG_NAME,
+                    Ns3AiSnapshot::PY2CPP_MSG_NAME,
+                    Ns3AiSnapshot::LOCKABLE_NAME)
+    {
+    }
+
+    /**
+     * Waits at most timeoutMs for the simulation to reach the mark.
+     * Returns the pid of the parent process, or 0 on timeout.
+     */
+    int32_t WaitReady(uint32_t timeoutMs)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        // checks the deadline every millisecond, so that the caller can
+        // notice a simulation which exited before the mark
+        bool ready = m_channel.PyRecvBeginUnless([deadline]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            return std::chrono::steady_clock::now() >= deadline;
+        });
+        if (!ready)
+        {
+            return 0;
+        }
+        int32_t pid = m_channel.GetCpp2PyStruct()->m_value;
+        m_channel.PyRecvEnd();
+        return pid;
+    };
+
+    /**
+     * Starts an episode: the parent forks a child, which goes on with
+     * the simulation from the mark. Returns the child's pid.
+     */
+    int32_t Fork()
+    {
+        Send(Ns3AiSnapshot::FORK);
+        m_channel.PyRecvBegin();
+        int32_t pid = m_channel.GetCpp2PyStruct()->m_value;
+        m_channel.PyRecvEnd();
+        if (pid < 0)
+        {
+            throw std::runtime_error("ns3-ai: the simulation cannot fork, errno " +
+                                     std::to_string(-pid));
+        }
+        return pid;
+    };
+
+    /**
+     * Makes the parent exit, the running child goes on
+     */
+    void Exit()
+    {
+        Send(Ns3AiSnapshot::EXIT);
+    };
+
+  private:
+    void Send(int32_t command)
+    {
+        m_channel.PySendBegin();
+        m_channel.GetPy2CppStruct()->m_value = command;
+        m_channel.PySendEnd();
+    };
+
+    Ns3AiSnapshot::Channel m_channel;
+};
+
+} // namespace ns3
+
+#endif // NS3_AI_SNAPSHOT_H
@@ -0,0 +1,667 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors:  Muyuan Shen <muyuan_shen@hust.edu.cn>
+ */
+
+#ifndef NS3_AI_SOCKET_H
+#define NS3_AI_SOCKET_H
+
+#include "ns3-ai-semaphore.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \brief Header of a frame sent on a socket, followed by count elements
+ */
+struct Ns3AiSocketFrame
+{
+    enum Type : uint32_t
+    {
+        MSG = 1,    //!< a message (struct, or vector of count elements)
+        FINISH = 2, //!< the simulation is over, with the last message
+        HELLO = 3,  //!< first frame of a connection, an Ns3AiSocketHello
+    };
+
+    uint32_t m_type;  //!< a Type
+    uint32_t m_count; //!< number of elements, 1 for a struct
+};
+
+/**
+ * \brief Sent by the connecting side, so that the listening side can give
+ * the connection to the right channel and check the message types
+ */
+struct Ns3AiSocketHello
+{
+    uint32_t m_useVector;
+    uint32_t m_cpp2pySize;
+    uint32_t m_py2cppSize;
+    char m_name[244]; //!< the channel's lockable name, truncated
+};
+
+/**
+ * \brief Thrown when the other side closes the connection
+ */
+class Ns3AiSocketClosed : public std::runtime_error
+{
+  public:
+    Ns3AiSocketClosed()
+        : std::runtime_error("ns3-ai: connection closed by the other side")
+    {
+    }
+};
+
+/**
+ * \brief A stream socket (TCP or Unix-domain) carrying the messages of
+ * one channel as frames. Sends are not acknowledged, so several messages
+ * can be in flight (pipelining). Receives read as many bytes as
+ * available, so that frames which arrived together are parsed from one
+ * read (batching).
+ *
+ * Addresses are "tcp://host:port" or "unix:///path/to/socket".
+ */
+class Ns3AiSocket
+{
+  public:
+    Ns3AiSocket(const Ns3AiSocket&) = delete;
+    Ns3AiSocket& operator=(const Ns3AiSocket&) = delete;
+
+    ~Ns3AiSocket()
+    {
+        close(m_fd);
+    };
+
+    /**
+     * Gets whether a segment name is a socket address
+     */
+    static bool IsAddress(const std::string& name)
+    {
+        return name.compare(0, 6, "tcp://") == 0 || name.compare(0, 7, "unix://") == 0;
+    };
+
+    /**
+     * Connects to the listening side, retrying until timeoutMs, and sends
+     * the hello
+     */
+    static std::unique_ptr<Ns3AiSocket> Connect(const std::string& address,
+                                                const Ns3AiSocketHello& hello,
+                                                uint32_t timeoutMs)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        while (true)
+        {
+            int fd = -1;
+            bool connected = false;
+            for (const auto& addr : Resolve(address, false))
+            {
+                fd = socket(addr.m_family, SOCK_STREAM, 0);
+                if (fd >= 0 &&
+                    connect(fd, reinterpret_cast<const sockaddr*>(&addr.m_addr), addr.m_len) == 0)
+                {
+                    connected = true;
+                    break;
+                }
+                if (fd >= 0)
+                {
+                    close(fd);
+                }
+            }
+            if (connected)
+            {
+                std::unique_ptr<Ns3AiSocket> sock(new Ns3AiSocket(fd));
+                sock->Send(Ns3AiSocketFrame::HELLO, &hello, 1, sizeof(hello));
+                return sock;
+            }
+            if (std::chrono::steady_clock::now() > deadline)
+            {
+                throw std::runtime_error("ns3-ai: cannot connect to '" + address + "'");
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    };
+
+    /**
+     * Sends a frame of count elements of elementSize bytes, in one call
+     */
+    void Send(uint32_t type, const void* data, uint32_t count, uint32_t elementSize)
+    {
+        Ns3AiSocketFrame frame{type, count};
+        iovec iov[2];
+        iov[0].iov_base = &frame;
+        iov[0].iov_len = sizeof(frame);
+        iov[1].iov_base = const_cast<void*>(data);
+        iov[1].iov_len = uint64_t(count) * elementSize;
+        iovec* next = iov;
+        int remaining = iov[1].iov_len > 0 ? 2 : 1;
+        while (remaining > 0)
+        {
+            msghdr msg{};
+            msg.msg_iov = next;
+            msg.msg_iovlen = remaining;
+            ssize_t sent = sendmsg(m_fd, &msg, MSG_NOSIGNAL);
+            if (sent < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                throw std::runtime_error("ns3-ai: connection lost");
+            }
+            while (remaining > 0 && uint64_t(sent) >= next->iov_len)
+            {
+                sent -= next->iov_len;
+                ++next;
+                --remaining;
+            }
+            if (remaining > 0)
+            {
+                next->iov_base = static_cast<uint8_t*>(next->iov_base) + sent;
+                next->iov_len -= sent;
+            }
+        }
+    };
+
+    /**
+     * Waits for the next frame according to the wait mode, and returns
+     * its header. The payload must then be read with RecvPayload.
+     */
+    Ns3AiSocketFrame RecvFrame(Ns3AiSemaphore::WaitMode mode,
+                               uint32_t spinBudgetUs,
+                               Ns3AiWaitStats* stats)
+    {
+        ++stats->m_waits;
+        if (Poll())
+        {
+            ++stats->m_spins;
+        }
+        else
+        {
+            // spin with non-blocking reads, then block in recv like the
+            // semaphores park on their futex
+            using Clock = std::chrono::steady_clock;
+            const Clock::time_point spinStart = Clock::now();
+            const Clock::time_point spinDeadline =
+                spinStart + std::chrono::microseconds(spinBudgetUs);
+            bool ready = false;
+            while (!(ready = Poll()))
+            {
+                Ns3AiSemaphore::cpu_relax();
+                if (mode == Ns3AiSemaphore::SPIN_THEN_SLEEP && Clock::now() >= spinDeadline)
+                {
+                    break;
+                }
+            }
+            const Clock::time_point sleepStart = Clock::now();
+            stats->m_spinNs +=
+                std::chrono::duration_cast<std::chrono::nanoseconds>(sleepStart - spinStart)
+                    .count();
+            if (ready)
+            {
+                ++stats->m_spins;
+            }
+            else
+            {
+                ++stats->m_sleeps;
+                while (GetBuffered() < sizeof(Ns3AiSocketFrame))
+                {
+                    Fill(true);
+                }
+                stats->m_sleepNs += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                        Clock::now() - sleepStart)
+                                        .count();
+            }
+        }
+        Ns3AiSocketFrame frame;
+        std::memcpy(&frame, &m_buffer[m_begin], sizeof(frame));
+        m_begin += sizeof(frame);
+        return frame;
+    };
+
+    /**
+     * Reads the payload of the frame just received, blocking until all of
+     * it has arrived
+     */
+    void RecvPayload(void* data, uint64_t bytes)
+    {
+        uint8_t* dest = static_cast<uint8_t*>(data);
+        while (bytes > 0)
+        {
+            if (GetBuffered() == 0)
+            {
+                if (bytes >= m_buffer.size())
+                {
+                    // large payloads go directly to the destination
+                    ssize_t got = RecvSome(dest, bytes, true);
+                    dest += got;
+                    bytes -= got;
+                    continue;
+                }
+                Fill(true);
+            }
+            uint64_t n = std::min<uint64_t>(bytes, GetBuffered());
+            std::memcpy(dest, &m_buffer[m_begin], n);
+            m_begin += n;
+            dest += n;
+            bytes -= n;
+        }
+    };
+
+    /**
+     * Gets, without blocking, whether a frame header has arrived
+     */
+    bool Poll()
+    {
+        while (GetBuffered() < sizeof(Ns3AiSocketFrame))
+        {
+            if (!Fill(false))
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    /**
+     * Waits at most timeoutMs until a frame header has arrived or more
+     * bytes can be read. Returns false on timeout.
+     */
+    bool WaitReadable(int timeoutMs)
+    {
+        if (GetBuffered() >= sizeof(Ns3AiSocketFrame))
+        {
+            return true;
+        }
+        pollfd p{m_fd, POLLIN, 0};
+        return poll(&p, 1, timeoutMs) > 0;
+    };
+
+    /**
+     * A resolved address, for connect or bind
+     */
+    struct Address
+    {
+        int m_family;
+        sockaddr_storage m_addr;
+        socklen_t m_len;
+    };
+
+    /**
+     * Resolves "tcp://host:port" (possibly to several addresses) or
+     * "unix:///path". For listening, an empty host means any.
+     */
+    static std::vector<Address> Resolve(const std::string& address, bool listen)
+    {
+        std::vector<Address> ret;
+        if (address.compare(0, 7, "unix://") == 0)
+        {
+            std::string path = address.substr(7);
+            Address addr{AF_UNIX, {}, sizeof(sockaddr_un)};
+            sockaddr_un* un = reinterpret_cast<sockaddr_un*>(&addr.m_addr);
+            un->sun_family = AF_UNIX;
+            if (path.empty() || path.size() >= sizeof(un->sun_path))
+            {
+                throw std::runtime_error("ns3-ai: invalid socket path in '" + address + "'");
+            }
+            std::strncpy(un->sun_path, path.c_str(), sizeof(un->sun_path) - 1);
+            ret.push_back(addr);
+            return ret;
+        }
+        std::string hostPort = address.substr(6);
+        size_t colon = hostPort.rfind(':');
+        if (colon == std::string::npos)
+        {
+            throw std::runtime_error("ns3-ai: no port in '" + address + "'");
+        }
+        std::string host = hostPort.substr(0, colon);
+        if (host.size() > 2 && host.front() == '[' && host.back() == ']')
+        {
+            host = host.substr(1, host.size() - 2);
+        }
+        std::string port = hostPort.substr(colon + 1);
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = listen ? AI_PASSIVE : 0;
+        addrinfo* result = nullptr;
+        if (getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &result) !=
+            0)
+        {
+            throw std::runtime_error("ns3-ai: cannot resolve '" + address + "'");
+        }
+        for (addrinfo* ai = result; ai; ai = ai->ai_next)
+        {
+            Address addr{ai->ai_family, {}, ai->ai_addrlen};
+            std::memcpy(&addr.m_addr, ai->ai_addr, ai->ai_addrlen);
+            ret.push_back(addr);
+        }
+        freeaddrinfo(result);
+        return ret;
+    };
+
+  private:
+    friend class Ns3AiSocketListener;
+
+    static constexpr uint64_t BUFFER_SIZE = 1 << 16;
+
+    explicit Ns3AiSocket(int fd)
+        : m_fd(fd),
+          m_buffer(BUFFER_SIZE),
+          m_begin(0),
+          m_end(0)
+    {
+        int one = 1;
+        // fails for Unix-domain sockets, which do not need it
+        setsockopt(m_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    };
+
+    uint64_t GetBuffered() const
+    {
+        return m_end - m_begin;
+    };
+
+    /**
+     * Makes the blocking reads fail after timeoutMs milliseconds without
+     * data (0: no timeout)
+     */
+    void SetRecvTimeout(int timeoutMs)
+    {
+        timeval tv{timeoutMs / 1000, (timeoutMs % 1000) * 1000};
+        setsockopt(m_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    };
+
+    /**
+     * Reads as many bytes as available into the buffer. Returns false if
+     * nothing was available and block is false.
+     */
+    bool Fill(bool block)
+    {
+        if (m_begin == m_end)
+        {
+            m_begin = m_end = 0;
+        }
+        else if (m_end == m_buffer.size())
+        {
+            std::memmove(&m_buffer[0], &m_buffer[m_begin], GetBuffered());
+            m_end -= m_begin;
+            m_begin = 0;
+        }
+        ssize_t got = RecvSome(&m_buffer[m_end], m_buffer.size() - m_end, block);
+        m_end += got;
+        return got > 0;
+    };
+
+    ssize_t RecvSome(void* data, uint64_t bytes, bool block)
+    {
+        while (true)
+        {
+            ssize_t got = recv(m_fd, data, bytes, block ? 0 : MSG_DONTWAIT);
+            if (got > 0)
+            {
+                return got;
+            }
+            if (got == 0)
+            {
+                throw Ns3AiSocketClosed();
+            }
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (!block && (errno == EAGAIN || errno == EWOULDBLOCK))
+            {
+                return 0;
+            }
+            throw std::runtime_error("ns3-ai: connection lost");
+        }
+    };
+
+    int m_fd;
+    std::vector<uint8_t> m_buffer; //!< received bytes, from m_begin to m_end
+    uint64_t m_begin;
+    uint64_t m_end;
+};
+
+/**
+ * \brief Listens on an address for the channels of this process. The
+ * listener is shared by the channels which use the same address, and
+ * gives each of them the connection whose hello has its name.
+ */
+class Ns3AiSocketListener
+{
+  public:
+    Ns3AiSocketListener(const Ns3AiSocketListener&) = delete;
+    Ns3AiSocketListener& operator=(const Ns3AiSocketListener&) = delete;
+
+    ~Ns3AiSocketListener()
+    {
+        close(m_fd);
+        if (m_address.compare(0, 7, "unix://") == 0)
+        {
+            unlink(m_address.c_str() + 7);
+        }
+    };
+
+    /**
+     * Gets the listener of the given address, creating it if needed
+     */
+    static std::shared_ptr<Ns3AiSocketListener> Open(const std::string& address)
+    {
+        static std::mutex mutex;
+        static std::map<std::string, std::weak_ptr<Ns3AiSocketListener>> listeners;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        std::shared_ptr<Ns3AiSocketListener> listener = listeners[address].lock();
+        if (!listener)
+        {
+            listener.reset(new Ns3AiSocketListener(address));
+            listeners[address] = listener;
+        }
+        return listener;
+    };
+
+    /**
+     * Waits for the connection of the named channel, and gets its hello.
+     * Returns nullptr if no connection arrived within timeoutMs (-1: no
+     * timeout); a connection accepted just before then may still take up
+     * to HELLO_TIMEOUT_MS to say hello. Connections which do not say hello
+     * in time are dropped, and so are those for a channel which already
+     * has a connection, pending or accepted (unless its peer has hung up,
+     * when the new one is a reconnection). The channel must call Release
+     * when it drops the accepted connection.
+     */
+    std::unique_ptr<Ns3AiSocket> Accept(const std::string& name,
+                                        Ns3AiSocketHello& hello,
+                                        int timeoutMs = -1)
+    {
+        using Clock = std::chrono::steady_clock;
+        const Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+        std::string key = GetKey(name);
+        while (m_pending.find(key) == m_pending.end())
+        {
+            int waitMs = -1;
+            if (timeoutMs >= 0)
+            {
+                auto left =
+                    std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now());
+                if (left.count() <= 0)
+                {
+                    return nullptr;
+                }
+                waitMs = static_cast<int>(left.count());
+            }
+            pollfd p{m_fd, POLLIN, 0};
+            int ready = poll(&p, 1, waitMs);
+            if (ready == 0)
+            {
+                return nullptr;
+            }
+            if (ready < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                throw std::runtime_error("ns3-ai: cannot accept on '" + m_address + "'");
+            }
+            int fd = accept(m_fd, nullptr, nullptr);
+            if (fd < 0)
+            {
+                if (errno == EINTR || errno == ECONNABORTED)
+                {
+                    continue;
+                }
+                throw std::runtime_error("ns3-ai: cannot accept on '" + m_address + "'");
+            }
+            std::unique_ptr<Ns3AiSocket> sock(new Ns3AiSocket(fd));
+            Ns3AiSocketHello peerHello;
+            // a peer which does not say hello must not block the others
+            sock->SetRecvTimeout(HELLO_TIMEOUT_MS);
+            try
+            {
+                Ns3AiSocketFrame frame =
+                    sock->RecvFrame(Ns3AiSemaphore::SPIN_THEN_SLEEP, 0, &m_waitStats);
+                if (frame.m_type != Ns3AiSocketFrame::HELLO || frame.m_count != 1)
+                {
+                    continue; // not an ns3-ai peer
+                }
+                sock->RecvPayload(&peerHello, sizeof(peerHello));
+            }
+            catch (const std::runtime_error&)
+            {
+                continue; // timed out or closed
+            }
+            sock->SetRecvTimeout(0);
+            peerHello.m_name[sizeof(peerHello.m_name) - 1] = '\0';
+            auto connected = m_connected.find(peerHello.m_name);
+            if (connected != m_connected.end() && !HasHungUp(connected->second))
+            {
+                std::cerr << "ns3-ai: refused a connection for channel '" << peerHello.m_name
+                          << "' on '" << m_address << "', which is already connected"
+                          << std::endl;
+                continue;
+            }
+            if (!m_pending.emplace(peerHello.m_name, std::make_pair(peerHello, std::move(sock)))
+                     .second)
+            {
+                std::cerr << "ns3-ai: refused a second connection for channel '"
+                          << peerHello.m_name << "' on '" << m_address << "'" << std::endl;
+            }
+        }
+        auto it = m_pending.find(key);
+        hello = it->second.first;
+        std::unique_ptr<Ns3AiSocket> sock = std::move(it->second.second);
+        m_pending.erase(it);
+        m_connected[key] = sock->m_fd;
+        return sock;
+    };
+
+    /**
+     * Forgets the connection accepted for the named channel, before the
+     * channel closes it
+     */
+    void Release(const std::string& name)
+    {
+        m_connected.erase(GetKey(name));
+    };
+
+  private:
+    explicit Ns3AiSocketListener(const std::string& address)
+        : m_address(address),
+          m_fd(-1)
+    {
+        for (const auto& addr : Ns3AiSocket::Resolve(address, true))
+        {
+            if (addr.m_family == AF_UNIX)
+            {
+                // a socket file left by a previous run
+                unlink(address.c_str() + 7);
+            }
+            m_fd = socket(addr.m_family, SOCK_STREAM, 0);
+            int one = 1;
+            if (m_fd >= 0 &&
+                setsockopt(m_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) == 0 &&
+                bind(m_fd, reinterpret_cast<const sockaddr*>(&addr.m_addr), addr.m_len) == 0 &&
+                listen(m_fd, 64) == 0)
+            {
+                return;
+            }
+            if (m_fd >= 0)
+            {
+                close(m_fd);
+                m_fd = -1;
+            }
+        }
+        throw std::runtime_error("ns3-ai: cannot listen on '" + address + "'");
+    };
+
+    /**
+     * Gets the name as sent in a hello, i.e., truncated
+     */
+    static std::string GetKey(const std::string& name)
+    {
+        return name.substr(0, sizeof(Ns3AiSocketHello::m_name) - 1);
+    };
+
+    /**
+     * Gets whether the peer of an accepted connection has closed it, even
+     * if frames it sent before are still to be read
+     */
+    static bool HasHungUp(int fd)
+    {
+#ifdef POLLRDHUP
+        pollfd p{fd, POLLRDHUP, 0};
+#else
+        pollfd p{fd, 0, 0};
+#endif
+        return poll(&p, 1, 0) > 0;
+    };
+
+    static constexpr int HELLO_TIMEOUT_MS = 5000;
+
+    const std::string m_address;
+    int m_fd;
+    Ns3AiWaitStats m_waitStats;
+    std::map<std::string, std::pair<Ns3AiSocketHello, std::unique_ptr<Ns3AiSocket>>> m_pending;
+    std::map<std::string, int> m_connected; //!< sockets of the accepted connections, by name
+};
+
+} // namespace ns3
+
+#endif // NS3_AI_SOCKET_H
@@ -17,7 +17,11 @@
 #         Hao Yin <haoyin@uw.edu>
 #         Muyuan Shen <muyuan_shen@hust.edu.cn>
 
+import ast
+import asyncio
+import glob
 import os
+import re
 import subprocess
 import psutil
 import time
@@ -26,6 +30,24 @@ import logging
 
 
 SIMULATION_EARLY_ENDING = 0.5   # wait and see if the subprocess is running after creation
+SNAPSHOT_POLL_MS = 100          # check that the simulation is alive while waiting for its snapshot
+LAUNCH_POLL = 0.001             # period of the checks while waiting for a simulation to park
+LAUNCH_START_TIMEOUT_MS = 5000  # for a parked simulation to go on, see Ns3AiLauncher
+
+# How the message interface waits on its semaphores, see Ns3AiSemaphore::WaitMode.
+# "spin" busy-spins (lowest latency), "spin_then_sleep" spins for a bounded
+# budget and then sleeps until the other side posts, freeing the core.
+WAIT_MODES = {'spin': 0, 'spin_then_sleep': 1}
+DEFAULT_SPIN_BUDGET_US = 100
+
+# True when this script runs inside the ns-3 process, started by
+# Ns3AiEmbeddedPython: Experiment then does not launch ns-3, which is
+# already running and waits for the message interfaces to be created.
+try:
+    import ns3ai_embedded
+    EMBEDDED = True
+except ImportError:
+    EMBEDDED = False
 
 
 def get_setting(setting_map):
@@ -35,15 +57,52 @@ def get_setting(setting_map):
     return ret
 
 
-def run_single_ns3(path, pname, setting=None, env=None, show_output=False, log_file = None):
+# find the compiled program of an ns-3 target in the list of runnable
+# programs written by the ns3 script (e.g. build/.../ns3.40-<target>-default),
+# so that it can be run without the script. The program of the build profile
+# configured in the lock file is preferred. Returns None if not found.
+def find_ns3_binary(path, pname):
+    for lock in glob.glob(os.path.join(path, '.lock-ns3_*_build')):
+        with open(lock) as f:
+            content = f.read()
+        match = re.search(r'^ns3_runnable_programs\s*=\s*(.*)$', content, re.M)
+        if match is None:
+            continue
+        profiles = ['default', 'debug', 'release', 'optimized']
+        profile = re.search(r'^build_profile\s*=\s*[\'"](\w+)[\'"]', content, re.M)
+        if profile is not None and profile.group(1) in profiles:
+            profiles.remove(profile.group(1))
+            profiles.insert(0, profile.group(1))
+        # the name is ns3<version>-<target>-<profile>, the version being
+        # e.g. ".40" or "-dev"
+        pattern = re.compile(r'^ns3(?:[.\d]*|-dev)-{}-({})$'.format(
+            re.escape(pname), '|'.join(profiles)))
+        found = {}
+        for program in ast.literal_eval(match.group(1)):
+            name = pattern.match(os.path.basename(program))
+            if name and os.path.isfile(program):
+                found.setdefault(name.group(1), program)
+        for p in profiles:
+            if p in found:
+                return found[p]
+    return None
+
+
+# \param[in] binary : the compiled program, run directly instead of through
+#                     "ns3 run", which checks the build at every run
+def run_single_ns3(path, pname, setting=None, env=None, show_output=False, log_file = None,
+                   cpu=None, binary=None):
 
     logger = logging.getLogger("")
     logger.info(f"show output {str(show_output)} log file is None {str(log_file is None)}")
     logger.info(f"ns3 settings {setting}")
-    if env is None:
-        env = {}
-    env.update(os.environ)
-    env['LD_LIBRARY_PATH'] = os.path.abspath(os.path.join(path, 'build', 'lib'))
+    # the given variables take precedence over this process' environment
+    env = dict(os.environ, **({} if env is None else env))
+    # ns-3's libraries first, then the paths the user set (e.g. libtorch),
+    # since the program may be run directly, without the ns3 script
+    libPath = os.path.abspath(os.path.join(path, 'build', 'lib'))
+    env['LD_LIBRARY_PATH'] = os.pathsep.join(
+        p for p in [libPath, env.get('LD_LIBRARY_PATH')] if p)
     # import pdb; pdb.set_trace()
     exec_path = os.path.join(path, 'ns3')
     cmd = ""
@@ -51,30 +110,73 @@ def run_single_ns3(path, pname, setting=None, env=None, show_output=False, log_f
         cmd = '{} run {}'.format(exec_path, pname)
     else:
         cmd = '{} run {} --{}'.format(exec_path, pname, get_setting(setting))
+    args = cmd
+    if binary is not None:
+        args = [binary] + ['--{}={}'.format(key, value) for key, value in (setting or {}).items()]
+        cmd = ' '.join(args)
     # logger.info(f"CMD to run ns3: {cmd}")
+
+    # the affinity is inherited by the simulation process started by ns3
+    def preexec():
+        os.setpgrp()
+        if cpu is not None:
+            os.sched_setaffinity(0, {cpu})
+
     if show_output:
-        proc = subprocess.Popen(cmd, shell=True, text=True, env=env,
+        proc = subprocess.Popen(args, shell=binary is None, text=True, env=env,
                                 stdin=subprocess.PIPE,
-                                preexec_fn=os.setpgrp)
+                                preexec_fn=preexec)
     elif log_file is None:
-        proc = subprocess.Popen(cmd, shell=True, text=True, env=env,
+        proc = subprocess.Popen(args, shell=binary is None, text=True, env=env,
                                 stdin=subprocess.PIPE,
                                 stdout=subprocess.PIPE,
                                 stderr=subprocess.PIPE,
-                                preexec_fn=os.setpgrp)
+                                preexec_fn=preexec)
     else:
-        proc = subprocess.Popen(cmd, 
-                                # shell=True, 
+        proc = subprocess.Popen(args,
+                                shell=binary is None,
                                 text=True, env=env,
                                 # stdin=subprocess.PIPE,
                                 stdout=log_file,
                                 stderr=subprocess.STDOUT,
                                 # preexec_fn=os.setpgrp
+                                preexec_fn=None if cpu is None else lambda: os.sched_setaffinity(0, {cpu})
                                 )
 
     return cmd, proc
 
 
+# get two CPUs for the ns-3 process and the Python process, preferably
+# hyper-threads of the same core (which share L1/L2), otherwise two cores
+# of the same package (which share L3). Returns (ns3Cpu, pythonCpu).
+def get_sibling_cpus():
+    cpus = sorted(os.sched_getaffinity(0))
+
+    def read_list(cpu, name):
+        try:
+            with open('/sys/devices/system/cpu/cpu{}/topology/{}'.format(cpu, name)) as f:
+                text = f.read().strip()
+        except OSError:
+            return []
+        ret = []
+        for part in text.split(','):
+            if '-' in part:
+                lo, hi = part.split('-')
+                ret.extend(range(int(lo), int(hi) + 1))
+            elif part:
+                ret.append(int(part))
+        return [c for c in ret if c in cpus]
+
+    for name in ['thread_siblings_list', 'core_siblings_list']:
+        for cpu in cpus:
+            siblings = [c for c in read_list(cpu, name) if c != cpu]
+            if siblings:
+                return cpu, siblings[0]
+    if len(cpus) >= 2:
+        return cpus[0], cpus[1]
+    return cpus[0], cpus[0]
+
+
 # used to kill the ns-3 script process and its child processes
 def kill_proc_tree(p, timeout=None, on_terminate=None):
     print('ns3ai_utils: Killing subprocesses...')
@@ -107,86 +209,578 @@ def sigint_handler(sig, frame):
     exit(1)  # this will execute the `finally` block
 
 
+# check whether transparent huge pages can back shared memory segments
+def thp_shmem_enabled():
+    try:
+        with open('/sys/kernel/mm/transparent_hugepage/shmem_enabled') as f:
+            mode = f.read()
+    except OSError:
+        return False
+    return '[advise]' in mode or '[always]' in mode or '[force]' in mode or '[within_size]' in mode
+
+
+# reply to the message received by msgInterface with handler (see
+# Experiment.set_handler)
+def _reply(msgInterface, handler):
+    msgInterface.PySendBegin()
+    handler(msgInterface)
+    msgInterface.PyRecvEnd()
+    msgInterface.PySendEnd()
+
+
+# the step called by the simulation for each message, when embedded: the
+# message has just been sent, so the waits return at once
+def _make_step(msgInterface, handler):
+    def step():
+        msgInterface.PyRecvBegin()
+        _reply(msgInterface, handler)
+    return step
+
+
 # This class sets up the shared memory and runs the simulation process.
 class Experiment:
-    _created = False
-
     # init ns-3 environment
-    # \param[in] memSize : share memory size
-    # \param[in] targetName : program name of ns3
+    # \param[in] shmSize : share memory size, computed from the message
+    #                      types and vectorSize if None (the segment then
+    #                      grows when vectors are resized)
+    # \param[in] targetName : program name of ns3, or None if the simulation
+    #                          is started elsewhere (e.g., on another host,
+    #                          with a socket segName)
     # \param[in] path : current working directory
+    # \param[in] waitMode : "spin" or "spin_then_sleep", used by both sides
+    #                       unless the C++ side sets its own
+    # \param[in] spinBudgetUs : spin budget before sleeping, in microseconds
+    # \param[in] ringDepth : if set, create a one-way ring-buffer channel
+    #                        (Ns3AiMsgRingImpl) with that many slots instead
+    #                        of the request/response message interface
+    # \param[in] hugePages : back the segment with transparent huge pages
+    #                        (for hugetlbfs, use a segName which is a path
+    #                        on the mount instead, on both sides)
+    # \param[in] cpuAffinity : None, "siblings", or a tuple (ns3Cpu, pythonCpu)
+    #                          to pin the two processes
+    # \param[in] stats : record the channel statistics (round trips, wait
+    #                    times, payload bytes) in shared memory, see get_stats
+    # \param[in] segName : segment name, or a socket address to listen on
+    #                      ("tcp://host:port" or "unix:///path"), to which
+    #                      the C++ side connects with the same segment name.
+    #                      The simulation started by run uses it whatever
+    #                      its own names (see NS3AI_SEGMENT_NAME), so give
+    #                      each experiment running at once its own name.
+    # \param[in] snapshot : start the simulations from a snapshot taken where
+    #                       the C++ side calls Ns3AiSnapshot::MarkEpisodeStart
+    #                       (e.g., after warm-up): the first run launches
+    #                       ns-3, which stays parked at the mark, and each
+    #                       run forks it instead of launching ns-3 again.
+    #                       Needs a shared memory segment and a binding
+    #                       exposing Ns3AiSnapshotClient
+    # \param[in] directLaunch : run the compiled program (found once, see
+    #                           find_ns3_binary) instead of "./ns3 run",
+    #                           which checks the build at every run. The
+    #                           program is not rebuilt: after editing the
+    #                           C++ side, build it (./ns3 build) or the
+    #                           previous program runs
+    # \param[in] poolSize : number of simulations launched in advance, which
+    #                       wait at their first channel until a run starts
+    #                       one of them. Needs a binding exposing
+    #                       Ns3AiLauncher, which also replaces the sleep that
+    #                       detects early crashes by a handshake
     def __init__(self, targetName, ns3Path, msgModule,
                  handleFinish=False,
                  useVector=False, vectorSize=None,
-                 shmSize=4096,
+                 shmSize=None,
                  segName="My Seg",
                  cpp2pyMsgName="My Cpp to Python Msg",
                  py2cppMsgName="My Python to Cpp Msg",
-                 lockableName="My Lockable" 
+                 lockableName="My Lockable",
+                 waitMode="spin",
+                 spinBudgetUs=DEFAULT_SPIN_BUDGET_US,
+                 ringDepth=None,
+                 hugePages=False,
+                 cpuAffinity=None,
+                 stats=False,
+                 snapshot=False,
+                 directLaunch=True,
+                 poolSize=0
                  ): 
-        if self._created:
-            raise Exception('ns3ai_utils: Error: Experiment is singleton')
-        self._created = True
         self.targetName = targetName  # ns-3 target name, not file name
         self.ns3Path = ns3Path
-        os.chdir(ns3Path)
+        if not EMBEDDED:
+            os.chdir(ns3Path)
         self.msgModule = msgModule
         self.handleFinish = handleFinish
         self.useVector = useVector
         self.vectorSize = vectorSize
-        self.shmSize = shmSize
+        self.shmSize = 0 if shmSize is None else shmSize
         self.segName = segName
         self.cpp2pyMsgName = cpp2pyMsgName
         self.py2cppMsgName = py2cppMsgName
         self.lockableName = lockableName 
+        if waitMode not in WAIT_MODES:
+            raise Exception('ns3ai_utils: Error: Unknown wait mode {}'.format(waitMode))
+        self.waitMode = waitMode
+        self.spinBudgetUs = spinBudgetUs
 
-        self.msgInterface = msgModule.Ns3AiMsgInterfaceImpl(
-            True, self.useVector, self.handleFinish,
-            self.shmSize, self.segName, self.cpp2pyMsgName, self.py2cppMsgName, self.lockableName
-        )
+        self.ringDepth = ringDepth
+        self.hugePages = hugePages
+        if cpuAffinity == 'siblings':
+            cpuAffinity = get_sibling_cpus()
+        self.cpuAffinity = cpuAffinity
+        self.stats = stats
+        self.snapshot = snapshot
+        if self.snapshot:
+            if not hasattr(msgModule, 'Ns3AiSnapshotClient'):
+                raise Exception('ns3ai_utils: Error: Binding module does not expose Ns3AiSnapshotClient')
+            if EMBEDDED or targetName is None or segName.startswith(('tcp://', 'unix://')):
+                raise Exception('ns3ai_utils: Error: Snapshots need ns-3 launched by Experiment '
+                                'and a shared memory segment')
+        self.snapshotClient = None
+        self.snapshotPid = None
+        self.binary = None
+        if directLaunch and targetName is not None and not EMBEDDED:
+            self.binary = find_ns3_binary('./', targetName)
+        # simulations launched with the handshake, not started yet
+        self.pool = []
+        self.poolSize = poolSize
+        self.poolSetting = None
+        self.launcher = None
+        useLauncher = (hasattr(msgModule, 'Ns3AiLauncher') and targetName is not None and
+                       not EMBEDDED and not snapshot and not segName.startswith(('tcp://', 'unix://')))
+        if poolSize and not useLauncher:
+            raise Exception('ns3ai_utils: Error: A pool needs a binding exposing Ns3AiLauncher, '
+                            'a shared memory segment and no snapshots')
+        if self.cpuAffinity is not None:
+            os.sched_setaffinity(0, {self.cpuAffinity[1]})
+
+        if self.ringDepth is not None:
+            if self.useVector:
+                raise Exception('ns3ai_utils: Error: Ring-buffer channel does not use vector')
+            self.msgInterface = msgModule.Ns3AiMsgRingImpl(
+                True, self.handleFinish, self.ringDepth,
+                self.shmSize, self.segName, self.cpp2pyMsgName, self.lockableName
+            )
+        else:
+            self.msgInterface = msgModule.Ns3AiMsgInterfaceImpl(
+                True, self.useVector, self.handleFinish,
+                self.shmSize, self.segName, self.cpp2pyMsgName, self.py2cppMsgName, self.lockableName
+            )
+        if self.waitMode != 'spin' or self.spinBudgetUs != DEFAULT_SPIN_BUDGET_US:
+            if not hasattr(self.msgInterface, 'SetWaitMode'):
+                raise Exception('ns3ai_utils: Error: Binding module does not expose SetWaitMode')
+            self.msgInterface.SetWaitMode(WAIT_MODES[self.waitMode], self.spinBudgetUs)
+        if self.hugePages:
+            if not hasattr(self.msgInterface, 'SetHugePages'):
+                raise Exception('ns3ai_utils: Error: Binding module does not expose SetHugePages')
+            if not self.msgInterface.SetHugePages(True):
+                print('ns3ai_utils: Huge pages are not supported for this segment')
+            elif not thp_shmem_enabled():
+                print('ns3ai_utils: Huge pages requested, but transparent huge pages are disabled '
+                      'for shared memory (see /sys/kernel/mm/transparent_hugepage/shmem_enabled)')
+        if self.stats:
+            if not hasattr(self.msgInterface, 'EnableStats'):
+                raise Exception('ns3ai_utils: Error: Binding module does not expose EnableStats')
+            self.msgInterface.EnableStats()
         if self.useVector:
             if self.vectorSize is None:
                 raise Exception('ns3ai_utils: Error: Using vector but size is unknown')
-            self.msgInterface.GetCpp2PyVector().resize(self.vectorSize)
-            self.msgInterface.GetPy2CppVector().resize(self.vectorSize)
+            self._resize_vectors(self.msgInterface, self.vectorSize)
+
+        self.channels = {}
+        # (channel, handler) by lockable name, see set_handler
+        self.handlers = {}
+        if useLauncher:
+            self.launcher = msgModule.Ns3AiLauncher(self.segName)
 
         self.proc = None
         self.simCmd = None
         logger = logging.getLogger("")
+        usage = self.get_memory_usage()
+        if usage is not None:
+            logger.info('ns3ai_utils: Shared memory: {} bytes used of {}'.format(
+                usage['size'] - usage['free'], usage['size']))
         logger.info('ns3ai_utils: Experiment initialized')
 
     def __del__(self):
         logger = logging.getLogger("")
         self.kill()
+        self.kill_pool()
+        self.launcher = None
+        self.snapshotClient = None
+        self.channels.clear()
         del self.msgInterface
         logger.info('ns3ai_utils: Experiment destroyed')
 
+    # create another message interface in the same segment, which the C++
+    # side gets with Ns3AiMsgInterface::GetInterface<...>(name). Its object
+    # names are the experiment's names prefixed with "<name>/".
+    # \param[in] name : channel name, must be unique
+    # \param[in] msgModule : binding module of the channel's message types
+    #                        (default : the experiment's module)
+    # \param[in] useVector, vectorSize : as in the constructor
+    #                        (default : the experiment's settings)
+    # \param[in] ringDepth : if set, create a ring-buffer channel instead
+    def add_channel(self, name, msgModule=None, useVector=None, vectorSize=None,
+                    ringDepth=None):
+        if not name or name in self.channels:
+            raise Exception('ns3ai_utils: Error: Invalid or duplicate channel name {}'.format(name))
+        msgModule = self.msgModule if msgModule is None else msgModule
+        useVector = self.useVector if useVector is None else useVector
+        vectorSize = self.vectorSize if vectorSize is None else vectorSize
+        prefix = name + '/'
+        if ringDepth is not None:
+            if useVector:
+                raise Exception('ns3ai_utils: Error: Ring-buffer channel does not use vector')
+            channel = msgModule.Ns3AiMsgRingImpl(
+                True, self.handleFinish, ringDepth, self.shmSize, self.segName,
+                prefix + self.cpp2pyMsgName, prefix + self.lockableName
+            )
+        else:
+            channel = msgModule.Ns3AiMsgInterfaceImpl(
+                True, useVector, self.handleFinish, self.shmSize, self.segName,
+                prefix + self.cpp2pyMsgName, prefix + self.py2cppMsgName,
+                prefix + self.lockableName
+            )
+        if self.waitMode != 'spin' or self.spinBudgetUs != DEFAULT_SPIN_BUDGET_US:
+            channel.SetWaitMode(WAIT_MODES[self.waitMode], self.spinBudgetUs)
+        if self.stats and ringDepth is None:
+            channel.EnableStats()
+        if useVector:
+            if vectorSize is None:
+                raise Exception('ns3ai_utils: Error: Using vector but size is unknown')
+            self._resize_vectors(channel, vectorSize)
+        self.channels[name] = channel
+        return channel
+
+    # reply to each message of a channel with handler(msgInterface), which
+    # reads the message and writes the reply. When embedded in ns-3, the
+    # simulation calls the handler itself, on its thread, as soon as it has
+    # sent a message: set the handlers before run(), then call serve() and
+    # end the script without receiving. Otherwise serve() calls the handler.
+    # \param[in] handler : callable taking the message interface
+    # \param[in] channel : name of a channel added with add_channel
+    #                      (default : the experiment's interface)
+    def set_handler(self, handler, channel=None):
+        msgInterface = self.msgInterface if channel is None else self.channels[channel]
+        if not hasattr(msgInterface, 'PySendBegin'):
+            raise Exception('ns3ai_utils: Error: Handlers need a message interface channel')
+        lockable = self.lockableName if channel is None else channel + '/' + self.lockableName
+        self.handlers[lockable] = (msgInterface, handler)
+
+    # call the handler set by set_handler for each message, until the
+    # simulation finishes. Returns at once when embedded in ns-3, which
+    # calls the handlers itself.
+    def serve(self):
+        if EMBEDDED:
+            return
+        if len(self.handlers) != 1 or not self.handleFinish:
+            raise Exception('ns3ai_utils: Error: serve() needs one handler and handleFinish')
+        msgInterface, handler = next(iter(self.handlers.values()))
+        while True:
+            msgInterface.PyRecvBegin()
+            if msgInterface.PyGetFinished():
+                break
+            _reply(msgInterface, handler)
+
     # run ns3 script in cmd with the setting being input
     # \param[in] setting : ns3 script input parameters(default : None)
     # \param[in] show_output : whether to show output or not(default : False)
     def run(self, setting=None, show_output=False, log_file = None):
         logger = logging.getLogger("")
+        if EMBEDDED:
+            # ns-3 is this process, and has already parsed its arguments
+            if setting:
+                logger.info('ns3ai_utils: Embedded in ns-3, ignoring setting {}'.format(setting))
+            if self.cpuAffinity is not None:
+                # the simulation runs in the main thread, whose id is the pid
+                os.sched_setaffinity(os.getpid(), {self.cpuAffinity[0]})
+            for lockable, (msgInterface, handler) in self.handlers.items():
+                ns3ai_embedded.set_handler(lockable, _make_step(msgInterface, handler))
+            ns3ai_embedded.ready()
+            return self.msgInterface
+        if self.targetName is None:
+            # the simulation connects to the socket address by itself
+            logger.info('ns3ai_utils: Waiting for the simulation on {}'.format(self.segName))
+            return self.msgInterface
+        if self.snapshotPid is not None and self.isalive():
+            # the previous episode has ended, so the channels are idle
+            pid = self.snapshotClient.Fork()
+            logger.info('ns3ai_utils: Forked ns-3 process {} from snapshot'.format(pid))
+            return self.msgInterface
         self.kill()
-        self.simCmd, self.proc = run_single_ns3(
-            './', self.targetName, setting=setting, show_output=show_output, log_file = log_file)
-        logger.info(f"ns3ai_utils: Running ns-3 with: {self.simCmd}")
-        # exit if an early error occurred, such as wrong target name
-        time.sleep(SIMULATION_EARLY_ENDING)
-        if not self.isalive():
-            logger.info('ns3ai_utils: Subprocess died very early')
-            print(f"ns3ai_utils: Subprocess died very early: {os.path.join(self.ns3Path, self.targetName)}")
-            exit(1)
+        # the simulation uses this segment even if it sets other names, so
+        # that several experiments can run at once with their own segments
+        env = {'NS3AI_SEGMENT_NAME': self.segName}
+        if self.snapshot:
+            # a new channel, in case the previous simulation died in an exchange
+            self.snapshotClient = None
+            self.snapshotClient = self.msgModule.Ns3AiSnapshotClient(self.segName)
+            env['NS3AI_SNAPSHOT'] = '1'
+        if self.launcher is not None:
+            env['NS3AI_LAUNCH_HANDSHAKE'] = '1'
+            self._start_parked(setting, show_output, log_file, env)
+        else:
+            self.simCmd, self.proc = self._launch(setting, show_output, log_file, env)
+            # exit if an early error occurred, such as wrong target name
+            time.sleep(SIMULATION_EARLY_ENDING)
+            if not self.isalive():
+                self._died_early()
         signal.signal(signal.SIGINT, sigint_handler)
+        if self.snapshot:
+            self._fork_first_episode()
         return self.msgInterface
 
+    def _launch(self, setting, show_output, log_file, env):
+        logger = logging.getLogger("")
+        cmd, proc = run_single_ns3(
+            './', self.targetName, setting=setting, env=env,
+            show_output=show_output, log_file = log_file,
+            cpu=None if self.cpuAffinity is None else self.cpuAffinity[0], binary=self.binary)
+        logger.info(f"ns3ai_utils: Running ns-3 with: {cmd}")
+        return cmd, proc
+
+    def _died_early(self):
+        logger = logging.getLogger("")
+        logger.info('ns3ai_utils: Subprocess died very early')
+        print(f"ns3ai_utils: Subprocess died very early: {os.path.join(self.ns3Path, self.targetName)}")
+        exit(1)
+
+    # start a simulation parked at its first channel (launching one if the
+    # pool is empty), then refill the pool
+    def _start_parked(self, setting, show_output, log_file, env):
+        logger = logging.getLogger("")
+        if self.pool and setting != self.poolSetting:
+            # the parked simulations were launched with other settings
+            self.kill_pool()
+        if self.launcher is None:
+            self.launcher = self.msgModule.Ns3AiLauncher(self.segName)
+        if not self.pool:
+            self.pool.append(self._launch(setting, show_output, log_file, env))
+        self.poolSetting = setting
+        # parked means that the setup is done and the segment attached
+        while self.launcher.GetParked() == 0:
+            self.pool = [entry for entry in self.pool if entry[1].poll() is None]
+            if not self.pool:
+                self._died_early()
+            time.sleep(LAUNCH_POLL)
+        pid = self.launcher.Start(LAUNCH_START_TIMEOUT_MS)
+        entry = next((entry for entry in self.pool if self._owns(entry[1], pid)), None)
+        if not pid or entry is None:
+            self.kill_pool()
+            raise Exception('ns3ai_utils: Error: A parked simulation did not start')
+        self.pool.remove(entry)
+        self.simCmd, self.proc = entry
+        logger.info('ns3ai_utils: Started parked ns-3 process {}'.format(pid))
+        while len(self.pool) < self.poolSize:
+            self.pool.append(self._launch(setting, show_output, log_file, env))
+
+    # whether the simulation pid is the process, or runs under it (ns3 script)
+    @staticmethod
+    def _owns(proc, pid):
+        if proc.pid == pid:
+            return True
+        try:
+            return any(c.pid == pid for c in psutil.Process(proc.pid).children(recursive=True))
+        except psutil.NoSuchProcess:
+            return False
+
+    # kill the simulations waiting in the pool
+    def kill_pool(self):
+        for cmd, proc in self.pool:
+            if proc.poll() is None:
+                kill_proc_tree(proc)
+        if self.pool:
+            # the launcher counted them, start afresh
+            self.launcher = None
+        self.pool = []
+
+    # wait for the simulation to reach the episode start, then fork the
+    # first episode
+    def _fork_first_episode(self):
+        logger = logging.getLogger("")
+        while True:
+            pid = self.snapshotClient.WaitReady(SNAPSHOT_POLL_MS)
+            if pid:
+                break
+            if not self.isalive():
+                raise Exception('ns3ai_utils: Error: Simulation exited before '
+                                'Ns3AiSnapshot::MarkEpisodeStart')
+        self.snapshotPid = pid
+        logger.info('ns3ai_utils: ns-3 process {} parked at the episode start'.format(pid))
+        pid = self.snapshotClient.Fork()
+        logger.info('ns3ai_utils: Forked ns-3 process {} from snapshot'.format(pid))
+
     def kill(self):
+        self.snapshotPid = None
         if self.proc and self.isalive():
             kill_proc_tree(self.proc)
             self.proc = None
             self.simCmd = None
 
     def isalive(self):
-        return self.proc.poll() is None
+        if EMBEDDED or self.targetName is None:
+            return True
+        return self.proc is not None and self.proc.poll() is None
+
+    # get the size of the shared memory segment, and the bytes still free
+    def get_memory_usage(self):
+        if not hasattr(self.msgInterface, 'GetMemorySize'):
+            return None
+        return {'size': self.msgInterface.GetMemorySize(),
+                'free': self.msgInterface.GetFreeMemory()}
+
+    # resize the vectors of a vector-based interface, growing the segment
+    # if the binding supports it. The fallback, for bindings which only bind
+    # the vectors' own resize, neither grows the segment nor takes its lock
+    def _resize_vectors(self, msgInterface, vectorSize):
+        if hasattr(msgInterface, 'ResizeCpp2PyVector'):
+            msgInterface.ResizeCpp2PyVector(vectorSize)
+            msgInterface.ResizePy2CppVector(vectorSize)
+        else:
+            msgInterface.GetCpp2PyVector().resize(vectorSize)
+            msgInterface.GetPy2CppVector().resize(vectorSize)
+
+    # get the time this (Python) side spent waiting, split into spinning
+    # and sleeping, for both the send and the receive semaphores
+    def get_wait_stats(self):
+        if not hasattr(self.msgInterface, 'GetSendWaitStats'):
+            return None
+        return {'send': self.msgInterface.GetSendWaitStats(),
+                'recv': self.msgInterface.GetRecvWaitStats()}
+
+    # get the channel statistics recorded by both sides (None if disabled):
+    # per direction ("cpp2py", "py2cpp"), the number of messages and payload
+    # bytes, and histogram summaries (count, mean, percentiles, in ns) of
+    # the send and receive waits and of the round trips
+    # \param[in] channel : name of a channel added with add_channel
+    #                      (default : the experiment's interface)
+    def get_stats(self, channel=None):
+        msgInterface = self.msgInterface if channel is None else self.channels[channel]
+        if not hasattr(msgInterface, 'GetStats'):
+            return None
+        return msgInterface.GetStats()
+
+    # get an AsyncChannel, to await the messages of the experiment's
+    # interface or of a channel from asyncio
+    # \param[in] channel : name of a channel added with add_channel
+    #                      (default : the experiment's interface)
+    # \param[in] msgModule : binding module of the channel's message types
+    #                        (default : the experiment's module)
+    def get_async(self, channel=None, msgModule=None):
+        if self.waitMode == 'spin':
+            print('ns3ai_utils: Async waits with the "spin" wait mode keep one core '
+                  'busy per waiting channel, consider "spin_then_sleep"')
+        msgInterface = self.msgInterface if channel is None else self.channels[channel]
+        return AsyncChannel(msgInterface, self.msgModule if msgModule is None else msgModule)
+
+
+# This class awaits the messages of a message interface from asyncio, so
+# that one Python process can serve many simulations (or channels) at
+# once, e.g. with asyncio.gather. The waits (PyRecvBegin, PySendBegin) run
+# in a C++ thread without the GIL, which wakes the event loop through a
+# file descriptor; the binding module must expose Ns3AiMsgAsyncWaiter (see
+# ns3-ai-msg-async-py.h). The other methods are the interface's:
+#
+#     await channel.recv_begin()
+#     ... read channel.GetCpp2PyStruct() ...
+#     channel.PyRecvEnd()
+#     await channel.send_begin()
+#     ... write channel.GetPy2CppStruct() ...
+#     channel.PySendEnd()
+#
+# A cancelled wait (e.g. by asyncio.wait_for) which received a message
+# anyway keeps it for the next wait of the same kind.
+class AsyncChannel:
+    def __init__(self, msgInterface, msgModule):
+        if not hasattr(msgModule, 'Ns3AiMsgAsyncWaiter'):
+            raise Exception('ns3ai_utils: Error: Binding module does not expose Ns3AiMsgAsyncWaiter')
+        self.msgInterface = msgInterface
+        self.waiter = msgModule.Ns3AiMsgAsyncWaiter(msgInterface)
+
+    def __getattr__(self, name):
+        return getattr(self.msgInterface, name)
+
+    # wait until a message from C++ can be read
+    async def recv_begin(self):
+        await self._wait(self.waiter.StartRecvBegin)
+
+    # wait until a message to C++ can be written
+    async def send_begin(self):
+        await self._wait(self.waiter.StartSendBegin)
+
+    async def _wait(self, start):
+        loop = asyncio.get_running_loop()
+        fd = self.waiter.GetFd()
+        start()
+        while True:
+            future = loop.create_future()
+
+            def on_readable():
+                loop.remove_reader(fd)
+                if not future.done():
+                    future.set_result(None)
+
+            loop.add_reader(fd, on_readable)
+            try:
+                await future
+            except asyncio.CancelledError:
+                loop.remove_reader(fd)
+                self.waiter.Cancel()
+                raise
+            # rethrows the error of a failed wait
+            if self.waiter.Collect():
+                return
+
+
+# This class serves a message log, recorded by the C++ side (see
+# Ns3AiMsgInterface::SetRecordPath), to the Python side instead of running
+# ns-3: the recorded messages are sent as fast as Python reads them, and
+# Python's replies are dropped. It is used like Experiment, and the
+# binding module must expose Ns3AiMsgReplayer (see ns3-ai-msg-replay-py.h).
+# The replay is faithful as long as Python sends as many replies as in the
+# recorded run.
+class Replay(Experiment):
+    REPLAY_END_TIMEOUT = 1.0    # wait for the previous replay to end before starting again
+
+    # \param[in] logPath : the message log, for a named channel
+    #                      "<path>.<channelName>"
+    # other parameters : as in Experiment (ring-buffer channels are not
+    #                    recorded, cpuAffinity only pins this process)
+    def __init__(self, logPath, msgModule, **kwargs):
+        if kwargs.get('ringDepth') is not None:
+            raise Exception('ns3ai_utils: Error: Ring-buffer channels cannot be replayed')
+        if not hasattr(msgModule, 'Ns3AiMsgReplayer'):
+            raise Exception('ns3ai_utils: Error: Binding module does not expose Ns3AiMsgReplayer')
+        self.logPath = logPath
+        self.replayer = None
+        super().__init__(None, os.getcwd(), msgModule, **kwargs)
+
+    def __del__(self):
+        self.replayer = None
+        super().__del__()
+
+    # start serving the log from its first message
+    # \param[in] setting, show_output, log_file : ignored
+    def run(self, setting=None, show_output=False, log_file=None):
+        logger = logging.getLogger("")
+        if self.replayer is not None:
+            deadline = time.time() + self.REPLAY_END_TIMEOUT
+            while not self.replayer.IsFinished() and time.time() < deadline:
+                time.sleep(0.001)
+            if not self.replayer.IsFinished():
+                raise Exception('ns3ai_utils: Error: Previous replay has not ended, '
+                                'Python did not exchange the recorded number of messages')
+        self.replayer = self.msgModule.Ns3AiMsgReplayer(
+            self.logPath, self.useVector, self.handleFinish,
+            self.segName, self.cpp2pyMsgName, self.py2cppMsgName, self.lockableName
+        )
+        self.replayer.Start()
+        logger.info('ns3ai_utils: Replaying {}'.format(self.logPath))
+        return self.msgInterface
+
+    def kill(self):
+        pass
+
+    def isalive(self):
+        return self.replayer is not None and not self.replayer.IsFinished()
 
 
-__all__ = ['Experiment']
+__all__ = ['Experiment', 'Replay', 'AsyncChannel']